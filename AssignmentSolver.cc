@@ -0,0 +1,83 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#include <cfloat>
+#include <omnetpp.h>
+#include "AssignmentSolver.h"
+
+using namespace omnetpp;
+
+/**
+ * Shortest augmenting path variant of the Hungarian method. Rows and columns are 1-based
+ * internally, column 0 is the virtual start of every augmenting path.
+ */
+const std::vector<int>& AssignmentSolver::solve(const std::vector<double>& costs, unsigned int rows, unsigned int columns)
+{
+    if (rows > columns) throw cRuntimeError("AssignmentSolver::solve(): %u rows cannot be assigned to %u columns", rows, columns);
+    if (costs.size() < (size_t) rows * columns) throw cRuntimeError("AssignmentSolver::solve(): cost matrix too small");
+
+    rowPotential.assign(rows + 1, 0);
+    columnPotential.assign(columns + 1, 0);
+    columnRow.assign(columns + 1, 0);
+    previousColumn.assign(columns + 1, 0);
+
+    for (unsigned int row = 1; row <= rows; row++) {
+        columnRow[0] = row;
+        unsigned int column = 0;
+        minSlack.assign(columns + 1, DBL_MAX);
+        visited.assign(columns + 1, false);
+        do {
+            visited[column] = true;
+            unsigned int currentRow = columnRow[column];
+            double delta = DBL_MAX;
+            unsigned int nextColumn = 0;
+            for (unsigned int j = 1; j <= columns; j++) {
+                if (visited[j]) continue;
+                double slack = costs[(currentRow - 1) * columns + (j - 1)] - rowPotential[currentRow] - columnPotential[j];
+                if (slack < minSlack[j]) {
+                    minSlack[j] = slack;
+                    previousColumn[j] = column;
+                }
+                if (minSlack[j] < delta) {
+                    delta = minSlack[j];
+                    nextColumn = j;
+                }
+            }
+            for (unsigned int j = 0; j <= columns; j++) {
+                if (visited[j]) {
+                    rowPotential[columnRow[j]] += delta;
+                    columnPotential[j] -= delta;
+                }
+                else {
+                    minSlack[j] -= delta;
+                }
+            }
+            column = nextColumn;
+        } while (columnRow[column] != 0);
+
+        // augment along the path back to the virtual column
+        do {
+            unsigned int previous = previousColumn[column];
+            columnRow[column] = columnRow[previous];
+            column = previous;
+        } while (column != 0);
+    }
+
+    assignment.assign(rows, -1);
+    for (unsigned int j = 1; j <= columns; j++) {
+        if (columnRow[j] != 0) assignment[columnRow[j] - 1] = j - 1;
+    }
+    return assignment;
+}
@@ -0,0 +1,48 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef ASSIGNMENTSOLVER_H_
+#define ASSIGNMENTSOLVER_H_
+
+#include <vector>
+
+/**
+ * Min-cost assignment of rows (e.g. missions or replacement requests) to columns (e.g. nodes),
+ * solved with the Hungarian method in O(rows^2 * columns).
+ *
+ * The working arrays are kept between the calls, so solving one batch after the other
+ * does not allocate once the largest batch was seen.
+ */
+class AssignmentSolver {
+public:
+    /**
+     * @param costs Row major cost matrix with rows * columns entries
+     * @param rows Number of rows, at most columns
+     * @param columns Number of columns
+     * @return Column assigned to every row, the sum of their costs is minimal
+     */
+    const std::vector<int>& solve(const std::vector<double>& costs, unsigned int rows, unsigned int columns);
+
+private:
+    std::vector<double> rowPotential;
+    std::vector<double> columnPotential;
+    std::vector<double> minSlack;
+    std::vector<int> columnRow;
+    std::vector<int> previousColumn;
+    std::vector<char> visited;
+    std::vector<int> assignment;
+};
+
+#endif /* ASSIGNMENTSOLVER_H_ */
@@ -0,0 +1,78 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#include "CEEPool.h"
+
+CEEPool::~CEEPool()
+{
+    for (auto& blocks : freeBlocks) {
+        for (void* block : blocks.second) {
+            ::operator delete(block);
+        }
+    }
+}
+
+void* CEEPool::acquire(size_t size)
+{
+    used++;
+    usedBytes += size;
+    std::vector<void*>& blocks = freeBlocks[size];
+    if (blocks.empty()) return ::operator new(size);
+    void* block = blocks.back();
+    blocks.pop_back();
+    return block;
+}
+
+/**
+ * Every CeeType is implemented by exactly one class, its size identifies the free list on release().
+ */
+void CEEPool::registerBlockSize(CeeType type, size_t size)
+{
+    size_t& registered = blockSize[(int) type];
+    if (registered == 0) registered = size;
+    if (registered != size) throw cRuntimeError("CEEPool: CEE type %d created with different sizes.", (int) type);
+}
+
+void CEEPool::release(CommandExecEngine* cee)
+{
+    if (cee == nullptr) return;
+    size_t size = blockSize[(int) cee->getCeeType()];
+    if (size == 0) throw cRuntimeError("CEEPool::release(): CEE was not created by a pool.");
+    void* block = dynamic_cast<void*>(cee);
+    Command* ownedCommand = cee->isCommandOwned() ? cee->extractCommand() : nullptr;
+    cee->~CommandExecEngine();
+    delete ownedCommand;
+    freeBlocks[size].push_back(block);
+    used--;
+    usedBytes -= size;
+}
+
+unsigned int CEEPool::getFree() const
+{
+    unsigned int count = 0;
+    for (auto& blocks : freeBlocks) {
+        count += blocks.second.size();
+    }
+    return count;
+}
+
+size_t CEEPool::getAllocatedBytes() const
+{
+    size_t bytes = usedBytes;
+    for (auto& blocks : freeBlocks) {
+        bytes += blocks.first * blocks.second.size() + blocks.second.capacity() * sizeof(void*);
+    }
+    return bytes;
+}
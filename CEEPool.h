@@ -0,0 +1,76 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef CEEPOOL_H_
+#define CEEPOOL_H_
+
+#include <map>
+#include <new>
+#include <utility>
+#include <vector>
+#include "CommandExecEngine.h"
+
+#define NUM_CEE_TYPES 6
+
+/**
+ * Per-node arena for CommandExecEngine objects.
+ * Released CEEs are destroyed and their memory is kept in a free list, the next create() of a CEE of the same size reuses it.
+ * A CEE must be released at most once and must not be used after release().
+ * Commands of CEEs marked with setCommandOwned() are deleted on release().
+ */
+class CEEPool {
+public:
+    CEEPool() {};
+    ~CEEPool();
+
+    template<typename T, typename ... Args>
+    T* create(Args&&... args)
+    {
+        T* cee = new (acquire(sizeof(T))) T(std::forward<Args>(args)...);
+        registerBlockSize(cee->getCeeType(), sizeof(T));
+        return cee;
+    }
+
+    void release(CommandExecEngine* cee);
+
+    /**
+     * @return Number of CEEs currently alive
+     */
+    unsigned int getUsed() const
+    {
+        return used;
+    }
+
+    /**
+     * @return Number of released blocks available for reuse
+     */
+    unsigned int getFree() const;
+
+    /**
+     * @return Bytes of the alive CEEs and the released blocks
+     */
+    size_t getAllocatedBytes() const;
+
+private:
+    std::map<size_t, std::vector<void*>> freeBlocks;
+    size_t blockSize[NUM_CEE_TYPES] = { 0 };
+    unsigned int used = 0;
+    size_t usedBytes = 0;
+
+    void* acquire(size_t size);
+    void registerBlockSize(CeeType type, size_t size);
+};
+
+#endif /* CEEPOOL_H_ */
@@ -13,15 +13,22 @@
 // along with this program.  If not, see http://www.gnu.org/licenses/.
 //
 
-#ifdef WITH_OSG
-#include <osg/PositionAttitudeTransform>
-#include <osgEarthUtil/ObjectLocator>
+#include <algorithm>
+#include <cmath>
 
 #include "ChannelController.h"
+#include "Profiling.h"
+#include "RealTimeScheduler.h"
+
+#if defined(WITH_OSG) && defined(WITH_OSGEARTH)
+#include <osg/BlendFunc>
+#include <osg/Geode>
+#include <osg/LineWidth>
+#include <osgEarth/Color>
+#include <osgEarth/GeoData>
 
 using namespace osgEarth;
-using namespace osgEarth::Annotation;
-using namespace osgEarth::Features;
+#endif
 
 Define_Module(ChannelController);
 
@@ -46,20 +53,120 @@ ChannelController *ChannelController::getInstance()
 
 int ChannelController::findGenericNode(IGenericNode *p)
 {
-    for (int i = 0; i < (int) nodeList.size(); i++)
-        if (nodeList[i] == p) return i;
-    return -1;
+    auto it = nodeIndices.find(p);
+    return (it == nodeIndices.end()) ? -1 : it->second;
+}
+
+/**
+ * Visits all nodes in the 27 grid cells around the given node.
+ * As the cell size is the largest txRange, every node in range is visited.
+ */
+template<typename Visitor>
+void ChannelController::forEachCandidate(IGenericNode *p, Visitor visit) const
+{
+    int64_t center = getCellKey(p->getX(), p->getY(), p->getZ());
+    for (int64_t dx = -1; dx <= 1; dx++) {
+        for (int64_t dy = -1; dy <= 1; dy++) {
+            for (int64_t dz = -1; dz <= 1; dz++) {
+                auto cell = grid.find(center + dx * ((int64_t) 1 << 42) + dy * ((int64_t) 1 << 21) + dz);
+                if (cell == grid.end()) continue;
+                for (auto q : cell->second)
+                    visit(q);
+            }
+        }
+    }
 }
 
 void ChannelController::addGenericNode(IGenericNode *p)
 {
-    if (findGenericNode(p) == -1) nodeList.push_back(p);
+    if (findGenericNode(p) != -1) return;
+    nodeIndices[p] = nodeList.size();
+    nodeList.push_back(p);
+    if (p->getTxRange() > cellSize) {
+        cellSize = p->getTxRange();
+        rebuildGrid();
+    }
+    else {
+        insertIntoGrid(p);
+    }
 }
 
 void ChannelController::removeGenericNode(IGenericNode *p)
 {
     int k = findGenericNode(p);
-    if (k != -1) nodeList.erase(nodeList.begin() + k);
+    if (k == -1) return;
+    removeFromGrid(p);
+    nodeList.erase(nodeList.begin() + k);
+    nodeIndices.erase(p);
+    for (int i = k; i < (int) nodeList.size(); i++)
+        nodeIndices[nodeList[i]] = i;
+}
+
+/**
+ * Moves the node to another grid cell if its position changed accordingly.
+ * Has to be called whenever a node changed its position.
+ */
+void ChannelController::updateGenericNode(IGenericNode *p)
+{
+    auto it = nodeCells.find(p);
+    if (it == nodeCells.end()) return;
+    if (it->second == getCellKey(p->getX(), p->getY(), p->getZ())) return;
+    removeFromGrid(p);
+    insertIntoGrid(p);
+}
+
+/**
+ * Returns all nodes within the txRange of the given node, excluding the node itself.
+ */
+std::vector<IGenericNode *> ChannelController::getNeighbors(IGenericNode *p) const
+{
+    // moves analyticMotion nodes into the grid cell of their current position
+    GenericNode::refreshExtrapolatedPositions();
+    std::vector<IGenericNode *> neighbors;
+    double px = p->getX(), py = p->getY(), pz = p->getZ();
+    double range = p->getTxRange();
+    forEachCandidate(p, [&](IGenericNode *q) {
+        if (q == p) return;
+        double qx = q->getX(), qy = q->getY(), qz = q->getZ();
+        if (range * range > (px - qx) * (px - qx) + (py - qy) * (py - qy) + (pz - qz) * (pz - qz)) {
+            neighbors.push_back(q);
+        }
+    });
+    return neighbors;
+}
+
+int64_t ChannelController::getCellKey(double x, double y, double z) const
+{
+    // 21 bits per axis, unique for coordinates within +-2^20 cells
+    int64_t cx = (int64_t) floor(x / cellSize) + (1 << 20);
+    int64_t cy = (int64_t) floor(y / cellSize) + (1 << 20);
+    int64_t cz = (int64_t) floor(z / cellSize) + (1 << 20);
+    return (cx << 42) | (cy << 21) | cz;
+}
+
+void ChannelController::insertIntoGrid(IGenericNode *p)
+{
+    int64_t key = getCellKey(p->getX(), p->getY(), p->getZ());
+    grid[key].push_back(p);
+    nodeCells[p] = key;
+}
+
+void ChannelController::removeFromGrid(IGenericNode *p)
+{
+    auto it = nodeCells.find(p);
+    if (it == nodeCells.end()) return;
+    std::vector<IGenericNode *>& cell = grid[it->second];
+    cell.erase(std::find(cell.begin(), cell.end(), p));
+    if (cell.empty()) grid.erase(it->second);
+    nodeCells.erase(it);
+}
+
+void ChannelController::rebuildGrid()
+{
+    grid.clear();
+    nodeCells.clear();
+    for (auto p : nodeList)
+        insertIntoGrid(p);
 }
 
 void ChannelController::initialize(int stage)
@@ -70,22 +177,42 @@ void ChannelController::initialize(int stage)
             playgroundLon = getSystemModule()->par("playgroundLongitude");
             connectionColor = par("connectionColor").stringValue();
             showConnections = par("showConnections").boolValue();
+            connectionUpdateInterval = par("connectionUpdateInterval").doubleValue();
             break;
         }
         case 1: {
+#if defined(WITH_OSG) && defined(WITH_OSGEARTH)
             auto scene = OsgEarthScene::getInstance()->getScene(); // scene is initialized in stage 0 so we have to do our init in stage 1
             mapNode = osgEarth::MapNode::findMapNode(scene);
-            connectionStyle.getOrCreate<LineSymbol>()->stroke()->color() = osgEarth::Color(connectionColor);
-            connectionStyle.getOrCreate<LineSymbol>()->stroke()->width() = 3.0f;
-            connectionStyle.getOrCreate<AltitudeSymbol>()->clamping() = AltitudeSymbol::CLAMP_ABSOLUTE;
-            connectionStyle.getOrCreate<AltitudeSymbol>()->technique() = AltitudeSymbol::TECHNIQUE_DRAPE;
-            
+
             if (showConnections) {
-                auto geoSRS = mapNode->getMapSRS()->getGeographicSRS();
-                connectionGraphNode = new FeatureNode(mapNode.get(), new Feature(new LineString(), geoSRS));
-                connectionGraphNode->getOrCreateStateSet()->setRenderingHint(osg::StateSet::TRANSPARENT_BIN);
+                // all edges are drawn as GL_LINES of a single geometry, relative to the playground origin to keep float precision
+                GeoPoint(mapNode->getMapSRS()->getGeographicSRS(), playgroundLon, playgroundLat, 0, ALTMODE_ABSOLUTE).toWorld(connectionOrigin);
+                connectionVertices = new osg::Vec3Array();
+                auto colors = new osg::Vec4Array();
+                colors->push_back(osgEarth::Color(connectionColor));
+                connectionPrimitive = new osg::DrawArrays(GL_LINES, 0, 0);
+                connectionGeometry = new osg::Geometry();
+                connectionGeometry->setDataVariance(osg::Object::DYNAMIC);
+                connectionGeometry->setUseDisplayList(false);
+                connectionGeometry->setUseVertexBufferObjects(true);
+                connectionGeometry->setVertexArray(connectionVertices);
+                connectionGeometry->setColorArray(colors, osg::Array::BIND_OVERALL);
+                connectionGeometry->addPrimitiveSet(connectionPrimitive);
+
+                auto geode = new osg::Geode();
+                geode->addDrawable(connectionGeometry);
+                auto stateSet = geode->getOrCreateStateSet();
+                stateSet->setAttributeAndModes(new osg::LineWidth(3.0f));
+                stateSet->setAttributeAndModes(new osg::BlendFunc());
+                stateSet->setMode(GL_LIGHTING, osg::StateAttribute::OFF | osg::StateAttribute::PROTECTED);
+                stateSet->setRenderingHint(osg::StateSet::TRANSPARENT_BIN);
+
+                connectionGraphNode = new osg::MatrixTransform(osg::Matrixd::translate(connectionOrigin));
+                connectionGraphNode->addChild(geode);
                 mapNode->getModelLayerGroup()->addChild(connectionGraphNode);
             }
+#endif
             break;
         }
     }
@@ -93,34 +220,118 @@ void ChannelController::initialize(int stage)
 
 void ChannelController::refreshDisplay() const
 {
+    PROFILE_SCOPE("ChannelController::refreshDisplay");
+    if (RealTimeScheduler::isBehind()) return;
+#if defined(WITH_OSG) && defined(WITH_OSGEARTH)
     if (!showConnections) return;
-    
-    auto geoSRS = mapNode->getMapSRS()->getGeographicSRS();
-    auto connectionGeometry = new osgEarth::Symbology::MultiGeometry();
-    
-    for (int i = 0; i < (int) nodeList.size(); ++i) {
-        for (int j = i + 1; j < (int) nodeList.size(); ++j) {
-            IGenericNode *pi = nodeList[i];
-            IGenericNode *pj = nodeList[j];
-            double ix = pi->getX(), iy = pi->getY(), iz = pi->getZ();
+
+    // the update rate is capped independently of the frame rate of the GUI
+    if (connectionUpdateInterval > 0) {
+        auto now = std::chrono::steady_clock::now();
+        if (std::chrono::duration<double>(now - lastConnectionUpdate).count() < connectionUpdateInterval) return;
+        lastConnectionUpdate = now;
+    }
+    updateConnectionGraph();
+#endif
+}
+
+#if defined(WITH_OSG) && defined(WITH_OSGEARTH)
+/**
+ * Position of the node in world coordinates relative to connectionOrigin.
+ */
+osg::Vec3f ChannelController::toConnectionLocal(IGenericNode *p) const
+{
+    osg::Vec3d world;
+    GeoPoint(mapNode->getMapSRS()->getGeographicSRS(), p->getLongitude(), p->getLatitude(), p->getAltitude(), ALTMODE_ABSOLUTE).toWorld(world);
+    return osg::Vec3f(world - connectionOrigin);
+}
+
+/**
+ * Diffs the connection graph against the edge set of the last update.
+ * Vertices are only rewritten for new edges and edges with a moved end point,
+ * vanished edges are replaced by the last edge in the vertex buffer.
+ */
+void ChannelController::updateConnectionGraph() const
+{
+    // moves analyticMotion nodes into the grid cell of their current position
+    GenericNode::refreshExtrapolatedPositions();
+    int n = nodeList.size();
+    std::vector<osg::Vec3f> positions(n);
+    std::vector<bool> moved(n);
+    std::unordered_map<IGenericNode *, osg::Vec3f> currentPositions;
+    currentPositions.reserve(n);
+    bool changed = false;
+    for (int i = 0; i < n; ++i) {
+        positions[i] = toConnectionLocal(nodeList[i]);
+        auto it = displayedPositions.find(nodeList[i]);
+        moved[i] = (it == displayedPositions.end() || it->second != positions[i]);
+        currentPositions.emplace(nodeList[i], positions[i]);
+    }
+    displayedPositions.swap(currentPositions);
+
+    osg::Vec3Array& vertices = *connectionVertices;
+    ++edgeGeneration;
+    for (int i = 0; i < n; ++i) {
+        IGenericNode *pi = nodeList[i];
+        double ix = pi->getX(), iy = pi->getY(), iz = pi->getZ();
+        forEachCandidate(pi, [&](IGenericNode *pj) {
+            // every pair once, tested with the range of the node listed first
+            int j = nodeIndices.at(pj);
+            if (j <= i) return;
             double jx = pj->getX(), jy = pj->getY(), jz = pj->getZ();
-            if (pi->getTxRange() * pi->getTxRange() > (ix - jx) * (ix - jx) + (iy - jy) * (iy - jy) + (iz - jz) * (iz - jz)) {
-                auto ls = new LineString(2);  // a single line geometry
-                ls->push_back(osg::Vec3d(pi->getLongitude(), pi->getLatitude(), pi->getAltitude()));
-                ls->push_back(osg::Vec3d(pj->getLongitude(), pj->getLatitude(), pj->getAltitude()));
-                connectionGeometry->add(ls);
+            if (pi->getTxRange() * pi->getTxRange() <= (ix - jx) * (ix - jx) + (iy - jy) * (iy - jy) + (iz - jz) * (iz - jz)) return;
+
+            auto key = (pi < pj) ? std::make_pair(pi, pj) : std::make_pair(pj, pi);
+            auto it = edgeSlots.find(key);
+            unsigned int slot;
+            if (it == edgeSlots.end()) {
+                slot = edgeKeys.size();
+                edgeSlots.emplace(key, slot);
+                edgeKeys.push_back(key);
+                edgeSeen.push_back(edgeGeneration);
+                vertices.resize(2 * edgeKeys.size());
             }
+            else {
+                slot = it->second;
+                edgeSeen[slot] = edgeGeneration;
+                if (not moved[i] && not moved[j]) return;
+            }
+            vertices[2 * slot] = positions[i];
+            vertices[2 * slot + 1] = positions[j];
+            changed = true;
+        });
+    }
+
+    // remove edges that were not seen, fill the gap with the last edge
+    for (unsigned int slot = 0; slot < edgeKeys.size();) {
+        if (edgeSeen[slot] == edgeGeneration) {
+            ++slot;
+            continue;
         }
+        edgeSlots.erase(edgeKeys[slot]);
+        unsigned int last = edgeKeys.size() - 1;
+        if (slot != last) {
+            edgeKeys[slot] = edgeKeys[last];
+            edgeSeen[slot] = edgeSeen[last];
+            edgeSlots[edgeKeys[slot]] = slot;
+            vertices[2 * slot] = vertices[2 * last];
+            vertices[2 * slot + 1] = vertices[2 * last + 1];
+        }
+        edgeKeys.pop_back();
+        edgeSeen.pop_back();
+        vertices.resize(2 * edgeKeys.size());
+        changed = true;
     }
-    
-    auto cgraphFeature = new Feature(connectionGeometry, geoSRS, connectionStyle);
-    cgraphFeature->geoInterp() = GEOINTERP_GREAT_CIRCLE;
-    connectionGraphNode->setFeature(cgraphFeature);
+
+    if (not changed) return;
+    connectionPrimitive->setCount(vertices.size());
+    connectionPrimitive->dirty();
+    connectionVertices->dirty();
+    connectionGeometry->dirtyBound();
 }
+#endif
 
 void ChannelController::handleMessage(cMessage *msg)
 {
     throw cRuntimeError("This module does not process messages");
 }
-
-#endif // WITH_OSG
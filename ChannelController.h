@@ -16,14 +16,19 @@
 #ifndef __CHANNELCONTROLLER_H_
 #define __CHANNELCONTROLLER_H_
 
+#include <chrono>
+#include <functional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <omnetpp.h>
+
+#if defined(WITH_OSG) && defined(WITH_OSGEARTH)
+#include <osg/Geometry>
+#include <osg/MatrixTransform>
 #include <osg/Node>
 #include <osgEarth/MapNode>
-#include <osgEarthAnnotation/FeatureNode>
-#include <osgEarthSymbology/Style>
-#include <osgEarthSymbology/Geometry>
-#include <osgEarthFeatures/Feature>
-
-#include <omnetpp.h>
+#endif
 
 #include "GenericNode.h"
 #include "OsgEarthScene.h"
@@ -42,11 +47,46 @@ protected:
     double playgroundLon;
     bool showConnections;
     std::string connectionColor;
+    // minimal wall-clock time between two connection graph updates, 0 updates on every display refresh
+    double connectionUpdateInterval;
+#if defined(WITH_OSG) && defined(WITH_OSGEARTH)
     // the node containing the osgEarth data
     osg::observer_ptr<osgEarth::MapNode> mapNode = nullptr;
-    // a node containing a geometry showing all connections in the connection graph
-    osg::ref_ptr<osgEarth::Annotation::FeatureNode> connectionGraphNode = nullptr;
-    osgEarth::Symbology::Style connectionStyle;
+    // a node containing a geometry showing all connections in the connection graph, positioned at the playground origin
+    osg::ref_ptr<osg::MatrixTransform> connectionGraphNode = nullptr;
+    osg::ref_ptr<osg::Geometry> connectionGeometry = nullptr;
+    // two vertices per edge relative to connectionOrigin, updated in place
+    osg::ref_ptr<osg::Vec3Array> connectionVertices = nullptr;
+    osg::ref_ptr<osg::DrawArrays> connectionPrimitive = nullptr;
+    osg::Vec3d connectionOrigin;
+
+    /**
+     * Persistent edge set of the last connection graph update.
+     * Edge i occupies the vertices 2i and 2i+1, edgeKeys[i] is its node pair.
+     */
+    struct EdgeKeyHash {
+        size_t operator()(const std::pair<IGenericNode *, IGenericNode *>& key) const
+        {
+            return std::hash<IGenericNode *>()(key.first) * 31 + std::hash<IGenericNode *>()(key.second);
+        }
+    };
+    mutable std::unordered_map<std::pair<IGenericNode *, IGenericNode *>, unsigned int, EdgeKeyHash> edgeSlots;
+    mutable std::vector<std::pair<IGenericNode *, IGenericNode *>> edgeKeys;
+    mutable std::vector<unsigned int> edgeSeen;
+    mutable unsigned int edgeGeneration = 0;
+    // node positions relative to connectionOrigin at the last update
+    mutable std::unordered_map<IGenericNode *, osg::Vec3f> displayedPositions;
+    mutable std::chrono::steady_clock::time_point lastConnectionUpdate;
+
+    osg::Vec3f toConnectionLocal(IGenericNode *p) const;
+    void updateConnectionGraph() const;
+#endif
+
+    // uniform spatial hash over all nodes, the cell size is the largest txRange
+    double cellSize = 1;
+    std::unordered_map<int64_t, std::vector<IGenericNode *>> grid;
+    std::unordered_map<IGenericNode *, int64_t> nodeCells;
+    std::unordered_map<IGenericNode *, int> nodeIndices;
 
     virtual void initialize(int stage) override;
     virtual int numInitStages() const override
@@ -55,6 +95,11 @@ protected:
     }
     virtual void handleMessage(cMessage *msg) override;
     int findGenericNode(IGenericNode *p);
+    int64_t getCellKey(double x, double y, double z) const;
+    void insertIntoGrid(IGenericNode *p);
+    void removeFromGrid(IGenericNode *p);
+    void rebuildGrid();
+    template<typename Visitor> void forEachCandidate(IGenericNode *p, Visitor visit) const;
 
 public:
     ChannelController();
@@ -62,6 +107,8 @@ public:
     static ChannelController *getInstance();
     virtual void addGenericNode(IGenericNode *p);
     virtual void removeGenericNode(IGenericNode *p);
+    virtual void updateGenericNode(IGenericNode *p);
+    std::vector<IGenericNode *> getNeighbors(IGenericNode *p) const;
     virtual void refreshDisplay() const override;
 };
 
@@ -31,13 +31,7 @@ ChargeAlgorithmCCCV::ChargeAlgorithmCCCV(double linearGradient, double current,
  */
 double ChargeAlgorithmCCCV::calculateChargeAmount(double remaining, double capacity, double seconds)
 {
-    double secondsLin = fmax(0.0, calculateLinearSeconds(remaining, capacity, 100.0));
-    double amountLin = fmax(0.0, calculateLinearChargeAmount(remaining, capacity, fmin(seconds, secondsLin)));
-    if (secondsLin > seconds) {
-        return amountLin;
-    }
-    double secondsNonLin = seconds - secondsLin + fmax(0.0, calculateNonLinearSeconds(remaining + amountLin, capacity));
-    return calculateNonLinearChargeAmount(remaining, capacity, secondsNonLin) - amountLin;
+    return chargeAmount(getConstants(capacity), remaining, capacity, seconds);
 }
 
 double ChargeAlgorithmCCCV::getFastChargePercentage(double maxCapacity)
@@ -51,11 +45,7 @@ double ChargeAlgorithmCCCV::getFastChargePercentage(double maxCapacity)
  */
 double ChargeAlgorithmCCCV::calculateChargeTime(double remaining, double capacity, double targetPercentage)
 {
-    double secondsLin = fmax(0.0, calculateLinearSeconds(remaining, capacity, targetPercentage));
-    if (remaining + calculateLinearChargeAmount(remaining, capacity, secondsLin) >= capacity * targetPercentage / 100) {
-        return secondsLin;
-    }
-    return secondsLin + calculateNonLinearSeconds(capacity * targetPercentage / 100, capacity, remaining);
+    return chargeTime(getConstants(capacity), remaining, capacity, targetPercentage);
 }
 
 /*
@@ -83,11 +73,8 @@ double ChargeAlgorithmCCCV::calculateLinearSeconds(double remaining, double capa
  */
 double ChargeAlgorithmCCCV::calculateNonLinearChargeAmount(double remaining, double capacity, double seconds)
 {
-    double S = capacity * (1 + a);
-    double B0 = calculateNonLinearStart(capacity);
-    double k = calculateNonLinearGradient(capacity);
-    //
-    double B_of_t = S - (S - B0) * pow(eulerConstant, ((-1) * k * seconds));
+    const CapacityConstants& constants = getConstants(capacity);
+    double B_of_t = constants.S - (constants.S - constants.B0) * exp((-1) * constants.k * seconds);
 
     //HACK factor for 8.0 A: 1.2
     return (B_of_t - remaining) * 1.2;
@@ -105,9 +92,7 @@ double ChargeAlgorithmCCCV::calculateNonLinearSeconds(double targetAmount, doubl
  */
 double ChargeAlgorithmCCCV::calculateNonLinearSeconds(double targetAmount, double capacity)
 {
-    double zaehler = capacity * (a + 1) - targetAmount;
-    double nenner = capacity * (a + 1) - calculateNonLinearStart(capacity);
-    return fmax(0.0, log(zaehler / nenner) / (-calculateNonLinearGradient(capacity)));
+    return nonLinearSeconds(getConstants(capacity), targetAmount);
 }
 
 /*
@@ -115,7 +100,7 @@ double ChargeAlgorithmCCCV::calculateNonLinearSeconds(double targetAmount, doubl
  */
 double ChargeAlgorithmCCCV::calculateNonLinearStart(double capacity)
 {
-    return capacity * getFastChargePercentage(capacity) / 100;
+    return getConstants(capacity).B0;
 }
 
 /*
@@ -123,6 +108,61 @@ double ChargeAlgorithmCCCV::calculateNonLinearStart(double capacity)
  */
 double ChargeAlgorithmCCCV::calculateNonLinearGradient(double capacity)
 {
-    return linearGradient * current / (capacity * (a + 0.0291 * current));
+    return getConstants(capacity).k;
+}
+
+/*
+ * The constants only depend on the capacity and the algorithm parameters.
+ * They are calculated once per capacity, the setters clear the cache.
+ */
+const ChargeAlgorithmCCCV::CapacityConstants& ChargeAlgorithmCCCV::getConstants(double capacity)
+{
+    auto it = constantsCache.find(capacity);
+    if (it != constantsCache.end()) return it->second;
+
+    CapacityConstants constants;
+    constants.S = capacity * (1 + a);
+    constants.B0 = capacity * getFastChargePercentage(capacity) / 100;
+    constants.k = linearGradient * current / (capacity * (a + 0.0291 * current));
+    return constantsCache[capacity] = constants;
+}
+
+/*
+ * calculateChargeAmount() with given constants
+ */
+double ChargeAlgorithmCCCV::chargeAmount(const CapacityConstants& constants, double remaining, double capacity, double seconds) const
+{
+    double linearRate = current * linearGradient;
+    double secondsLin = fmax(0.0, (fmin(capacity, constants.B0) - remaining) / linearRate);
+    double amountLin = fmax(0.0, fmin(fmax(0.0, constants.B0 - remaining), fmin(seconds, secondsLin) * linearRate));
+    if (secondsLin > seconds) {
+        return amountLin;
+    }
+    double secondsNonLin = seconds - secondsLin + fmax(0.0, nonLinearSeconds(constants, remaining + amountLin));
+    double B_of_t = constants.S - (constants.S - constants.B0) * exp((-1) * constants.k * secondsNonLin);
+    return (B_of_t - remaining) * 1.2 - amountLin;
 }
 
+/*
+ * calculateChargeTime() with given constants
+ */
+double ChargeAlgorithmCCCV::chargeTime(const CapacityConstants& constants, double remaining, double capacity, double targetPercentage) const
+{
+    double linearRate = current * linearGradient;
+    double target = capacity * targetPercentage / 100;
+    double secondsLin = fmax(0.0, (fmin(target, constants.B0) - remaining) / linearRate);
+    if (remaining + fmin(fmax(0.0, constants.B0 - remaining), secondsLin * linearRate) >= target) {
+        return secondsLin;
+    }
+    return secondsLin + nonLinearSeconds(constants, target) - nonLinearSeconds(constants, remaining);
+}
+
+/*
+ * calculateNonLinearSeconds(targetAmount, capacity) with given constants
+ */
+double ChargeAlgorithmCCCV::nonLinearSeconds(const CapacityConstants& constants, double targetAmount) const
+{
+    double zaehler = constants.S - targetAmount;
+    double nenner = constants.S - constants.B0;
+    return fmax(0.0, log(zaehler / nenner) / (-constants.k));
+}
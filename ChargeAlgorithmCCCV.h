@@ -18,6 +18,7 @@
 
 #include <iostream>
 #include <cmath>
+#include <unordered_map>
 #include "IChargeAlgorithm.h"
 
 class ChargeAlgorithmCCCV : public IChargeAlgorithm {
@@ -35,6 +36,7 @@ public:
     void setA(double a)
     {
         this->a = a;
+        constantsCache.clear();
     }
 
     double getLinearGradient() const
@@ -45,6 +47,7 @@ public:
     void setLinearGradient(double linearGradient)
     {
         this->linearGradient = linearGradient;
+        constantsCache.clear();
     }
 
     double getCurrent() const
@@ -55,6 +58,7 @@ public:
     void setCurrent(double current)
     {
         this->current = current;
+        constantsCache.clear();
     }
 
 protected:
@@ -64,6 +68,20 @@ protected:
     double current;
     int fastChargePercentage = 80;
 
+    /**
+     * Per capacity constants of the charge curve: saturation S, start of phase 2 B0 and gradient k of phase 2
+     */
+    struct CapacityConstants {
+        double S;
+        double B0;
+        double k;
+    };
+    std::unordered_map<double, CapacityConstants> constantsCache;
+    const CapacityConstants& getConstants(double capacity);
+    double chargeAmount(const CapacityConstants& constants, double remaining, double capacity, double seconds) const;
+    double chargeTime(const CapacityConstants& constants, double remaining, double capacity, double targetPercentage) const;
+    double nonLinearSeconds(const CapacityConstants& constants, double targetAmount) const;
+
     double calculateLinearChargeAmount(double remaining, double capacity, double seconds);
     double calculateNonLinearChargeAmount(double remaining, double capacity, double seconds);
     double calculateLinearSeconds(double remaining, double capacity, double targetPercentage);
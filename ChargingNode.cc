@@ -13,8 +13,11 @@
 // along with this program.  If not, see http://www.gnu.org/licenses/.
 //
 
-#ifdef WITH_OSG
+#include <algorithm>
+#include <queue>
 #include "ChargingNode.h"
+#include "Profiling.h"
+#include "MessagePool.h"
 
 #include "msgs/ForecastPointInTimeRequest_m.h"
 #include "msgs/ForecastTargetRequest_m.h"
@@ -32,6 +35,8 @@ ChargingNode::ChargingNode()
 
 ChargingNode::~ChargingNode()
 {
+    if (chargingNodeIndex != nullptr) chargingNodeIndex->remove(this);
+    delete chargeAlgorithm;
 }
 
 void ChargingNode::initialize(int stage)
@@ -46,6 +51,8 @@ void ChargingNode::initialize(int stage)
             this->z = par("posZ");
             this->pitch = 0;
             this->yaw = 0;
+            chargingNodeIndex = &ChargingNodeIndex::getInstance(getParentModule());
+            chargingNodeIndex->add(this);
             break;
         case 1:
             //Initialize energy storage
@@ -63,9 +70,10 @@ void ChargingNode::initialize(int stage)
             //this->chargeAlgorithm = new ChargeAlgorithmCCCV(linearGradient, chargeCurrent, nonLinearPhaseStartPercentage);
             this->chargeAlgorithm = new ChargeAlgorithmCCCVCurrent(chargeCurrent, nonLinearPhaseStartPercentage);
 
+#if defined(WITH_OSG) && defined(WITH_OSGEARTH)
             this->labelNode->setText(getFullName());
             this->sublabelNode->setText("");
-            par("stateSummary").setStringValue("");
+#endif
 
             //WATCH statistical values
             WATCH(usedPower);
@@ -82,11 +90,23 @@ void ChargingNode::finish()
     recordScalar("chargedPower", chargedPower);
     recordScalar("chargedMobileNodes", chargedMobileNodes);
     recordScalar("reservations", reservations);
+    profiling.recordStatistics(this);
 }
 
-ReplacementData* ChargingNode::endOfOperation()
+bool ChargingNode::endOfOperation(ReplacementData& replacementData)
 {
-    return 0;
+    return false;
+}
+
+void ChargingNode::addMemoryUsage(MemoryUsage& usage) const
+{
+    GenericNode::addMemoryUsage(usage);
+    std::string prefix = std::string(getName()) + ".";
+    usage.add(prefix + "module", sizeof(ChargingNode), 1);
+    usage.add(prefix + "spots",
+            MemoryUsage::ofNodes(objectsWaiting) + MemoryUsage::ofDeque(objectsCharging) + MemoryUsage::ofDeque(objectsFinished)
+                    + MemoryUsage::ofNodes(nodesWaiting) + MemoryUsage::ofNodes(waitingByReservation) + MemoryUsage::ofNodes(waitingArrivals)
+                    + MemoryUsage::ofNodes(chargingDoneTimes), objectsWaiting.size() + objectsCharging.size());
 }
 
 void ChargingNode::loadCommands(CommandQueue commands, bool isMission)
@@ -104,18 +124,18 @@ void ChargingNode::refreshDisplay() const
 
 void ChargingNode::handleMessage(cMessage* msg)
 {
-    if (msg->isName("startCharge")) {
+    if (msg->getKind() == MSG_START_CHARGE) {
         EV_INFO << "MobileNode is ready to get charged" << endl;
         MobileNode *mn = check_and_cast<MobileNode*>(msg->getSenderModule());
         appendToObjectsWaiting(mn, 100.0);
 
         if (not active) {
-            msg->setName("update");
+            setMessageKind(msg, MSG_UPDATE);
             scheduleAt(simTime(), msg);
             active = true;
         }
     }
-    else if (msg->isName("reserveSpot")) {
+    else if (msg->getKind() == MSG_RESERVE_SPOT) {
         ReserveSpotMsg *rsmsg = check_and_cast<ReserveSpotMsg*>(msg);
         MobileNode *mn = check_and_cast<MobileNode*>(msg->getSenderModule());
         appendToObjectsWaiting(mn, rsmsg->getTargetPercentage(), simTime(), rsmsg->getEstimatedArrival(), rsmsg->getConsumptionTillArrival());
@@ -123,7 +143,7 @@ void ChargingNode::handleMessage(cMessage* msg)
         EV_INFO << "MobileNode " << mn->getFullName() << " is on the way to CS. Spot reserved for: " << rsmsg->getEstimatedArrival() << endl;
 
         if (not active) {
-            msg->setName("update");
+            setMessageKind(msg, MSG_UPDATE);
             scheduleAt(simTime(), msg);
             active = true;
         }
@@ -132,11 +152,11 @@ void ChargingNode::handleMessage(cMessage* msg)
             msg = nullptr;
         }
     }
-    else if (msg->isName("forecastTargetRequest")) {
+    else if (msg->getKind() == MSG_FORECAST_TARGET_REQUEST) {
         ForecastTargetRequest *ftmsg = check_and_cast<ForecastTargetRequest *>(msg);
         double forecastDuration = getForecastRemainingToTarget(ftmsg->getRemaining(), ftmsg->getCapacity(), ftmsg->getTargetPercentage());
 
-        ForecastResponse *frmsg = new ForecastResponse("forecastResponse");
+        ForecastResponse *frmsg = new ForecastResponse("forecastResponse", MSG_FORECAST_RESPONSE);
         frmsg->setPointInTime(simTime() + forecastDuration);
         frmsg->setReachedPercentage(ftmsg->getTargetPercentage());
         send(frmsg, getOutputGateTo(frmsg->getSenderModule()));
@@ -144,11 +164,11 @@ void ChargingNode::handleMessage(cMessage* msg)
         delete msg;
         msg = nullptr;
     }
-    else if (msg->isName("forecastPointInTimeRequest")) {
+    else if (msg->getKind() == MSG_FORECAST_POINT_IN_TIME_REQUEST) {
         ForecastPointInTimeRequest *fpitmsg = check_and_cast<ForecastPointInTimeRequest *>(msg);
         double forecastPercentage = getForecastRemainingToPointInTime(fpitmsg->getRemaining(), fpitmsg->getCapacity(), fpitmsg->getPointInTime());
 
-        ForecastResponse *frmsg = new ForecastResponse("forecastResponse");
+        ForecastResponse *frmsg = new ForecastResponse("forecastResponse", MSG_FORECAST_RESPONSE);
         frmsg->setPointInTime(fpitmsg->getPointInTime());
         frmsg->setReachedPercentage(forecastPercentage);
         send(frmsg, getOutputGateTo(frmsg->getSenderModule()));
@@ -156,17 +176,18 @@ void ChargingNode::handleMessage(cMessage* msg)
         delete msg;
         msg = nullptr;
     }
-    else if (msg->isName("mobileNodeRequest")) {
+    else if (msg->getKind() == MSG_MOBILE_NODE_REQUEST) {
         MobileNodeRequest *mnmsg = check_and_cast<MobileNodeRequest *>(msg);
         updateState();
         MobileNode* sufficientNode = getSufficientlyChargedNode(mnmsg->getRemaining());
 
-        MobileNodeResponse *answerMsg = new MobileNodeResponse("mobileNodeResponse");
+        MobileNodeResponse *answerMsg = MessagePool::getInstance().acquire<MobileNodeResponse>(MSG_MOBILE_NODE_RESPONSE);
+        if (answerMsg->getOwner() != this) take(answerMsg);
         if (sufficientNode != nullptr) {
             answerMsg->setNodeFound(true);
             answerMsg->setMobileNodeIndex(sufficientNode->getIndex());
-            answerMsg->setCapacity(sufficientNode->getBattery()->getCapacity());
-            answerMsg->setRemaining(sufficientNode->getBattery()->getRemaining());
+            answerMsg->setCapacity(sufficientNode->getExtrapolatedBattery().getCapacity());
+            answerMsg->setRemaining(sufficientNode->getExtrapolatedBattery().getRemaining());
         }
         else {
             answerMsg->setNodeFound(false);
@@ -174,10 +195,10 @@ void ChargingNode::handleMessage(cMessage* msg)
 
         send(answerMsg, getOutputGateTo(msg->getSenderModule()));
 
-        delete msg;
+        MessagePool::getInstance().release(msg);
         msg = nullptr;
     }
-    else if (msg->isName("mobileNodeExit")) {
+    else if (msg->getKind() == MSG_MOBILE_NODE_EXIT) {
         MobileNode* sender = check_and_cast<MobileNode*>(msg->getSenderModule());
         removeFromChargingNode(sender);
         updateState();
@@ -201,6 +222,7 @@ void ChargingNode::initializeState()
 
 void ChargingNode::updateState()
 {
+    PROFILE_MODULE_SCOPE(profiling, "ChargingNode::updateState");
     if (battery.isEmpty()) {
         EV_WARN << "The battery of the Charging Station is exhausted!";
         return;
@@ -211,26 +233,22 @@ void ChargingNode::updateState()
     fillChargingSpots();
     rearrangeChargingSpots();
 
-    UpdateChargingMsg* updateMsg = new UpdateChargingMsg("chargingUpdate");
-    std::string update("");
+    if (objectsCharging.empty()) return;
 
-    for (auto it = objectsCharging.cbegin(); it != objectsCharging.cend(); ++it) {
-        MobileNode* node = (*it)->getNode();
-        Battery* battery = node->getBattery();
-        update.append(std::to_string(node->getIndex()));
-        update.append(",");
-        update.append(std::to_string(battery->getRemaining()));
-        update.append(",");
-        update.append(std::to_string(battery->getCapacity()));
-        update.append(";");
-    }
-    if (update.empty()) {
-        delete updateMsg;
-    }
-    else {
-        updateMsg->setUpdate(update.c_str());
-        send(updateMsg, "gate$o", 0);
+    UpdateChargingMsg* updateMsg = MessagePool::getInstance().acquire<UpdateChargingMsg>(MSG_CHARGING_UPDATE);
+    if (updateMsg->getOwner() != this) take(updateMsg);
+    updateMsg->setEntriesArraySize(objectsCharging.size());
+    for (unsigned int k = 0; k < objectsCharging.size(); k++) {
+        MobileNode* node = objectsCharging[k].getNode();
+        Battery battery = node->getExtrapolatedBattery();
+        ChargingUpdateEntry entry;
+        entry.nodeIndex = node->getIndex();
+        entry.remaining = battery.getRemaining();
+        entry.capacity = battery.getCapacity();
+        entry.status = SPOT_CHARGING;
+        updateMsg->setEntries(k, entry);
     }
+    send(updateMsg, "gate$o", 0);
 }
 
 bool ChargingNode::isCommandCompleted()
@@ -249,17 +267,14 @@ double ChargingNode::nextNeededUpdate()
     simtime_t currentTime = simTime();
     double nextEvent = -1;
     // get time when the next object is successfully charged
-    for (unsigned int i = 0; i < objectsCharging.size(); i++) {
-        if (objectsCharging[i]->getPointInTimeWhenDone().dbl() - currentTime.dbl() < nextEvent || nextEvent == -1) {
-            nextEvent = objectsCharging[i]->getPointInTimeWhenDone().dbl() - currentTime.dbl();
-        }
+    if (not chargingDoneTimes.empty()) {
+        nextEvent = (*chargingDoneTimes.begin() - currentTime).dbl();
     }
 
     // get next (future) arrival time for reservations
-    for (unsigned int i = 0; i < objectsWaiting.size(); i++) {
-        if ((objectsWaiting[i]->getEstimatedArrival() < nextEvent && objectsWaiting[i]->getEstimatedArrival() >= simTime()) || nextEvent == -1) {
-            nextEvent = objectsWaiting[i]->getPointInTimeWhenDone().dbl() - currentTime.dbl();
-        }
+    auto nextArrival = waitingArrivals.upper_bound(currentTime);
+    if (nextArrival != waitingArrivals.end() && ((*nextArrival - currentTime).dbl() < nextEvent || nextEvent == -1)) {
+        nextEvent = (*nextArrival - currentTime).dbl();
     }
 
     return (nextEvent > 0) ? nextEvent : (timeStep ? timeStep : 10);
@@ -302,24 +317,24 @@ MobileNode* ChargingNode::getSufficientlyChargedNode(double current)
             highestChargedNode = objectsFinished[i];
         }
     }
-    for (unsigned int i = 0; i < objectsWaiting.size(); i++) {
-        if (checkForSufficientlyChargedNode(objectsWaiting[i]->getNode(), sufficientlyChargedNode, current)) {
-            sufficientlyChargedNode = objectsWaiting[i]->getNode();
+    for (auto it = objectsWaiting.begin(); it != objectsWaiting.end(); it++) {
+        if (checkForSufficientlyChargedNode(it->getNode(), sufficientlyChargedNode, current)) {
+            sufficientlyChargedNode = it->getNode();
         }
-        if (checkForHighestChargedNode(objectsWaiting[i]->getNode(), highestChargedNode)) {
-            highestChargedNode = objectsWaiting[i]->getNode();
+        if (checkForHighestChargedNode(it->getNode(), highestChargedNode)) {
+            highestChargedNode = it->getNode();
         }
     }
     for (unsigned int i = 0; i < objectsCharging.size(); i++) {
-        if (checkForSufficientlyChargedNode(objectsCharging[i]->getNode(), sufficientlyChargedNode, current)) {
-            sufficientlyChargedNode = objectsCharging[i]->getNode();
+        if (checkForSufficientlyChargedNode(objectsCharging[i].getNode(), sufficientlyChargedNode, current)) {
+            sufficientlyChargedNode = objectsCharging[i].getNode();
         }
-        if (checkForHighestChargedNode(objectsCharging[i]->getNode(), highestChargedNode)) {
-            highestChargedNode = objectsCharging[i]->getNode();
+        if (checkForHighestChargedNode(objectsCharging[i].getNode(), highestChargedNode)) {
+            highestChargedNode = objectsCharging[i].getNode();
         }
     }
     if (sufficientlyChargedNode) {
-        return (sufficientlyChargedNode->getBattery()->getRemaining() > current) ? sufficientlyChargedNode : highestChargedNode;
+        return (sufficientlyChargedNode->getExtrapolatedBattery().getRemaining() > current) ? sufficientlyChargedNode : highestChargedNode;
     }
     return nullptr;
 }
@@ -329,7 +344,7 @@ bool ChargingNode::checkForSufficientlyChargedNode(MobileNode* nextNode, MobileN
     if (sufficientlyChargedNode == nullptr) {
         return true;
     }
-    if (nextNode->getBattery()->getRemaining() > current && nextNode->getBattery()->getRemaining() < sufficientlyChargedNode->getBattery()->getRemaining()) {
+    if (nextNode->getExtrapolatedBattery().getRemaining() > current && nextNode->getExtrapolatedBattery().getRemaining() < sufficientlyChargedNode->getExtrapolatedBattery().getRemaining()) {
         return true;
     }
     return false;
@@ -340,7 +355,7 @@ bool ChargingNode::checkForHighestChargedNode(MobileNode* nextNode, MobileNode*
     if (highestChargedNode == nullptr) {
         return true;
     }
-    if (nextNode->getBattery()->getRemaining() > highestChargedNode->getBattery()->getRemaining()) {
+    if (nextNode->getExtrapolatedBattery().getRemaining() > highestChargedNode->getExtrapolatedBattery().getRemaining()) {
         return true;
     }
     return false;
@@ -352,20 +367,46 @@ bool ChargingNode::checkForHighestChargedNode(MobileNode* nextNode, MobileNode*
  */
 void ChargingNode::removeFromChargingNode(MobileNode* mobileNode)
 {
-    for (unsigned int i = 0; i < objectsFinished.size(); i++) {
-        if (objectsFinished[i] == mobileNode) {
-            objectsFinished.erase(objectsFinished.begin() + i);
-        }
+    PROFILE_MODULE_SCOPE(profiling, "ChargingNode::removeFromChargingNode");
+    objectsFinished.erase(std::remove(objectsFinished.begin(), objectsFinished.end(), mobileNode), objectsFinished.end());
+    auto waiting = nodesWaiting.find(mobileNode);
+    if (waiting != nodesWaiting.end()) {
+        eraseWaiting(waiting->second.element);
     }
-    for (unsigned int i = 0; i < objectsWaiting.size(); i++) {
-        if (objectsWaiting[i]->getNode() == mobileNode) {
-            objectsWaiting.erase(objectsWaiting.begin() + i);
-        }
+    auto charging = std::find_if(objectsCharging.begin(), objectsCharging.end(), [mobileNode](const ChargingNodeSpotElement& element) {
+        return element.getNode() == mobileNode;
+    });
+    if (charging != objectsCharging.end()) eraseCharging(charging);
+}
+
+/**
+ * Indices of the nodes in the charging spots and the waiting queue, in this order, e.g. for a warm start snapshot.
+ */
+std::vector<int32_t> ChargingNode::getQueuedNodeIndices() const
+{
+    std::vector<int32_t> indices;
+    for (auto it = objectsCharging.begin(); it != objectsCharging.end(); it++) {
+        indices.push_back(it->getNode()->getIndex());
     }
-    for (unsigned int i = 0; i < objectsCharging.size(); i++) {
-        if (objectsCharging[i]->getNode() == mobileNode) {
-            objectsCharging.erase(objectsCharging.begin() + i);
-        }
+    for (auto it = objectsWaiting.begin(); it != objectsWaiting.end(); it++) {
+        indices.push_back(it->getNode()->getIndex());
+    }
+    return indices;
+}
+
+/**
+ * Queues the nodes of a warm start snapshot in the given order, as if they had reserved a spot now.
+ * Fully charged nodes are skipped.
+ */
+void ChargingNode::restoreQueue(const std::vector<MobileNode*>& nodes)
+{
+    Enter_Method_Silent();
+    for (auto it = nodes.begin(); it != nodes.end(); it++) {
+        if (not (*it)->getExtrapolatedBattery().isFull()) appendToObjectsWaiting(*it, 100.0);
+    }
+    if (not active && not objectsWaiting.empty()) {
+        scheduleAt(simTime(), new cMessage("update", MSG_UPDATE));
+        active = true;
     }
 }
 
@@ -377,6 +418,7 @@ void ChargingNode::removeFromChargingNode(MobileNode* mobileNode)
 void ChargingNode::appendToObjectsWaiting(MobileNode* mobileNode, double targetPercentage, simtime_t reservationTime, simtime_t estimatedArrival,
         double consumption)
 {
+    PROFILE_MODULE_SCOPE(profiling, "ChargingNode::appendToObjectsWaiting");
     // check if the waiting queue size would be exceeded
     if (objectsWaiting.size() >= spotsWaiting && spotsWaiting != 0) {
         EV_INFO << "All spots for waiting (" << spotsWaiting << ") are already taken." << endl;
@@ -390,20 +432,20 @@ void ChargingNode::appendToObjectsWaiting(MobileNode* mobileNode, double targetP
 
     // generate a new waiting element with estimated charge and waiting times
     // substract consumption which will occur between reservation and the charging process
-    double chargeTime = chargeAlgorithm->calculateChargeTime(mobileNode->getBattery()->getRemaining() - consumption, mobileNode->getBattery()->getCapacity(),
+    double chargeTime = chargeAlgorithm->calculateChargeTime(mobileNode->getExtrapolatedBattery().getRemaining() - consumption, mobileNode->getExtrapolatedBattery().getCapacity(),
             targetPercentage);
     ASSERT(chargeTime > 0);
-    ChargingNodeSpotElement* element = new ChargingNodeSpotElement(mobileNode, chargeTime, getEstimatedWaitingSeconds(), targetPercentage);
+    ChargingNodeSpotElement element(mobileNode, chargeTime, getEstimatedWaitingSeconds(), targetPercentage);
 
     // set estimatedArrival and reservationTime if not 0, otherwise simTime() will be used as default value
     if (!estimatedArrival.isZero()) {
-        element->setEstimatedArrival(estimatedArrival);
+        element.setEstimatedArrival(estimatedArrival);
     }
     if (!reservationTime.isZero()) {
-        element->setReservationTime(reservationTime);
+        element.setReservationTime(reservationTime);
     }
 
-    objectsWaiting.push_back(element);
+    insertWaiting(objectsWaiting.end(), element);
     EV_INFO << "MobileNode " << mobileNode->getFullName() << " got appended to a waiting spot." << endl;
 }
 
@@ -412,68 +454,120 @@ void ChargingNode::appendToObjectsWaiting(MobileNode* mobileNode, double targetP
  */
 bool ChargingNode::isInWaitingQueue(MobileNode* mobileNode)
 {
-    std::deque<ChargingNodeSpotElement*>::iterator objectWaiting = objectsWaiting.begin();
-    while (objectWaiting != objectsWaiting.end()) {
-        if ((*objectWaiting)->getNode() == mobileNode) {
-            return true;
+    return nodesWaiting.count(mobileNode) > 0;
+}
+
+/**
+ * Inserts an element into the waiting queue before the given position and into its indices.
+ * @return WaitingQueue::iterator to the inserted element
+ */
+ChargingNode::WaitingQueue::iterator ChargingNode::insertWaiting(WaitingQueue::iterator position, const ChargingNodeSpotElement& element)
+{
+    WaitingQueue::iterator inserted = objectsWaiting.insert(position, element);
+    WaitingIndexEntry entry;
+    entry.element = inserted;
+    entry.byReservation = waitingByReservation.emplace(element.getReservationTime(), inserted);
+    entry.arrival = waitingArrivals.insert(element.getEstimatedArrival());
+    nodesWaiting[element.getNode()] = entry;
+    return inserted;
+}
+
+/**
+ * Erases an element from the waiting queue and from its indices.
+ * @return WaitingQueue::iterator to the element following the erased one
+ */
+ChargingNode::WaitingQueue::iterator ChargingNode::eraseWaiting(WaitingQueue::iterator element)
+{
+    auto entry = nodesWaiting.find(element->getNode());
+    ASSERT(entry != nodesWaiting.end());
+    waitingByReservation.erase(entry->second.byReservation);
+    waitingArrivals.erase(entry->second.arrival);
+    nodesWaiting.erase(entry);
+    return objectsWaiting.erase(element);
+}
+
+/**
+ * Occupies a charging spot, the pointInTimeWhenDone of the element needs to be set.
+ */
+void ChargingNode::addCharging(const ChargingNodeSpotElement& element)
+{
+    objectsCharging.push_back(element);
+    chargingDoneTimes.insert(element.getPointInTimeWhenDone());
+}
+
+/**
+ * Frees a charging spot.
+ * @return std::deque<ChargingNodeSpotElement>::iterator to the element following the erased one
+ */
+std::deque<ChargingNodeSpotElement>::iterator ChargingNode::eraseCharging(std::deque<ChargingNodeSpotElement>::iterator element)
+{
+    chargingDoneTimes.erase(chargingDoneTimes.find(element->getPointInTimeWhenDone()));
+    return objectsCharging.erase(element);
+}
+
+/*
+ * @return bool true when the remaining energy of the given mobileNode is not above the fastCharge percentage of the chargeAlgorithm
+ */
+bool ChargingNode::isFastChargeEligible(MobileNode* mobileNode)
+{
+    return static_cast<double>(mobileNode->getExtrapolatedBattery().getRemainingPercentage())
+            <= chargeAlgorithm->getFastChargePercentage(mobileNode->getExtrapolatedBattery().getCapacity());
+}
+
+/**
+ * The physically present elements of the waiting queue in the order they get charging spots.
+ * They are ordered by their reservationTime, when fastCharge is enabled the objects eligible for it come first.
+ * @return std::vector<WaitingQueue::iterator> of the physically present elements
+ */
+std::vector<ChargingNode::WaitingQueue::iterator> ChargingNode::getPresentWaitingObjects(bool fastCharge)
+{
+    PROFILE_MODULE_SCOPE(profiling, "ChargingNode::getPresentWaitingObjects");
+    std::vector<WaitingQueue::iterator> present;
+    for (auto it = waitingByReservation.begin(); it != waitingByReservation.end(); it++) {
+        if (isPhysicallyPresent(it->second->getNode())) {
+            present.push_back(it->second);
         }
-        objectWaiting++;
     }
-    return false;
+    if (fastCharge) {
+        std::stable_partition(present.begin(), present.end(), [this](WaitingQueue::iterator element) {
+            return isFastChargeEligible(element->getNode());
+        });
+    }
+    return present;
 }
 
 /**
  * Elements in the waiting queue get prioritized by their reservationTime.
  * When fastCharge is enbabled the top priority is that the object has less energy then the chargeAlgorithm is advertising as fastCharge.
  * Furthermore they need to be physically at the ChargingNode.
- * @return std::deque<ChargingNodeSpotElement*>::iterator to the next element in waiting queue which is physically present
+ * @return WaitingQueue::iterator to the next element in waiting queue which is physically present, end() if there is none
  */
-std::deque<ChargingNodeSpotElement*>::iterator ChargingNode::getNextWaitingObjectIterator(bool fastCharge)
+ChargingNode::WaitingQueue::iterator ChargingNode::getNextWaitingObjectIterator(bool fastCharge)
 {
-    std::deque<ChargingNodeSpotElement*>::iterator next = objectsWaiting.end();
-    std::deque<ChargingNodeSpotElement*>::iterator objectWaitingIt = objectsWaiting.begin();
-    while (objectWaitingIt != objectsWaiting.end()) {
-        if (not isPhysicallyPresent((*objectWaitingIt)->getNode())) {
-            objectWaitingIt++;
+    PROFILE_MODULE_SCOPE(profiling, "ChargingNode::getNextWaitingObjectIterator");
+    // walk the reservation order until the first present object (eligible for fast charge, if enabled)
+    WaitingQueue::iterator nextAny = objectsWaiting.end();
+    for (auto it = waitingByReservation.begin(); it != waitingByReservation.end(); it++) {
+        if (not isPhysicallyPresent(it->second->getNode())) {
             continue;
         }
-        if (fastCharge
-                && static_cast<double>((*objectWaitingIt)->getNode()->getBattery()->getRemainingPercentage())
-                        > chargeAlgorithm->getFastChargePercentage((*objectWaitingIt)->getNode()->getBattery()->getCapacity())) {
-            objectWaitingIt++;
-            continue;
+        if (not fastCharge || isFastChargeEligible(it->second->getNode())) {
+            return it->second;
         }
-        if (next == objectsWaiting.end()
-                || ((*objectWaitingIt)->getReservationTime() < (*next)->getReservationTime() && (*objectWaitingIt)->getEstimatedArrival() <= simTime())) {
-            next = objectWaitingIt;
+        if (nextAny == objectsWaiting.end()) {
+            nextAny = it->second;
         }
-        objectWaitingIt++;
     }
-    if (fastCharge && next == objectsWaiting.end()) {
-        return getNextWaitingObjectIterator(false);
-    }
-    return next;
+    return nextAny;
 }
 
 bool ChargingNode::isPhysicallyPresent(MobileNode* mobileNode)
 {
-    return (round(mobileNode->getX()) == round(getX()) && round(mobileNode->getY()) == round(getY()) && round(mobileNode->getZ()) == round(getZ()));
-}
-
-int ChargingNode::numberWaitingAndPhysicallyPresent()
-{
-    int result = 0;
-    if (objectsWaiting.size() == 0) {
-        return result;
-    }
-    std::deque<ChargingNodeSpotElement*>::iterator objectWaitingIt = objectsWaiting.begin();
-    while (objectWaitingIt != objectsWaiting.end()) {
-        if (isPhysicallyPresent((*objectWaitingIt)->getNode())) {
-            result++;
-        }
-        objectWaitingIt++;
-    }
-    return result;
+    GenericNode::refreshExtrapolatedPositions();
+    const NodeKinematics& kinematics = NodeKinematics::getInstance();
+    int slot = mobileNode->getKinematicsSlot();
+    return (round(kinematics.getX()[slot]) == round(getX()) && round(kinematics.getY()[slot]) == round(getY())
+            && round(kinematics.getZ()[slot]) == round(getZ()));
 }
 
 /**
@@ -482,8 +576,8 @@ int ChargingNode::numberWaitingAndPhysicallyPresent()
  */
 double ChargingNode::calculateSecondsToNextEvent(MobileNode* mn, bool prioritizeFastCharge)
 {
-    double remaining = mn->getBattery()->getRemaining();
-    double capacity = mn->getBattery()->getCapacity();
+    double remaining = mn->getExtrapolatedBattery().getRemaining();
+    double capacity = mn->getExtrapolatedBattery().getCapacity();
     double fastChargePercentage = chargeAlgorithm->getFastChargePercentage(capacity);
     double targetPercentage = fastChargePercentage;
     if (!prioritizeFastCharge || remaining / capacity * 100 >= fastChargePercentage) {
@@ -497,26 +591,25 @@ double ChargingNode::calculateSecondsToNextEvent(MobileNode* mn, bool prioritize
  */
 void ChargingNode::fillChargingSpots()
 {
-    // when there are no waiting objects, the method does nothing
-    int availableNodes = numberWaitingAndPhysicallyPresent();
-    if (availableNodes == 0) {
+    PROFILE_MODULE_SCOPE(profiling, "ChargingNode::fillChargingSpots");
+    // when there are no free charging spots or no waiting objects, the method does nothing
+    if (spotsCharging <= objectsCharging.size() || objectsWaiting.empty()) {
         return;
     }
 
-    // get the next waiting object
-    std::deque<ChargingNodeSpotElement*>::iterator nextWaitingObject = getNextWaitingObjectIterator(prioritizeFastCharge);
+    // the present waiting objects in priority order, positions do not change meanwhile
+    std::vector<WaitingQueue::iterator> presentObjects = getPresentWaitingObjects(prioritizeFastCharge);
 
     // loop through empty charging spots and fill them with waiting objects
-    while (spotsCharging > objectsCharging.size() && availableNodes > 0) {
-        EV_INFO << (*nextWaitingObject)->getNode()->getFullName() << " is added to charging spot." << endl;
-        (*nextWaitingObject)->setPointInTimeWhenChargingStarted(simTime());
+    for (auto it = presentObjects.begin(); it != presentObjects.end() && spotsCharging > objectsCharging.size(); it++) {
+        ChargingNodeSpotElement element = **it;
+        EV_INFO << element.getNode()->getFullName() << " is added to charging spot." << endl;
+        element.setPointInTimeWhenChargingStarted(simTime());
         // set the point in time when the next event needs to be executed
-        double secondsToNextEvent = calculateSecondsToNextEvent((*nextWaitingObject)->getNode(), prioritizeFastCharge);
-        (*nextWaitingObject)->setPointInTimeWhenDone(simTime() + secondsToNextEvent);
-        objectsCharging.push_back(*nextWaitingObject);
-        objectsWaiting.erase(nextWaitingObject);
-        nextWaitingObject = getNextWaitingObjectIterator(prioritizeFastCharge);
-        availableNodes = numberWaitingAndPhysicallyPresent();
+        double secondsToNextEvent = calculateSecondsToNextEvent(element.getNode(), prioritizeFastCharge);
+        element.setPointInTimeWhenDone(simTime() + secondsToNextEvent);
+        eraseWaiting(*it);
+        addCharging(element);
     }
 }
 
@@ -525,23 +618,25 @@ void ChargingNode::fillChargingSpots()
  */
 void ChargingNode::clearChargingSpots()
 {
-    for (unsigned int i = 0; i < objectsCharging.size(); i++) {
-        if (not this->isPhysicallyPresent(objectsCharging[i]->getNode())) {
-            EV_INFO << objectsCharging[i]->getNode()->getFullName() << " is removed from charging spot - not physically present anymore." << endl;
-            objectsCharging.erase(objectsCharging.begin() + i);
+    PROFILE_MODULE_SCOPE(profiling, "ChargingNode::clearChargingSpots");
+    std::deque<ChargingNodeSpotElement>::iterator it = objectsCharging.begin();
+    while (it != objectsCharging.end()) {
+        if (not this->isPhysicallyPresent(it->getNode())) {
+            EV_INFO << it->getNode()->getFullName() << " is removed from charging spot - not physically present anymore." << endl;
+            it = eraseCharging(it);
             continue;
         }
-        if (objectsCharging[i]->getNode()->getBattery()->getRemainingPercentage() > objectsCharging[i]->getTargetCapacityPercentage()
-                || objectsCharging[i]->getNode()->getBattery()->isFull()) {
-            EV_INFO << objectsCharging[i]->getNode()->getFullName() << " is removed from charging spot - charged to target: "
-                    << objectsCharging[i]->getNode()->getBattery()->getRemainingPercentage() << "/" << objectsCharging[i]->getTargetCapacityPercentage() << "%"
-                    << endl;
+        if (it->getNode()->getExtrapolatedBattery().getRemainingPercentage() > it->getTargetCapacityPercentage() || it->getNode()->getExtrapolatedBattery().isFull()) {
+            EV_INFO << it->getNode()->getFullName() << " is removed from charging spot - charged to target: "
+                    << it->getNode()->getExtrapolatedBattery().getRemainingPercentage() << "/" << it->getTargetCapacityPercentage() << "%" << endl;
             // Push fully charged nodes to the corresponding list
-            objectsFinished.push_back(objectsCharging[i]->getNode());
-            objectsCharging.erase(objectsCharging.begin() + i);
+            objectsFinished.push_back(it->getNode());
+            it = eraseCharging(it);
             // increment the statistics value
             chargedMobileNodes++;
+            continue;
         }
+        it++;
     }
 }
 
@@ -550,40 +645,50 @@ void ChargingNode::clearChargingSpots()
  */
 void ChargingNode::rearrangeChargingSpots()
 {
+    PROFILE_MODULE_SCOPE(profiling, "ChargingNode::rearrangeChargingSpots");
     // this method does nothing when either there is no object charged currently or there is no available waiting object
-    if (objectsCharging.size() < spotsCharging || numberWaitingAndPhysicallyPresent() == 0) {
+    if (objectsCharging.size() < spotsCharging || objectsWaiting.empty()) {
         return;
     }
 
     // get the next waiting object
-    std::deque<ChargingNodeSpotElement*>::iterator nextWaitingObject = getNextWaitingObjectIterator(prioritizeFastCharge);
+    WaitingQueue::iterator nextWaitingObject = getNextWaitingObjectIterator(prioritizeFastCharge);
+    if (nextWaitingObject == objectsWaiting.end()) {
+        return;
+    }
 
     // loop through currently used spots and check for earlier reservations
     // when an earlier reservation time occurs, throw out the currently charged node and push it back to the waiting objects
-    std::deque<ChargingNodeSpotElement*>::iterator objectChargingIt = objectsCharging.begin();
+    std::deque<ChargingNodeSpotElement>::iterator objectChargingIt = objectsCharging.begin();
     while (objectChargingIt != objectsCharging.end()) {
-        simtime_t chargingObjResTime = (*objectChargingIt)->getReservationTime();
-        simtime_t waitingObjResTime = (*nextWaitingObject)->getReservationTime();
-        double waitingObjRemainingP = static_cast<double>((*nextWaitingObject)->getNode()->getBattery()->getRemainingPercentage());
-        double chargingObjRemainingP = static_cast<double>((*objectChargingIt)->getNode()->getBattery()->getRemainingPercentage());
-        double waitingObjFastChargeP = getChargeAlgorithm()->getFastChargePercentage((*nextWaitingObject)->getNode()->getBattery()->getCapacity());
-        double chagingObjFastChargeP = getChargeAlgorithm()->getFastChargePercentage((*objectChargingIt)->getNode()->getBattery()->getCapacity());
+        simtime_t chargingObjResTime = objectChargingIt->getReservationTime();
+        simtime_t waitingObjResTime = nextWaitingObject->getReservationTime();
+        double waitingObjRemainingP = static_cast<double>(nextWaitingObject->getNode()->getExtrapolatedBattery().getRemainingPercentage());
+        double chargingObjRemainingP = static_cast<double>(objectChargingIt->getNode()->getExtrapolatedBattery().getRemainingPercentage());
+        double waitingObjFastChargeP = getChargeAlgorithm()->getFastChargePercentage(nextWaitingObject->getNode()->getExtrapolatedBattery().getCapacity());
+        double chagingObjFastChargeP = getChargeAlgorithm()->getFastChargePercentage(objectChargingIt->getNode()->getExtrapolatedBattery().getCapacity());
         //        EV_DEBUG << "chargingObjResTime " << chargingObjRevTime <<  endl;
         //        EV_DEBUG << "waitingObjResTime " << waitingObjRevTime <<  endl;
         if ((chargingObjResTime > waitingObjResTime && (not prioritizeFastCharge || waitingObjRemainingP < waitingObjFastChargeP))
                 || (prioritizeFastCharge && waitingObjRemainingP < waitingObjFastChargeP && chargingObjRemainingP >= chagingObjFastChargeP)) {
-            ChargingNodeSpotElement* temp = *nextWaitingObject;
-            *nextWaitingObject = *objectChargingIt;
-            *objectChargingIt = temp;
-            (*objectChargingIt)->setPointInTimeWhenChargingStarted(simTime());
+            // the replaced object takes the position of the waiting one in the waiting queue
+            ChargingNodeSpotElement waitingElement = *nextWaitingObject;
+            chargingDoneTimes.erase(chargingDoneTimes.find(objectChargingIt->getPointInTimeWhenDone()));
+            nextWaitingObject = insertWaiting(eraseWaiting(nextWaitingObject), *objectChargingIt);
+            *objectChargingIt = waitingElement;
+            objectChargingIt->setPointInTimeWhenChargingStarted(simTime());
             // set the point in time when the next event needs to be executed
-            double secondsToNextEvent = calculateSecondsToNextEvent((*objectChargingIt)->getNode(), prioritizeFastCharge);
-            (*objectChargingIt)->setPointInTimeWhenDone(simTime() + secondsToNextEvent);
+            double secondsToNextEvent = calculateSecondsToNextEvent(objectChargingIt->getNode(), prioritizeFastCharge);
+            objectChargingIt->setPointInTimeWhenDone(simTime() + secondsToNextEvent);
+            chargingDoneTimes.insert(objectChargingIt->getPointInTimeWhenDone());
 
-            EV_INFO << "MobileNode ID(" << (*nextWaitingObject)->getNode()->getId() << ") charge spot exchanged with ID("
-                    << (*objectChargingIt)->getNode()->getId() << ") waiting spot." << endl;
+            EV_INFO << "MobileNode ID(" << nextWaitingObject->getNode()->getId() << ") charge spot exchanged with ID("
+                    << objectChargingIt->getNode()->getId() << ") waiting spot." << endl;
 
             nextWaitingObject = getNextWaitingObjectIterator(prioritizeFastCharge);
+            if (nextWaitingObject == objectsWaiting.end()) {
+                return;
+            }
         }
         objectChargingIt++;
     }
@@ -594,21 +699,22 @@ void ChargingNode::rearrangeChargingSpots()
  */
 void ChargingNode::chargeAllChargingSpots()
 {
+    PROFILE_MODULE_SCOPE(profiling, "ChargingNode::chargeAllChargingSpots");
     for (unsigned int i = 0; i < objectsCharging.size(); i++) {
-        if (not this->isPhysicallyPresent(objectsCharging[i]->getNode())) {
+        if (not this->isPhysicallyPresent(objectsCharging[i].getNode())) {
             continue;
         }
-        double durationSeconds = (simTime() - std::max(lastUpdate, objectsCharging[i]->getPointInTimeWhenChargingStarted())).dbl();
+        double durationSeconds = (simTime() - std::max(lastUpdate, objectsCharging[i].getPointInTimeWhenChargingStarted())).dbl();
         ASSERT(durationSeconds >= 0);
         if (durationSeconds < 1.e-10) continue;
 
-        double chargeAmount = chargeAlgorithm->calculateChargeAmount(objectsCharging[i]->getNode()->getBattery()->getRemaining(),
-                objectsCharging[i]->getNode()->getBattery()->getCapacity(), durationSeconds);
+        double chargeAmount = chargeAlgorithm->calculateChargeAmount(objectsCharging[i].getNode()->getBattery()->getRemaining(),
+                objectsCharging[i].getNode()->getBattery()->getCapacity(), durationSeconds);
         double chargeMeanCurrent = chargeAmount * 3600 / durationSeconds / 1000;
-        EV_INFO << objectsCharging[i]->getNode()->getFullName() << " charging: " << durationSeconds << "s * " << chargeMeanCurrent << "A = " << chargeAmount
-                << "mAh (now " << objectsCharging[i]->getNode()->getBattery()->getRemainingPercentage() << "%)" << endl;
-        objectsCharging[i]->getNode()->getBattery()->charge(chargeAmount);
-        objectsCharging[i]->getNode()->getCommandExecEngine()->setConsumptionPerSecond((-1) * chargeMeanCurrent);
+        EV_INFO << objectsCharging[i].getNode()->getFullName() << " charging: " << durationSeconds << "s * " << chargeMeanCurrent << "A = " << chargeAmount
+                << "mAh (now " << objectsCharging[i].getNode()->getBattery()->getRemainingPercentage() << "%)" << endl;
+        objectsCharging[i].getNode()->getBattery()->charge(chargeAmount);
+        objectsCharging[i].getNode()->getCommandExecEngine()->setConsumptionPerSecond((-1) * chargeMeanCurrent);
         battery.discharge(chargeAmount / this->chargeEffectivenessPercentage);
         usedPower += chargeAmount / this->chargeEffectivenessPercentage;
         chargedPower += chargeAmount;
@@ -620,19 +726,21 @@ void ChargingNode::chargeAllChargingSpots()
  */
 double ChargingNode::getEstimatedWaitingSeconds()
 {
+    PROFILE_MODULE_SCOPE(profiling, "ChargingNode::getEstimatedWaitingSeconds");
     if (objectsCharging.empty()) return 0;
 
-    std::vector<double> waitingTimes(objectsCharging.size(), 0.0);
+    // min-heap of the remaining seconds per "spot"
+    std::priority_queue<double, std::vector<double>, std::greater<double>> waitingTimes;
 
     for (unsigned int c = 0; c < objectsCharging.size(); c++) {
-        // set array values to the remaining seconds needed for currently charged objects
-        waitingTimes[c] = (objectsCharging[c]->getPointInTimeWhenDone() - simTime()).dbl();
+        // set heap values to the remaining seconds needed for currently charged objects
+        waitingTimes.push((objectsCharging[c].getPointInTimeWhenDone() - simTime()).dbl());
     }
-    for (unsigned int w = 0; w < objectsWaiting.size(); w++) {
+    for (auto it = objectsWaiting.begin(); it != objectsWaiting.end(); it++) {
         // add the estimated charge duration of the next waiting object to "spot" with the smallest duration
-        *std::min_element(waitingTimes.begin(), waitingTimes.end()) += objectsWaiting[w]->getEstimatedChargeDuration();
+        double smallest = waitingTimes.top();
+        waitingTimes.pop();
+        waitingTimes.push(smallest + it->getEstimatedChargeDuration());
     }
-    return *std::min_element(waitingTimes.begin(), waitingTimes.end());
+    return waitingTimes.top();
 }
-
-#endif // WITH_OSG
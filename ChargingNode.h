@@ -16,10 +16,16 @@
 #ifndef CHARGINGNODE_H_
 #define CHARGINGNODE_H_
 
+#include <list>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <vector>
 #include <omnetpp.h>
 #include "Battery.h"
 #include "ChargeAlgorithmCCCV.h"
 #include "ChargeAlgorithmCCCVCurrent.h"
+#include "ChargingNodeIndex.h"
 #include "ChargingNodeSpotElement.h"
 #include "Command.h"
 #include "CommandExecEngine.h"
@@ -50,12 +56,30 @@ protected:
     double chargeEffectivenessPercentage;
     unsigned int spotsWaiting;
     unsigned int spotsCharging;
-    std::deque<ChargingNodeSpotElement*> objectsWaiting;
-    std::deque<ChargingNodeSpotElement*> objectsCharging;
+    typedef std::list<ChargingNodeSpotElement> WaitingQueue;
+    typedef std::multimap<simtime_t, WaitingQueue::iterator> ReservationIndex;
+    struct WaitingIndexEntry {
+        WaitingQueue::iterator element;
+        ReservationIndex::iterator byReservation;
+        std::multiset<simtime_t>::iterator arrival;
+    };
+    // waiting queue in order of appending, iterators stay valid while other elements are erased
+    WaitingQueue objectsWaiting;
+    // priority index of objectsWaiting by reservation time, equal reservation times keep the order of insertion
+    ReservationIndex waitingByReservation;
+    // estimated arrivals of objectsWaiting, the next future one is a needed update
+    std::multiset<simtime_t> waitingArrivals;
+    // membership index of objectsWaiting keyed on node
+    std::unordered_map<MobileNode*, WaitingIndexEntry> nodesWaiting;
+    std::deque<ChargingNodeSpotElement> objectsCharging;
+    // pointInTimeWhenDone of objectsCharging, the smallest is the next needed update
+    std::multiset<simtime_t> chargingDoneTimes;
     std::deque<MobileNode*> objectsFinished;
-    IChargeAlgorithm* chargeAlgorithm;
+    IChargeAlgorithm* chargeAlgorithm = nullptr;
     bool active = false;
     bool prioritizeFastCharge;
+    // index of the region this node registered in
+    ChargingNodeIndex* chargingNodeIndex = nullptr;
 public:
     ChargingNode();
     virtual ~ChargingNode();
@@ -68,11 +92,14 @@ public:
     virtual bool isCommandCompleted() override;
     virtual double nextNeededUpdate() override;
     virtual void collectStatistics() override;
-    virtual ReplacementData* endOfOperation() override;
+    virtual bool endOfOperation(ReplacementData& replacementData) override;
+    virtual void addMemoryUsage(MemoryUsage& usage) const override;
     // Could be moved to private methods, there functionality is externally available via messages
     double getForecastRemainingToTarget(double remaining, double capacity, double targetPercentage = 100.0);
     double getForecastRemainingToPointInTime(double remaining, double capacity, simtime_t pointInTime);
     MobileNode* getSufficientlyChargedNode(double current);
+    std::vector<int32_t> getQueuedNodeIndices() const;
+    void restoreQueue(const std::vector<MobileNode*>& nodes);
     bool checkForSufficientlyChargedNode(MobileNode* nextNode, MobileNode* sufficientlyChargedNode, double current);
     bool checkForHighestChargedNode(MobileNode* nextNode, MobileNode* highestChargedNode);
     // Getters
@@ -109,8 +136,13 @@ protected:
     void appendToObjectsWaiting(MobileNode* mobileNode, double targetPercentage, simtime_t reservationTime = 0, simtime_t estimatedArrival = 0,
             double consumption = 0);
     bool isInWaitingQueue(MobileNode* mobileNode);
-    std::deque<ChargingNodeSpotElement*>::iterator getNextWaitingObjectIterator(bool fastCharge);
-    int numberWaitingAndPhysicallyPresent();
+    WaitingQueue::iterator insertWaiting(WaitingQueue::iterator position, const ChargingNodeSpotElement& element);
+    WaitingQueue::iterator eraseWaiting(WaitingQueue::iterator element);
+    void addCharging(const ChargingNodeSpotElement& element);
+    std::deque<ChargingNodeSpotElement>::iterator eraseCharging(std::deque<ChargingNodeSpotElement>::iterator element);
+    bool isFastChargeEligible(MobileNode* mobileNode);
+    std::vector<WaitingQueue::iterator> getPresentWaitingObjects(bool fastCharge);
+    WaitingQueue::iterator getNextWaitingObjectIterator(bool fastCharge);
     bool isPhysicallyPresent(MobileNode* mobileNode);
     double calculateSecondsToNextEvent(MobileNode* mn, bool prioritizeFastCharge);
     void fillChargingSpots();
@@ -0,0 +1,130 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include "ChargingNodeIndex.h"
+#include "ChargingNode.h"
+
+std::map<int, std::unique_ptr<ChargingNodeIndex>> ChargingNodeIndex::regions;
+
+ChargingNodeIndex& ChargingNodeIndex::getInstance(const omnetpp::cModule *region)
+{
+    std::unique_ptr<ChargingNodeIndex>& instance = regions[region->getId()];
+    if (!instance) instance.reset(new ChargingNodeIndex());
+    return *instance;
+}
+
+void ChargingNodeIndex::add(ChargingNode* cn)
+{
+    if (std::find(chargingNodes.begin(), chargingNodes.end(), cn) != chargingNodes.end()) return;
+    chargingNodes.push_back(cn);
+    dirty = true;
+    revision++;
+}
+
+void ChargingNodeIndex::remove(ChargingNode* cn)
+{
+    auto it = std::find(chargingNodes.begin(), chargingNodes.end(), cn);
+    if (it == chargingNodes.end()) return;
+    chargingNodes.erase(it);
+    dirty = true;
+    revision++;
+}
+
+ChargingNode* ChargingNodeIndex::findNearest(double x, double y, double z, int metric)
+{
+    if (dirty) rebuild();
+    if (root == -1) return nullptr;
+
+    const double query[3] = { x, y, z };
+    int best = -1;
+    double bestDistance = DBL_MAX;
+    search(root, query, metric, best, bestDistance);
+    return tree[best].cn;
+}
+
+/**
+ * Charging nodes are static, their positions are read once per rebuild.
+ */
+void ChargingNodeIndex::rebuild()
+{
+    tree.clear();
+    tree.reserve(chargingNodes.size());
+    std::vector<unsigned int> items;
+    for (unsigned int i = 0; i < chargingNodes.size(); i++) {
+        ChargingNode* cn = chargingNodes.at(i);
+        TreeNode treeNode;
+        treeNode.pos[0] = cn->getX();
+        treeNode.pos[1] = cn->getY();
+        treeNode.pos[2] = cn->getZ();
+        treeNode.cn = cn;
+        treeNode.order = i;
+        treeNode.left = treeNode.right = -1;
+        treeNode.axis = 0;
+        tree.push_back(treeNode);
+        items.push_back(i);
+    }
+    root = build(items, 0, items.size(), 0);
+    dirty = false;
+}
+
+/**
+ * Recursively splits the items at the median of the current axis.
+ *
+ * @return Index of the subtree root in the tree vector, -1 for an empty range
+ */
+int ChargingNodeIndex::build(std::vector<unsigned int>& items, unsigned int begin, unsigned int end, int depth)
+{
+    if (begin >= end) return -1;
+
+    int axis = depth % 3;
+    unsigned int median = begin + (end - begin) / 2;
+    std::nth_element(items.begin() + begin, items.begin() + median, items.begin() + end, [this, axis](unsigned int a, unsigned int b) {
+        return tree[a].pos[axis] < tree[b].pos[axis];
+    });
+
+    int nodeIdx = items.at(median);
+    tree[nodeIdx].axis = axis;
+    tree[nodeIdx].left = build(items, begin, median, depth + 1);
+    tree[nodeIdx].right = build(items, median + 1, end, depth + 1);
+    return nodeIdx;
+}
+
+void ChargingNodeIndex::search(int nodeIdx, const double query[3], int metric, int& best, double& bestDistance) const
+{
+    if (nodeIdx == -1) return;
+    const TreeNode& node = tree[nodeIdx];
+
+    double dx = node.pos[0] - query[0];
+    double dy = node.pos[1] - query[1];
+    double dz = node.pos[2] - query[2];
+    double distance = (metric == EUCLIDEAN) ? dx * dx + dy * dy + dz * dz : fabs(dx) + fabs(dy) + fabs(dz);
+    if (distance < bestDistance || (distance == bestDistance && node.order < tree[best].order)) {
+        best = nodeIdx;
+        bestDistance = distance;
+    }
+
+    double axisDistance = query[node.axis] - node.pos[node.axis];
+    int nearSide = (axisDistance < 0) ? node.left : node.right;
+    int farSide = (axisDistance < 0) ? node.right : node.left;
+    search(nearSide, query, metric, best, bestDistance);
+
+    // the distance along the split axis is a lower bound for both metrics
+    double bound = (metric == EUCLIDEAN) ? axisDistance * axisDistance : fabs(axisDistance);
+    if (bound <= bestDistance) search(farSide, query, metric, best, bestDistance);
+}
@@ -0,0 +1,102 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef CHARGINGNODEINDEX_H_
+#define CHARGINGNODEINDEX_H_
+
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace omnetpp {
+class cModule;
+}
+
+class ChargingNode;
+
+/**
+ * Registry of the charging nodes of a region with a k-d tree for nearest neighbor queries.
+ * A region is the compound module containing the nodes, i.e. the network itself or one
+ * Region of a RegionalNet, so nodes never see charging nodes of another region (partition).
+ * Charging nodes register themselves during initialization, the tree is (re)built lazily
+ * on the first query after the set of charging nodes changed.
+ */
+class ChargingNodeIndex {
+public:
+    enum Metric {
+        MANHATTAN = 0, EUCLIDEAN = 1
+    };
+
+    /**
+     * @param region The compound module containing the charging nodes
+     */
+    static ChargingNodeIndex& getInstance(const omnetpp::cModule *region);
+
+    void add(ChargingNode* cn);
+
+    /**
+     * The index of a region is kept when its last charging node is removed, so references to it stay valid.
+     * Module ids are reused by the next network, which then finds the empty index of the region.
+     */
+    void remove(ChargingNode* cn);
+
+    /**
+     * Find the nearest charging node to the given coordinates.
+     * On equal distance the charging node registered first is returned, as with a scan in module order.
+     *
+     * @param metric Distance metric, MANHATTAN or EUCLIDEAN
+     * @return The nearest charging node or nullptr if none is registered
+     */
+    ChargingNode* findNearest(double x, double y, double z, int metric = MANHATTAN);
+
+    const std::vector<ChargingNode*>& getChargingNodes() const
+    {
+        return chargingNodes;
+    }
+
+    /**
+     * Incremented whenever a charging node is added or removed.
+     * Allows nodes to invalidate cached predictions based on the nearest charging node.
+     */
+    unsigned int getRevision() const
+    {
+        return revision;
+    }
+
+private:
+    struct TreeNode {
+        double pos[3];
+        ChargingNode* cn;
+        unsigned int order;
+        int left;
+        int right;
+        int axis;
+    };
+
+    std::vector<ChargingNode*> chargingNodes;
+    std::vector<TreeNode> tree;
+    int root = -1;
+    bool dirty = true;
+    unsigned int revision = 0;
+
+    static std::map<int, std::unique_ptr<ChargingNodeIndex>> regions;
+
+    ChargingNodeIndex() = default;
+    void rebuild();
+    int build(std::vector<unsigned int>& items, unsigned int begin, unsigned int end, int depth);
+    void search(int nodeIdx, const double query[3], int metric, int& best, double& bestDistance) const;
+};
+
+#endif /* CHARGINGNODEINDEX_H_ */
@@ -27,8 +27,3 @@ ChargingNodeSpotElement::ChargingNodeSpotElement(MobileNode* node, double estima
     this->reservationTime = simTime();
 }
 
-ChargingNodeSpotElement::~ChargingNodeSpotElement()
-{
-    // TODO Auto-generated destructor stub
-}
-
@@ -22,6 +22,7 @@
  * Class ChargingNodeSpotElement
  * Represents one element on a waiting or charging spot of the charging station.
  * Is used to carry further information before and during the charging process.
+ * Held by value in the spot queues of the charging station.
  *
  */
 class ChargingNodeSpotElement {
@@ -41,8 +42,6 @@ public:
      */
     ChargingNodeSpotElement(MobileNode* node, double estimatedChargeDuration, double estimatedWaitingDuration, double targetCapacityPercentage = 100.0);
 
-    virtual ~ChargingNodeSpotElement();
-
     double getEstimatedChargeDuration() const
     {
         return estimatedChargeDuration;
@@ -53,7 +52,7 @@ public:
         return estimatedWaitingDuration;
     }
 
-    MobileNode* getNode()
+    MobileNode* getNode() const
     {
         return node;
     }
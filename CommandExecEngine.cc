@@ -15,6 +15,8 @@
 
 #include "CommandExecEngine.h"
 #include "UAVNode.h"
+#include "ObstacleMap.h"
+#include "MessageKind.h"
 
 using namespace omnetpp;
 
@@ -93,6 +95,15 @@ void WaypointCEE::updateState(double stepSize)
     node->battery.discharge(consumptionPerSecond * stepSize);
 }
 
+void WaypointCEE::extrapolatePosition(double stepSize, double& x, double& y, double& z) const
+{
+    double stepDistance = stepSize * speed;
+    double stepXY = stepDistance * cos(M_PI * climbAngle / 180);
+    x += stepXY * cos(M_PI * yaw / 180);
+    y += stepXY * sin(M_PI * yaw / 180);
+    z += stepDistance * sin(M_PI * climbAngle / 180);
+}
+
 double WaypointCEE::getOverallDuration() const
 {
     double dx = x1 - x0;
@@ -202,6 +213,15 @@ void TakeoffCEE::updateState(double stepSize)
     node->battery.discharge(consumptionPerSecond * stepSize);
 }
 
+void TakeoffCEE::extrapolatePosition(double stepSize, double& x, double& y, double& z) const
+{
+    double stepDistance = speed * stepSize;
+    if (z1 > z)
+        z += stepDistance;
+    else
+        z -= stepDistance;
+}
+
 double TakeoffCEE::getOverallDuration() const
 {
     return fabs(z1 - z0) / speed;
@@ -467,35 +487,58 @@ void ExchangeCEE::performExitActions()
 {
     if (command->isRechargeRequested()) {
         // Find nearest ChargingNode
-        ChargingNode *cn = UAVNode::findNearestCN(node->getX(), node->getY(), node->getZ());
+        ChargingNode *cn = node->selectChargingNode(node->getX(), node->getY(), node->getZ());
 
         // Generate WaypointCEE
         WaypointCommand *goToChargingNodeCommand = new WaypointCommand(cn->getX(), cn->getY(), cn->getZ());
-        WaypointCEE *goToChargingNodeCEE = new WaypointCEE(node, goToChargingNodeCommand);
+        WaypointCEE *goToChargingNodeCEE = node->ceePool.create<WaypointCEE>(node, goToChargingNodeCommand);
+        goToChargingNodeCEE->setCommandOwned();
         goToChargingNodeCEE->setPartOfMission(false);
         goToChargingNodeCEE->setNoReplacementNeeded();
 
+        // Generate the WaypointCEEs of the detour over buildings in front of it
+        CommandExecEngine* detour[ObstacleMap::MAX_DETOUR_WAYPOINTS];
+        int detourCount = node->createDetourCEEs(node->getX(), node->getY(), node->getZ(), cn->getX(), cn->getY(), cn->getZ(), false, detour);
+        double detourDuration = 0;
+        double detourConsumption = 0;
+        for (int i = 0; i < detourCount; i++) {
+            detour[i]->setNoReplacementNeeded();
+            detour[i]->initializeCEE();
+            detourDuration += detour[i]->getOverallDuration();
+            detourConsumption += detour[i]->getProbableConsumption(false);
+        }
+        if (detourCount > 0) {
+            goToChargingNodeCEE->setFromCoordinates(detour[detourCount - 1]->getX1(), detour[detourCount - 1]->getY1(), detour[detourCount - 1]->getZ1());
+        }
+
         // Get the duration for the flight to ChargingNode
         // To get the information the CEE needs to be initialized
         goToChargingNodeCEE->initializeCEE();
-        double goToChargingNodeDuration = goToChargingNodeCEE->getOverallDuration();
+        double goToChargingNodeDuration = goToChargingNodeCEE->getOverallDuration() + detourDuration;
+        // normalized over the whole flight
+        double goToChargingNodeConsumption = goToChargingNodeCEE->getProbableConsumption();
+        if (detourCount > 0 && goToChargingNodeDuration > 0) {
+            goToChargingNodeConsumption = (goToChargingNodeCEE->getProbableConsumption(false) + detourConsumption) / goToChargingNodeDuration;
+        }
 
         // Generate and send reservation message to CN
-        ReserveSpotMsg *msg = new ReserveSpotMsg("reserveSpot");
+        ReserveSpotMsg *msg = new ReserveSpotMsg("reserveSpot", MSG_RESERVE_SPOT);
         msg->setEstimatedArrival(simTime() + goToChargingNodeDuration);
-        msg->setConsumptionTillArrival(goToChargingNodeCEE->getProbableConsumption());
+        msg->setConsumptionTillArrival(goToChargingNodeConsumption);
         msg->setTargetPercentage(100.0);
         node->send(msg, node->getOutputGateTo(cn));
 
         // Generate ChargeCEE
         ChargeCommand *chargeCommand = new ChargeCommand(cn);
-        CommandExecEngine *chargeCEE = new ChargeCEE(node, chargeCommand);
+        CommandExecEngine *chargeCEE = node->ceePool.create<ChargeCEE>(node, chargeCommand);
+        chargeCEE->setCommandOwned();
         chargeCEE->setToCoordinates(cn->getX(), cn->getY(), cn->getZ());
         chargeCEE->setPartOfMission(false);
         chargeCEE->setNoReplacementNeeded();
 
         IdleCommand* idleCommand = new IdleCommand();
-        IdleCEE* idleCEE = new IdleCEE(node, idleCommand);
+        IdleCEE* idleCEE = node->ceePool.create<IdleCEE>(node, idleCommand);
+        idleCEE->setCommandOwned();
         idleCEE->setToCoordinates(cn->getX(), cn->getY(), cn->getZ());
         idleCEE->setFromCoordinates(cn->getX(), cn->getY(), cn->getZ());
         idleCEE->setPartOfMission(false);
@@ -506,6 +549,9 @@ void ExchangeCEE::performExitActions()
         node->cees.push_front(idleCEE);
         node->cees.push_front(chargeCEE);
         node->cees.push_front(goToChargingNodeCEE);
+        for (int i = detourCount - 1; i >= 0; i--) {
+            node->cees.push_front(detour[i]);
+        }
         node->missionId = -1;
 
         EV_INFO << __func__ << "(): GoToChargingNode and Charge CEE added to node." << endl;
@@ -552,7 +598,7 @@ void IdleCEE::setNodeParameters()
 
 void IdleCEE::updateState(double stepSize)
 {
-    node->getBattery()->discharge(consumptionPerSecond * stepSize);
+    node->battery.discharge(consumptionPerSecond * stepSize);
 }
 
 double IdleCEE::getOverallDuration() const
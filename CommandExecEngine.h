@@ -59,6 +59,9 @@ protected:
     /// if set to false, this cee will be executed without a check for a replacement node
     bool replacementNeeded = true;
 
+    /// set for commands created by the node itself, e.g. detours, they are not part of a Mission and are deleted with the CEE
+    bool commandOwned = false;
+
     simtime_t timeExecutionStart = 0;
 
 public:
@@ -158,6 +161,16 @@ public:
      */
     virtual void updateState(double stepSize) = 0;
 
+    /**
+     * Calculate the position the node reaches after the given time, without altering the node.
+     * CEEs without movement leave the given position untouched.
+     *
+     * @param stepSize simulation time in seconds since the position was valid
+     */
+    virtual void extrapolatePosition(double stepSize, double& x, double& y, double& z) const
+    {
+    }
+
     /**
      * No replacement node is requested for this CEE.
      */
@@ -322,6 +335,19 @@ public:
         this->partOfMission = partOfMission;
     }
 
+    /**
+     * The command was created for this CEE and is deleted when the CEE is released to its pool
+     */
+    void setCommandOwned()
+    {
+        commandOwned = true;
+    }
+
+    bool isCommandOwned() const
+    {
+        return commandOwned;
+    }
+
     /**
      * Actions to perform when the CEE execution starts
      */
@@ -361,6 +387,7 @@ public:
     void initializeCEE() override;
     void setNodeParameters() override;
     void updateState(double stepSize) override;
+    void extrapolatePosition(double stepSize, double& x, double& y, double& z) const override;
     double getOverallDuration() const override;
     double getOverallDurationQuantile() const override;
     double getRemainingTime() const override;
@@ -389,6 +416,7 @@ public:
     void initializeCEE() override;
     void setNodeParameters() override;
     void updateState(double stepSize) override;
+    void extrapolatePosition(double stepSize, double& x, double& y, double& z) const override;
     double getOverallDuration() const override;
     double getRemainingTime() const override;
     double getProbableConsumption(bool normalized = true, int fromMethod = 2) const override;
@@ -0,0 +1,29 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#include "GateRoutingTable.h"
+
+void GateRoutingTable::build(const cModule *owner)
+{
+    gates.clear();
+    for (int i = 0; i < owner->gateCount(); i++) {
+        cGate *gate = owner->gateByOrdinal(i);
+        if (gate->getType() != cGate::Type::OUTPUT) continue;
+        cModule *gateOwner = gate->getPathEndGate()->getOwnerModule();
+        // the first gate wins, like the former linear scan
+        gates.emplace(gateOwner, gate);
+    }
+    gateCount = owner->gateCount();
+}
@@ -0,0 +1,49 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef GATEROUTINGTABLE_H_
+#define GATEROUTINGTABLE_H_
+
+#include <unordered_map>
+#include <omnetpp.h>
+
+using namespace omnetpp;
+
+/**
+ * Maps the modules at the far end of a module's output gates to these gates.
+ * Built on the first lookup, i.e. after the connections are set up. The table is rebuilt
+ * when the gate count of the owner changed, e.g. after a gate vector was resized.
+ */
+class GateRoutingTable {
+public:
+    /**
+     * @return The output gate of owner whose path ends at target, nullptr if not connected
+     */
+    cGate* getOutputGateTo(const cModule *owner, const cModule *target)
+    {
+        if (owner->gateCount() != gateCount) build(owner);
+        auto it = gates.find(target);
+        return (it != gates.end()) ? it->second : nullptr;
+    }
+
+private:
+    void build(const cModule *owner);
+
+    // gate count of the owner the table was built for, -1 if not built yet
+    int gateCount = -1;
+    std::unordered_map<const cModule *, cGate *> gates;
+};
+
+#endif /* GATEROUTINGTABLE_H_ */
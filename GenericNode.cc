@@ -13,11 +13,15 @@
 // along with this program.  If not, see http://www.gnu.org/licenses/.
 //
 
-#if defined(WITH_OSG) && defined(WITH_OSGEARTH)
 #include "GenericNode.h"
 #include "OsgEarthScene.h"
 #include "ChannelController.h"
+#include "ModelCache.h"
+#include "MessagePool.h"
+#include "TelemetryRecorder.h"
+#include "RealTimeScheduler.h"
 
+#if defined(WITH_OSG) && defined(WITH_OSGEARTH)
 #include <osg/Node>
 #include <osg/PositionAttitudeTransform>
 #include <osgEarth/Capabilities>
@@ -26,19 +30,27 @@
 #include <osgEarthFeatures/Feature>
 #include "omnetpp/osgutil.h"
 
-using namespace omnetpp;
-
 using namespace osgEarth;
 using namespace osgEarth::Annotation;
 using namespace osgEarth::Features;
+#endif
+
+using namespace omnetpp;
+
+int GenericNode::analyticNodes = 0;
+simtime_t GenericNode::positionsRefreshedAt = -1;
 
 GenericNode::GenericNode()
 {
     // Ignore Warning: members are initialized in "initialize(int stage)"
+    // The kinematics slot is needed before initialization, e.g. by the MissionControl node shadows
+    kinematicsSlot = NodeKinematics::getInstance().registerNode(this);
 }
 
 GenericNode::~GenericNode()
 {
+    if (analyticMotion) analyticNodes--;
+    NodeKinematics::getInstance().unregisterNode(kinematicsSlot);
 }
 
 void GenericNode::initialize(int stage)
@@ -46,6 +58,10 @@ void GenericNode::initialize(int stage)
     switch (stage) {
         case 0:
             timeStep = par("timeStep");
+            alignTimeStep = par("alignTimeStep").boolValue();
+            analyticMotion = par("analyticMotion").boolValue();
+            if (analyticMotion) analyticNodes++;
+            positionsRefreshedAt = -1;
             modelURL = par("modelURL").stringValue();
             showTxRange = par("showTxRange");
             txRange = par("txRange");
@@ -56,7 +72,9 @@ void GenericNode::initialize(int stage)
 
         case 1:
             ChannelController::getInstance()->addGenericNode(this);
+            NodeKinematics::getInstance().setPosition(kinematicsSlot, x, y, z, yaw, pitch);
 
+#if defined(WITH_OSG) && defined(WITH_OSGEARTH)
             // scene is initialized in stage 0 so we have to do our init in stage 1
             auto scene = OsgEarthScene::getInstance()->getScene();
             mapNode = osgEarth::MapNode::findMapNode(scene);
@@ -64,22 +82,8 @@ void GenericNode::initialize(int stage)
             // build up the node representing this module
             // an ObjectLocatorNode allows positioning a model using world coordinates
             locatorNode = new osgEarth::Util::ObjectLocatorNode(mapNode->getMap());
-            auto modelNode = osgDB::readNodeFile(modelURL);
-            if (!modelNode) throw cRuntimeError("Model file \"%s\" not found", modelURL.c_str());
-
-            // disable shader and lighting on the model so textures are correctly shown
-            modelNode->getOrCreateStateSet()->setAttributeAndModes(new osg::Program(), osg::StateAttribute::OFF | osg::StateAttribute::OVERRIDE);
-            modelNode->getOrCreateStateSet()->setMode(GL_LIGHTING, osg::StateAttribute::OFF);
-
-            const char *modelColor = par("modelColor");
-            if (*modelColor != '\0') {
-                auto color = osgEarth::Color(modelColor);
-                auto material = new osg::Material();
-                material->setAmbient(osg::Material::FRONT_AND_BACK, color);
-                material->setDiffuse(osg::Material::FRONT_AND_BACK, color);
-                material->setAlpha(osg::Material::FRONT_AND_BACK, 1.0);
-                modelNode->getOrCreateStateSet()->setAttribute(material, osg::StateAttribute::OFF | osg::StateAttribute::OVERRIDE);
-            }
+            // the model and its state set are shared by all nodes with the same model and color
+            auto modelNode = ModelCache::getInstance().getModel(modelURL, par("modelColor").stdstringValue(), par("modelLodDistance").doubleValue());
 
             auto objectNode = new omnetpp::cObjectOsgNode(this);  // make the node selectable in Qtenv
             objectNode->addChild(modelNode);
@@ -100,7 +104,7 @@ void GenericNode::initialize(int stage)
                 labelStyle.getOrCreate<TextSymbol>()->pixelOffset() = osg::Vec2s(0, 20);
                 labelStyle.getOrCreate<TextSymbol>()->fill()->color() = osgEarth::Color(label2Color);
                 labelStyle.getOrCreate<TextSymbol>()->size() = 12;
-                sublabelNode = new LabelNode(par("stateSummary"), labelStyle);
+                sublabelNode = new LabelNode("", labelStyle);
                 sublabelNode->setDynamic(true);
                 locatorNode->addChild(sublabelNode);
             }
@@ -117,6 +121,7 @@ void GenericNode::initialize(int stage)
 
             // add the locator node to the scene
             mapNode->getModelLayerGroup()->addChild(locatorNode);
+#endif
 
             // schedule start of the mission for each node (may be delayed by ned parameter)
             //cMessage *timer = new cMessage("startMission");
@@ -127,29 +132,85 @@ void GenericNode::initialize(int stage)
 
 void GenericNode::refreshDisplay() const
 {
+    if (RealTimeScheduler::isBehind()) return;
+#if defined(WITH_OSG) && defined(WITH_OSGEARTH)
     auto geoSRS = mapNode->getMapSRS(); //->getGeographicSRS();
     double longitude = getLongitude();
     double latitude = getLatitude();
     double altitude = getAltitude();
 
-    // update the 3D position of the model node
-    locatorNode->getLocator()->setPosition(osg::Vec3d(longitude, latitude, altitude));
-    locatorNode->getLocator()->setOrientation(osg::Vec3d(yaw, 0, pitch));
+    osg::Vec3d position(longitude, latitude, altitude);
+    osg::Vec3d orientation(yaw, 0, pitch);
+
+    // update the 3D position of the model node, unless it did not move since the last refresh
+    if (not displayValid || position != displayedPosition || orientation != displayedOrientation) {
+        locatorNode->getLocator()->setPosition(position);
+        locatorNode->getLocator()->setOrientation(orientation);
 
-    // re-position the range indicator node
-    if (showTxRange) rangeNode->setPosition(GeoPoint(geoSRS, longitude, latitude));
+        // re-position the range indicator node
+        if (showTxRange) rangeNode->setPosition(GeoPoint(geoSRS, longitude, latitude));
+
+        displayedPosition = position;
+        displayedOrientation = orientation;
+        displayValid = true;
+    }
+#endif
 
     // update the position on the 2D canvas, too
-    getDisplayString().setTagArg("p", 0, x);
-    getDisplayString().setTagArg("p", 1, y);
+    getDisplayString().setTagArg("p", 0, getX());
+    getDisplayString().setTagArg("p", 1, getY());
+}
+
+/**
+ * Get the current position of the node.
+ * In analyticMotion mode the stored position is only updated at command boundaries,
+ * the position in between is calculated from the constant velocity of the current CEE.
+ */
+void GenericNode::extrapolatePosition(double& px, double& py, double& pz) const
+{
+    px = x;
+    py = y;
+    pz = z;
+    if (analyticMotion && activeInField && commandExecEngine != nullptr) {
+        commandExecEngine->extrapolatePosition((simTime() - positionTime).dbl(), px, py, pz);
+    }
+}
+
+/**
+ * Writes the current position into the ChannelController grid and the NodeKinematics table.
+ */
+void GenericNode::publishPosition()
+{
+    double px, py, pz;
+    extrapolatePosition(px, py, pz);
+    ChannelController::getInstance()->updateGenericNode(this);
+    NodeKinematics::getInstance().setPosition(kinematicsSlot, px, py, pz, yaw, pitch);
+}
+
+/**
+ * The grid and the kinematics table only get the positions of analyticMotion nodes at their events.
+ * Modules call this before they look up the positions of other nodes, it publishes the extrapolated
+ * positions at most once per simulation time.
+ */
+void GenericNode::refreshExtrapolatedPositions()
+{
+    if (analyticNodes == 0 || positionsRefreshedAt == simTime()) return;
+    positionsRefreshedAt = simTime();
+    NodeKinematics& kinematics = NodeKinematics::getInstance();
+    for (int slot = 0; slot < kinematics.size(); slot++) {
+        GenericNode *node = kinematics.getNode(slot);
+        if (node != nullptr && node->analyticMotion && node->activeInField) node->publishPosition();
+    }
 }
 
 void GenericNode::handleMessage(cMessage *msg)
 {
     double stepSize = 0;
-    if (msg->isName("startProvision")) {
+    if (msg->getKind() == MSG_START_PROVISION) {
         MissionMsg *mmmsg = check_and_cast<MissionMsg *>(msg);
-        if (not mmmsg->getMission().empty()) loadCommands(mmmsg->getMission(), false);
+        if (mmmsg->getMission() != nullptr && not mmmsg->getMission()->empty()) {
+            loadMission(mmmsg->getMission(), mmmsg->getMissionCursor(), mmmsg->getMissionRepeat(), false);
+        }
         if (activeInField) {
             EV_INFO << "UAV initialized for provisioning " << endl;
             commandExecEngine->setCommandCompleted();
@@ -163,29 +224,38 @@ void GenericNode::handleMessage(cMessage *msg)
             selectNextCommand();
             initializeState();
             activeInField = true;
-            msg->setName("update");
+            setMessageKind(msg, MSG_UPDATE);
             stepSize = 0;
         }
     }
-    else if (msg->isName("startMission")) {
+    else if (msg->getKind() == MSG_START_MISSION) {
         activeInField = true;
         MissionMsg *mmmsg = check_and_cast<MissionMsg *>(msg);
-        if (not mmmsg->getMission().empty()) loadCommands(mmmsg->getMission());
         commandsRepeat = mmmsg->getMissionRepeat();
+        if (mmmsg->getMission() != nullptr && not mmmsg->getMission()->empty()) {
+            loadMission(mmmsg->getMission(), mmmsg->getMissionCursor(), mmmsg->getMissionRepeat());
+        }
         missionId = mmmsg->getMissionId();
         collectStatistics();
         selectNextCommand();
         initializeState();
         EV_INFO << "UAV initialized and on its way." << endl;
-        msg->setName("update");
+        setMessageKind(msg, MSG_UPDATE);
         stepSize = 0;
     }
-    else if (msg->isName("update")) {
+    else if (msg->getKind() == MSG_UPDATE) {
         updateState();
+        positionTime = simTime();
         stepSize = nextNeededUpdate();
-        stepSize = (timeStep == 0 || stepSize < timeStep) ? stepSize : timeStep;
+        stepSize = (analyticMotion || timeStep == 0 || stepSize < timeStep) ? stepSize : timeStep;
+        if (alignTimeStep && not analyticMotion && stepSize == timeStep) {
+            // to the next multiple of timeStep, at most one timeStep ahead
+            double now = simTime().dbl();
+            double next = (floor(now / timeStep) + 1) * timeStep;
+            if (next - now > timeStep * 1e-6) stepSize = next - now;
+        }
         if (isCommandCompleted()) {
-            msg->setName("nextCommand");
+            setMessageKind(msg, MSG_NEXT_COMMAND);
             stepSize = 0;
         }
         else {
@@ -194,7 +264,7 @@ void GenericNode::handleMessage(cMessage *msg)
             ASSERT(stepSize != 0);
         }
     }
-    else if (msg->isName("nextCommand")) {
+    else if (msg->getKind() == MSG_NEXT_COMMAND) {
 
         if (commandExecEngine != nullptr) commandExecEngine->performExitActions();
 
@@ -208,11 +278,12 @@ void GenericNode::handleMessage(cMessage *msg)
         }
 
         // Build and Send a Command Completed Message to Mission Control
-        CmdCompletedMsg *ccmsg = new CmdCompletedMsg("commandCompleted");
+        CmdCompletedMsg *ccmsg = MessagePool::getInstance().acquire<CmdCompletedMsg>(MSG_COMMAND_COMPLETED);
+        if (ccmsg->getOwner() != this) take(ccmsg);
         ccmsg->setSourceNodeIndex(this->getIndex());
-        ReplacementData *replacementData = endOfOperation();
-        if (replacementData != nullptr) {
-            ccmsg->setReplacementData(*replacementData);
+        ReplacementData replacementData;
+        if (endOfOperation(replacementData)) {
+            ccmsg->setReplacementData(replacementData);
         }
         else {
             ccmsg->setReplacementDataAvailable(false);
@@ -224,20 +295,21 @@ void GenericNode::handleMessage(cMessage *msg)
         collectStatistics();
         selectNextCommand();
         initializeState();
-        msg->setName("update");
+        setMessageKind(msg, MSG_UPDATE);
         stepSize = 0;
     }
     else {
         // Message is unknown for Generic Node and all child classes the super call originated from
-        std::string message = "Unknown message name encountered: ";
-        message += msg->getFullName();
-        throw cRuntimeError(message.c_str());
+        throw cRuntimeError("Unknown message name encountered: %s", msg->getFullName());
         delete msg;
         msg = nullptr;
         return;
     }
 
     lastUpdate = simTime();
+    positionTime = simTime();
+    publishPosition();
+    if (TelemetryRecorder *recorder = TelemetryRecorder::getInstance()) recorder->recordUpdate(this);
 
     // schedule next update
     if (msg != nullptr) {
@@ -255,6 +327,18 @@ bool GenericNode::hasCommandsInQueue()
     return (not cees.empty());
 }
 
+/**
+ * Load the commands of a shared mission, starting at the cursor.
+ * The node keeps a reference to the mission instead of a copy of its commands.
+ */
+void GenericNode::loadMission(MissionPtr mission, int cursor, bool repeat, bool isMission)
+{
+    CommandQueue commands;
+    if (mission != nullptr) commands = mission->getCommands(cursor, repeat);
+    this->mission = mission;
+    loadCommands(commands, isMission);
+}
+
 /**
  * Delete the current commands/CEEs from nodes memory
  */
@@ -266,17 +350,17 @@ void GenericNode::clearCommands()
 
 /**
  * Extracts commands of the current CEEs loaded.
- * Removes non-Mission commands and keeps the current order in place.
+ * Removes non-Mission commands and the detours generated for them, keeps the current order in place.
  *
- * @return An execution neutral list of commands
+ * @return An execution neutral list of commands, still owned by the CEEs
  */
-CommandQueue* GenericNode::extractCommands()
+CommandQueue GenericNode::extractCommands()
 {
-    CommandQueue* commands = new CommandQueue();
+    CommandQueue commands;
     for (auto it = cees.begin(); it != cees.end(); it++) {
         CommandExecEngine *cee = *it;
-        if (cee->isPartOfMission()) {
-            commands->push_back(cee->extractCommand());
+        if (cee->isPartOfMission() && not cee->isCommandOwned()) {
+            commands.push_back(cee->extractCommand());
         }
     }
     return commands;
@@ -286,37 +370,31 @@ CommandQueue* GenericNode::extractCommands()
  * Extracts commands of the current CEEs loaded.
  * Removes non-Mission commands and keeps the current order in place.
  *
- * @return An execution neutral list of commands
+ * @return An execution neutral list of commands, still owned by the CEEs
  */
-CommandQueue* GenericNode::extractAllCommands()
+CommandQueue GenericNode::extractAllCommands()
 {
-    CommandQueue* commands = new CommandQueue();
+    CommandQueue commands;
     for (auto it = cees.begin(); it != cees.end(); it++) {
         CommandExecEngine *cee = *it;
-        commands->push_back(cee->extractCommand());
+        commands.push_back(cee->extractCommand());
     }
     return commands;
 }
 
+void GenericNode::addMemoryUsage(MemoryUsage& usage) const
+{
+    usage.add(std::string(getName()) + ".ceeQueue", MemoryUsage::ofDeque(cees), cees.size());
+}
+
 /**
  * Find and return the cGate pointing to another cModule.
+ * The gates are looked up in a table built on the first call instead of scanning all gates.
  *
  * @param cMod
  * @return cGate*, 'nullptr' if no gate found
  */
 cGate* GenericNode::getOutputGateTo(cModule *cMod)
 {
-    for (int i = 0; i < this->gateCount(); i++) {
-        cGate *gate = this->gateByOrdinal(i);
-        if (gate->getType() == cGate::Type::OUTPUT) {
-            cModule *gateOwner = gate->getPathEndGate()->getOwnerModule();
-            if (gateOwner == cMod) {
-                return gate;
-            }
-            //EV_INFO << "Node is connected to " << gateOwner->getFullName() << " through gate at index " << i << ": " << gate->getFullName() << endl;
-        }
-    }
-    return nullptr;
+    return outputGates.getOutputGateTo(this, cMod);
 }
-
-#endif // WITH_OSG
@@ -18,6 +18,7 @@
 
 #include <omnetpp.h>
 
+#if defined(WITH_OSG) && defined(WITH_OSGEARTH)
 #include <osg/PositionAttitudeTransform>
 #include <osgEarth/MapNode>
 #include <osgEarth/GeoTransform>
@@ -25,14 +26,20 @@
 #include <osgEarthAnnotation/FeatureNode>
 #include <osgEarthAnnotation/LabelNode>
 #include <osgEarthUtil/ObjectLocator>
+#endif
 
 #include "OsgEarthScene.h"
 
 #include "Command.h"
 #include "CommandExecEngine.h"
+#include "Mission.h"
 #include "msgs/MissionMsg_m.h"
 #include "msgs/CmdCompletedMsg_m.h"
 #include "ReplacementData.h"
+#include "NodeKinematics.h"
+#include "Profiling.h"
+#include "MemoryUsage.h"
+#include "GateRoutingTable.h"
 //#include "ChargingNode.h"
 
 using namespace omnetpp;
@@ -66,7 +73,10 @@ class GenericNode : public cSimpleModule, public IGenericNode {
 protected:
     // configuration
     double timeStep;
+    bool alignTimeStep = false;
+#if defined(WITH_OSG) && defined(WITH_OSGEARTH)
     osgEarth::Style labelStyle;
+#endif
     std::string labelColor;
     std::string label2Color;
     std::string rangeColor;
@@ -77,9 +87,25 @@ protected:
     /// Timestamp when the last time-related node state update happened
     simtime_t lastUpdate = 0;
 
+    /// If true updates are only scheduled at command boundaries, the position in between is extrapolated on demand
+    bool analyticMotion = false;
+
+    /// Timestamp the stored position (x, y, z) is valid for
+    simtime_t positionTime = 0;
+
+    /// Number of analyticMotion nodes and the time refreshExtrapolatedPositions() last published their positions
+    static int analyticNodes;
+    static simtime_t positionsRefreshedAt;
+
     /// Contains future Command Execution Engines
     CEEQueue cees;
 
+    /// Shared mission the CEEs queue was loaded from
+    MissionPtr mission;
+
+    /// Mission the current command belongs to, keeps its commands alive while a new mission is loaded
+    MissionPtr activeMission;
+
     /// Instance of CEE subclass, contains current command
     CommandExecEngine *commandExecEngine = nullptr;
 
@@ -97,6 +123,15 @@ protected:
     /// state
     double x, y, z; // relative to playground origin (top left) in meters
 
+    /// Slot in the shared NodeKinematics table
+    int kinematicsSlot = -1;
+
+    /// Hot path timers of this node, empty unless compiled with WITH_PROFILING
+    ModuleProfiling profiling;
+
+    /// Output gate per connected module, see getOutputGateTo()
+    GateRoutingTable outputGates;
+
 
     /**
      * yaw/horizontal orientation in degrees
@@ -123,6 +158,7 @@ protected:
      */
     double climbAngle = 0;
 
+#if defined(WITH_OSG) && defined(WITH_OSGEARTH)
     // the node containing the osgEarth data
     osg::observer_ptr<osgEarth::MapNode> mapNode = nullptr;
     // osgEarth node for 3D visualization
@@ -133,7 +169,11 @@ protected:
     osg::ref_ptr<osgEarth::Annotation::LabelNode> labelNode = nullptr;
     // second label beneath labelNode
     osg::ref_ptr<osgEarth::Annotation::LabelNode> sublabelNode = nullptr;
-    // trail annotation
+    // position and orientation last passed to the locator node
+    mutable osg::Vec3d displayedPosition;
+    mutable osg::Vec3d displayedOrientation;
+    mutable bool displayValid = false;
+#endif
 
 public:
     GenericNode();
@@ -141,15 +181,24 @@ public:
 
     double getX() const override
     {
-        return x;
+        if (not analyticMotion) return x;
+        double px, py, pz;
+        extrapolatePosition(px, py, pz);
+        return px;
     }
     double getY() const override
     {
-        return y;
+        if (not analyticMotion) return y;
+        double px, py, pz;
+        extrapolatePosition(px, py, pz);
+        return py;
     }
     double getZ() const override
     {
-        return z;
+        if (not analyticMotion) return z;
+        double px, py, pz;
+        extrapolatePosition(px, py, pz);
+        return pz;
     }
     double getLatitude() const override
     {
@@ -183,17 +232,30 @@ public:
     {
         return missionId;
     }
+    int getKinematicsSlot() const
+    {
+        return kinematicsSlot;
+    }
     CommandExecEngine* getCommandExecEngine() const
     {
         return commandExecEngine;
     }
     virtual bool hasCommandsInQueue();
     virtual void loadCommands(CommandQueue commands, bool isMission = true) = 0;
+    void loadMission(MissionPtr mission, int cursor, bool repeat, bool isMission = true);
     virtual void clearCommands();
-    virtual CommandQueue* extractCommands();
-    virtual CommandQueue* extractAllCommands();
+    virtual CommandQueue extractCommands();
+    virtual CommandQueue extractAllCommands();
 
     virtual cGate* getOutputGateTo(cModule *cMod);
+    void extrapolatePosition(double& px, double& py, double& pz) const;
+    static void refreshExtrapolatedPositions();
+
+    /**
+     * Adds the memory held by this node, e.g. for the report of MissionControl::finish().
+     * The subsystems are prefixed with the module name, e.g. "uav.ceeQueue".
+     */
+    virtual void addMemoryUsage(MemoryUsage& usage) const;
 
 protected:
     virtual void initialize(int stage) override;
@@ -204,6 +266,7 @@ protected:
     virtual void handleMessage(cMessage *msg) override;
     virtual void refreshDisplay() const override;
     virtual void updateState() = 0;
+    void publishPosition();
     virtual bool isCommandCompleted() = 0;
     virtual void selectNextCommand() = 0;
     virtual void collectStatistics() = 0;
@@ -214,7 +277,7 @@ protected:
      */
     virtual void initializeState() = 0;
     virtual double nextNeededUpdate() = 0;
-    virtual ReplacementData* endOfOperation() = 0;
+    virtual bool endOfOperation(ReplacementData& replacementData) = 0;
 };
 
 #endif
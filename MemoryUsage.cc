@@ -0,0 +1,57 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#include <iomanip>
+
+#include "MemoryUsage.h"
+
+void MemoryUsage::add(const std::string& subsystem, size_t bytes, size_t objects)
+{
+    Entry& entry = entries[subsystem];
+    entry.bytes += bytes;
+    entry.objects += objects;
+    entry.reports++;
+}
+
+size_t MemoryUsage::getTotalBytes() const
+{
+    size_t total = 0;
+    for (auto& entry : entries) {
+        total += entry.second.bytes;
+    }
+    return total;
+}
+
+void MemoryUsage::recordScalars(cComponent *component) const
+{
+    for (auto& entry : entries) {
+        component->recordScalar(("memory." + entry.first + ".bytes").c_str(), entry.second.bytes, "B");
+        component->recordScalar(("memory." + entry.first + ".objects").c_str(), entry.second.objects);
+    }
+    component->recordScalar("memory.total.bytes", getTotalBytes(), "B");
+}
+
+void MemoryUsage::printSummary(std::ostream& out) const
+{
+    out << std::left << std::setw(32) << "subsystem" << std::right << std::setw(10) << "reports" << std::setw(12) << "objects" << std::setw(14)
+            << "KiB" << std::setw(14) << "B/report" << std::endl;
+    for (auto& entry : entries) {
+        out << std::left << std::setw(32) << entry.first << std::right << std::setw(10) << entry.second.reports << std::setw(12) << entry.second.objects
+                << std::setw(14) << std::fixed << std::setprecision(1) << entry.second.bytes / 1024.0 << std::setw(14)
+                << entry.second.bytes / entry.second.reports << std::endl;
+    }
+    out << std::left << std::setw(32) << "total" << std::right << std::setw(36) << std::fixed << std::setprecision(1) << getTotalBytes() / 1024.0
+            << std::endl;
+}
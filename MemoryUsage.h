@@ -0,0 +1,92 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef MEMORYUSAGE_H_
+#define MEMORYUSAGE_H_
+
+#include <cstddef>
+#include <deque>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <omnetpp.h>
+
+using namespace omnetpp;
+
+/**
+ * Bytes and objects held per subsystem, reported by the modules at the end of a run.
+ * The sizes are estimated from the container sizes and capacities, not measured by the allocator,
+ * so they show how the footprint scales with the fleet, e.g. the bytes per UAV.
+ */
+class MemoryUsage {
+public:
+    struct Entry {
+        size_t bytes = 0;
+        size_t objects = 0;
+        unsigned int reports = 0;
+    };
+
+    /// Estimated allocator overhead of one element of a node based container, e.g. std::map
+    static const size_t NODE_OVERHEAD = 4 * sizeof(void*);
+
+    /**
+     * Adds one report of a subsystem, e.g. the CEE pool of one UAV.
+     */
+    void add(const std::string& subsystem, size_t bytes, size_t objects);
+
+    template<typename T>
+    static size_t ofVector(const std::vector<T>& v)
+    {
+        return v.capacity() * sizeof(T);
+    }
+
+    template<typename T>
+    static size_t ofDeque(const std::deque<T>& d)
+    {
+        return d.size() * sizeof(T);
+    }
+
+    /**
+     * @return Estimated bytes of a node based container (map, set, unordered_map, ...)
+     */
+    template<typename Container>
+    static size_t ofNodes(const Container& c)
+    {
+        return c.size() * (sizeof(typename Container::value_type) + NODE_OVERHEAD);
+    }
+
+    const std::map<std::string, Entry>& getEntries() const
+    {
+        return entries;
+    }
+
+    size_t getTotalBytes() const;
+
+    /**
+     * Records bytes and objects of every subsystem as scalars "memory.<subsystem>.bytes" and ".objects".
+     */
+    void recordScalars(cComponent *component) const;
+
+    /**
+     * Writes a table of all subsystems with their bytes per report.
+     */
+    void printSummary(std::ostream& out) const;
+
+private:
+    std::map<std::string, Entry> entries;
+};
+
+#endif /* MEMORYUSAGE_H_ */
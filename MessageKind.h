@@ -0,0 +1,82 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef MESSAGEKIND_H_
+#define MESSAGEKIND_H_
+
+#include <omnetpp.h>
+
+using namespace omnetpp;
+
+/**
+ * Kinds of all messages exchanged by the nodes and the MissionControl.
+ * The handlers dispatch on the kind, the name is kept for the logs and the eventlog.
+ */
+enum MessageKind : short {
+    MSG_UNKNOWN = 0,
+    // node life cycle
+    MSG_INIT_IDLE,
+    MSG_START_MISSION,
+    MSG_START_PROVISION,
+    MSG_UPDATE,
+    MSG_NEXT_COMMAND,
+    MSG_COMMAND_COMPLETED,
+    // exchange between two UAVs
+    MSG_EXCHANGE_DATA,
+    MSG_EXCHANGE_ACK,
+    MSG_EXCHANGE_COMPLETED,
+    // charging
+    MSG_START_CHARGE,
+    MSG_RESERVE_SPOT,
+    MSG_CHARGING_UPDATE,
+    MSG_MOBILE_NODE_REQUEST,
+    MSG_MOBILE_NODE_RESPONSE,
+    MSG_MOBILE_NODE_EXIT,
+    MSG_FORECAST_TARGET_REQUEST,
+    MSG_FORECAST_POINT_IN_TIME_REQUEST,
+    MSG_FORECAST_RESPONSE,
+    // MissionControl
+    MSG_START_SCHEDULING,
+    MSG_PROVISION_REPLACEMENT,
+    MSG_REPLACEMENT_ASSIGNED,
+    MSG_SOLVE_ASSIGNMENT,
+    MSG_WRITE_SNAPSHOT,
+    MSG_KIND_COUNT
+};
+
+/**
+ * @return The message name used for the kind, e.g. "update" for MSG_UPDATE
+ */
+inline const char* getMessageKindName(short kind)
+{
+    static const char *const names[MSG_KIND_COUNT] = { "", //
+            "initIdle", "startMission", "startProvision", "update", "nextCommand", "commandCompleted", //
+            "exchangeData", "exchangeAck", "exchangeCompleted", //
+            "startCharge", "reserveSpot", "chargingUpdate", "mobileNodeRequest", "mobileNodeResponse", "mobileNodeExit", //
+            "forecastTargetRequest", "forecastPointInTimeRequest", "forecastResponse", //
+            "startScheduling", "provisionReplacement", "replacementAssigned", "solveAssignment", "writeSnapshot" };
+    return (kind > MSG_UNKNOWN && kind < MSG_KIND_COUNT) ? names[kind] : "";
+}
+
+/**
+ * Turns a (self) message into one of another kind, name and kind are changed together.
+ */
+inline void setMessageKind(cMessage *msg, MessageKind kind)
+{
+    msg->setKind(kind);
+    msg->setName(getMessageKindName(kind));
+}
+
+#endif /* MESSAGEKIND_H_ */
@@ -0,0 +1,69 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#include "MessagePool.h"
+#include "msgs/CmdCompletedMsg_m.h"
+#include "msgs/UpdateChargingMsg_m.h"
+#include "msgs/MobileNodeRequest_m.h"
+#include "msgs/MobileNodeResponse_m.h"
+
+MessagePool& MessagePool::getInstance()
+{
+    static MessagePool instance;
+    return instance;
+}
+
+void MessagePool::release(cMessage *msg)
+{
+    if (msg == nullptr) return;
+    if (not recycling || not isRecycled(msg->getKind()) || msg->isScheduled()) {
+        delete msg;
+        return;
+    }
+    spares[msg->getKind()].push_back(msg);
+}
+
+void MessagePool::clear()
+{
+    for (auto& spare : spares) {
+        spare.clear();
+    }
+    recycling = not cConfiguration::parseBool(getEnvir()->getConfig()->getConfigValue("record-eventlog"), "false");
+}
+
+void MessagePool::resetFields(CmdCompletedMsg *msg)
+{
+    msg->setSourceNodeIndex(0);
+    msg->setReplacementDataAvailable(true);
+    msg->setReplacementData(ReplacementData());
+}
+
+void MessagePool::resetFields(UpdateChargingMsg *msg)
+{
+    msg->setEntriesArraySize(0);
+}
+
+void MessagePool::resetFields(MobileNodeRequest *msg)
+{
+    msg->setRemaining(0);
+}
+
+void MessagePool::resetFields(MobileNodeResponse *msg)
+{
+    msg->setNodeFound(false);
+    msg->setMobileNodeIndex(0);
+    msg->setRemaining(0);
+    msg->setCapacity(0);
+}
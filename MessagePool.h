@@ -0,0 +1,94 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef MESSAGEPOOL_H_
+#define MESSAGEPOOL_H_
+
+#include <vector>
+#include <omnetpp.h>
+#include "MessageKind.h"
+
+using namespace omnetpp;
+
+class CmdCompletedMsg;
+class UpdateChargingMsg;
+class MobileNodeRequest;
+class MobileNodeResponse;
+
+/**
+ * Recycles the messages sent on every update or command, instead of allocating and deleting them.
+ * A released message stays owned by the module that released it, the module acquiring it has to
+ * take() it before sending it:
+ *
+ *     auto msg = MessagePool::getInstance().acquire<CmdCompletedMsg>(MSG_COMMAND_COMPLETED);
+ *     if (msg->getOwner() != this) take(msg);
+ *
+ * The pool only holds pointers, the messages are deleted with their owning modules.
+ *
+ * A recycled message keeps its message and tree IDs, which would corrupt a recorded eventlog.
+ * With record-eventlog=true the pool is disabled, acquire() allocates and release() deletes.
+ */
+class MessagePool {
+public:
+    static MessagePool& getInstance();
+
+    /**
+     * @return A message of the kind with all fields at their defaults, recycled if possible
+     */
+    template<class T>
+    T* acquire(MessageKind kind)
+    {
+        std::vector<cMessage *>& spare = spares[kind];
+        if (not recycling || spare.empty()) return new T(getMessageKindName(kind), kind);
+        T *msg = check_and_cast<T *>(spare.back());
+        spare.pop_back();
+        msg->setName(getMessageKindName(kind));
+        msg->setKind(kind);
+        resetFields(msg);
+        return msg;
+    }
+
+    /**
+     * Replaces "delete msg" for received messages. Messages of recycled kinds are kept
+     * for acquire(), all others are deleted.
+     */
+    void release(cMessage *msg);
+
+    /**
+     * Forgets all spare messages, to be called once per run at network setup.
+     * They were deleted together with the modules of the previous network.
+     * Enables recycling unless the eventlog of the run is recorded.
+     */
+    void clear();
+
+    static bool isRecycled(short kind)
+    {
+        return kind == MSG_COMMAND_COMPLETED || kind == MSG_CHARGING_UPDATE || kind == MSG_MOBILE_NODE_REQUEST || kind == MSG_MOBILE_NODE_RESPONSE;
+    }
+
+private:
+    /**
+     * Set the generated fields of a recycled message back to their defaults in place, one overload per recycled kind.
+     */
+    static void resetFields(CmdCompletedMsg *msg);
+    static void resetFields(UpdateChargingMsg *msg);
+    static void resetFields(MobileNodeRequest *msg);
+    static void resetFields(MobileNodeResponse *msg);
+
+    std::vector<cMessage *> spares[MSG_KIND_COUNT];
+    bool recycling = true;
+};
+
+#endif /* MESSAGEPOOL_H_ */
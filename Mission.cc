@@ -0,0 +1,60 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#include "Mission.h"
+
+Mission::Mission(const CommandQueue& commands)
+{
+    records.reserve(commands.size());
+    for (unsigned int index = 0; index < commands.size(); index++) {
+        Command* command = commands.at(index);
+        CommandRecord record;
+        record.command = command;
+        record.x = command->getX();
+        record.y = command->getY();
+        record.z = command->getZ();
+        records.push_back(record);
+        indices.insert(std::make_pair(command, index));
+    }
+}
+
+Mission::~Mission()
+{
+    for (auto& record : records) {
+        delete record.command;
+    }
+}
+
+int Mission::indexOf(const Command* command) const
+{
+    auto it = indices.find(command);
+    return (it == indices.end()) ? -1 : (int) it->second;
+}
+
+CommandQueue Mission::getCommands(int cursor, bool repeat) const
+{
+    CommandQueue commands;
+    if (cursor < 0 || cursor >= (int) records.size()) return commands;
+    for (unsigned int index = cursor; index < records.size(); index++) {
+        commands.push_back(records[index].command);
+    }
+    if (repeat) {
+        for (int index = 0; index < cursor; index++) {
+            if (dynamic_cast<TakeoffCommand*>(records[index].command) != nullptr) continue;
+            commands.push_back(records[index].command);
+        }
+    }
+    return commands;
+}
@@ -0,0 +1,100 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef MISSION_H_
+#define MISSION_H_
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "Command.h"
+
+/**
+ * Immutable sequence of mission commands, shared by all nodes and messages serving the mission.
+ * The mission owns its commands, their positions are kept next to them for scans over missions.
+ * Nodes refer to a position in the mission by a cursor, i.e. the index of a command.
+ */
+class Mission {
+public:
+    /**
+     * @param commands Commands of the mission, ownership is transferred to the mission
+     */
+    Mission(const CommandQueue& commands);
+    ~Mission();
+    Mission(const Mission&) = delete;
+    Mission& operator=(const Mission&) = delete;
+
+    unsigned int size() const
+    {
+        return records.size();
+    }
+
+    bool empty() const
+    {
+        return records.empty();
+    }
+
+    Command* getCommand(unsigned int index) const
+    {
+        return records[index].command;
+    }
+
+    double getX(unsigned int index) const
+    {
+        return records[index].x;
+    }
+
+    double getY(unsigned int index) const
+    {
+        return records[index].y;
+    }
+
+    double getZ(unsigned int index) const
+    {
+        return records[index].z;
+    }
+
+    /**
+     * @return Index of the command in the mission, -1 if the command is not part of the mission
+     */
+    int indexOf(const Command* command) const;
+
+    /**
+     * The commands still to be executed by a node whose next mission command is at cursor.
+     * With repeat, the commands before the cursor follow, except TAKEOFF commands as these are not repeated.
+     */
+    CommandQueue getCommands(int cursor, bool repeat) const;
+
+    /**
+     * @return Estimated bytes held by the mission, the commands counted with the size of their base class
+     */
+    size_t getAllocatedBytes() const
+    {
+        return sizeof(Mission) + records.capacity() * sizeof(CommandRecord) + records.size() * sizeof(Command)
+                + indices.size() * (sizeof(std::pair<const Command*, unsigned int>) + 2 * sizeof(void*)) + indices.bucket_count() * sizeof(void*);
+    }
+
+private:
+    struct CommandRecord {
+        Command* command;
+        double x, y, z;
+    };
+    std::vector<CommandRecord> records;
+    std::unordered_map<const Command*, unsigned int> indices;
+};
+
+typedef std::shared_ptr<const Mission> MissionPtr;
+
+#endif /* MISSION_H_ */
@@ -13,27 +13,57 @@
 // along with this program.  If not, see http://www.gnu.org/licenses/.
 //
 
-#ifdef WITH_OSG
 #include "MissionControl.h"
+#include "Profiling.h"
+#include "MessagePool.h"
+#include <algorithm>
+#include <map>
+#include <sstream>
 #include <boost/algorithm/string.hpp>
 #include "msgs/MobileNodeRequest_m.h"
 #include "msgs/MissionMsg_m.h"
+#include "msgs/ReplacementAssignedMsg_m.h"
 
 Define_Module(MissionControl);
 
+// cost of a replacing node that cannot reach the replacement location with its predicted charge
+#define INFEASIBLE_REPLACEMENT_COST 1e6
+
+MissionControl::~MissionControl()
+{
+    cancelAndDelete(assignmentTimer);
+}
+
 void MissionControl::initialize()
 {
+    // the process wide singletons are reset once per run, i.e. by the MissionControl of the first region
+    cModule *region = getParentModule();
+    if (not region->isVector() || region->getIndex() == 0) {
+        Profiling::getInstance().reset();
+        MessagePool::getInstance().clear();
+    }
+
     std::vector<std::string> missionFiles;
     const char* missionFilesString = par("missionFiles").stringValue();
     boost::split(missionFiles, missionFilesString, boost::algorithm::is_any_of(","), boost::token_compress_on);
-    for (auto it = missionFiles.begin(); it != missionFiles.end(); it++) {
-        missionQueue.push_back(loadCommandsFromWaypointsFile(it->c_str()));
+    std::vector<WaypointsFile> files = createWaypointsLoader().load(missionFiles, par("missionLoaderThreads").intValue());
+    int missionCopies = par("missionCopies").intValue();
+    for (auto it = files.begin(); it != files.end(); it++) {
+        MissionPtr mission(new Mission(toCommands(*it)));
+        for (int copy = 0; copy < missionCopies; copy++) {
+            missionQueue.push_back(mission);
+        }
     }
 
-    // Add all GenericNodes to managedNodes list (map)
-    cModule *network = cSimulation::getActiveSimulation()->getSystemModule();
-    for (SubmoduleIterator it(network); !it.end(); ++it) {
+    // Add all GenericNodes of the region (the network or one Region of a RegionalNet) to managedNodes list (map)
+    // and remember the charging nodes
+    chargingNodes.clear();
+    for (SubmoduleIterator it(region); !it.end(); ++it) {
         cModule *module = *it;
+        if (module->isName("cs")) {
+            chargingNodes.push_back(module);
+            continue;
+        }
         if (not module->isName("uav")) {
             continue;
         }
@@ -44,27 +74,47 @@ void MissionControl::initialize()
         managedNodeShadows.add(nodeShadow);
 
         // Initialize all nodes as Idle
-        send(new cMessage("initIdle"), "gate$o", module->getIndex());
+        send(new cMessage("initIdle", MSG_INIT_IDLE), "gate$o", module->getIndex());
 
     }
-    cMessage *start = new cMessage("startScheduling");
+    cMessage *start = new cMessage("startScheduling", MSG_START_SCHEDULING);
     scheduleAt(par("startTime"), start);
+
+    pendingReplacements.clear();
+    assignmentTimer = new cMessage("solveAssignment", MSG_SOLVE_ASSIGNMENT);
+
+    if (par("snapshotTime").doubleValue() >= 0) {
+        scheduleAt(par("snapshotTime"), new cMessage("writeSnapshot", MSG_WRITE_SNAPSHOT));
+    }
 }
 
 void MissionControl::finish()
 {
+    Profiling::getInstance().recordScalars(this);
+    profiling.recordStatistics(this);
+#ifdef WITH_PROFILING
+    std::ostringstream summary;
+    Profiling::getInstance().printSummary(summary);
+    EV_INFO << "Hot path summary:" << endl << summary.str();
+#endif
+
     int missioncount = 0;
-    cModule *network = cSimulation::getActiveSimulation()->getSystemModule();
-    for (SubmoduleIterator it(network); !it.end(); ++it) {
+    MemoryUsage memoryUsage;
+    for (SubmoduleIterator it(getParentModule()); !it.end(); ++it) {
         cModule *module = *it;
         if (module->isName("uav")) {
             UAVNode *node = check_and_cast<UAVNode *>(module);
+            node->addMemoryUsage(memoryUsage);
             if (node->getMissionId() >= 0) {
                 //EV_INFO << "Finish Checks: Mission " << node->getMissionId() << " currently under service by " << node->getFullName() << endl;
                 missioncount++;
             }
         }
+        else if (module->isName("cs")) {
+            check_and_cast<GenericNode *>(module)->addMemoryUsage(memoryUsage);
+        }
     }
+    recordMemoryUsage(memoryUsage);
     if (missioncount == missionQueue.size()) {
         EV_INFO << "Finish Checks: All " << missioncount << " Missions accounted for." << endl;
     }
@@ -74,32 +124,66 @@ void MissionControl::finish()
 
 }
 
-void MissionControl::handleMessage(cMessage *msg)
+/**
+ * Records the memory held by the nodes of the region, the MissionControl and the process wide node arrays.
+ * Warns if the bytes per UAV exceed memoryBudgetPerUAV.
+ */
+void MissionControl::recordMemoryUsage(MemoryUsage& memoryUsage)
 {
-    if (msg->isName("startScheduling")) {
-        for (auto it = missionQueue.begin(); it != missionQueue.end(); it++) {
-            CommandQueue mission = *it;
-            int missionId = it - missionQueue.begin();
-
-            //Select free idle node
-            NodeShadow *nodeShadow = managedNodeShadows.getClosest(NodeStatus::IDLE, mission.front()->getX(), mission.front()->getY(), mission.front()->getZ());
-
-            // Generate and send out start mission message
-            MissionMsg *nodeStartMission = new MissionMsg("startMission");
-            nodeStartMission->setMissionId(missionId);
-            nodeStartMission->setMission(mission);
-            nodeStartMission->setMissionRepeat(true);
-            send(nodeStartMission, "gate$o", nodeShadow->getNodeIndex());
-
-            // Mark node accordingly
-            nodeShadow->setStatus(NodeStatus::RESERVED);
-            nodeShadow->setStatus(NodeStatus::PROVISIONING);
-            nodeShadow->setStatus(NodeStatus::MISSION);
+    managedNodeShadows.addMemoryUsage(memoryUsage);
+    // copies of a mission share it, every mission is counted once
+    std::set<const Mission *> missions;
+    size_t missionBytes = MemoryUsage::ofDeque(missionQueue);
+    for (auto& mission : missionQueue) {
+        if (missions.insert(mission.get()).second) missionBytes += mission->getAllocatedBytes();
+    }
+    memoryUsage.add("missionControl.missions", missionBytes, missions.size());
+    memoryUsage.add("missionControl.assignment", MemoryUsage::ofNodes(pendingReplacements), pendingReplacements.size());
+    const NodeKinematics& kinematics = NodeKinematics::getInstance();
+    memoryUsage.add("process.nodeKinematics", kinematics.getAllocatedBytes(), kinematics.size());
+    memoryUsage.recordScalars(this);
+
+    // everything but the process wide arrays scales with the fleet
+    size_t uavBytes = 0;
+    unsigned int uavs = 0;
+    for (auto& entry : memoryUsage.getEntries()) {
+        if (entry.first.compare(0, 4, "uav.") == 0) uavBytes += entry.second.bytes;
+        if (entry.first == "uav.module") uavs = entry.second.reports;
+    }
+    if (uavs > 0) {
+        double bytesPerUAV = (double) (memoryUsage.getTotalBytes() - kinematics.getAllocatedBytes()) / uavs;
+        recordScalar("memory.perUAV.bytes", bytesPerUAV, "B");
+        double budget = par("memoryBudgetPerUAV").doubleValue();
+        if (budget > 0 && bytesPerUAV > budget) {
+            EV_WARN << "Memory budget exceeded: " << bytesPerUAV << "B per UAV, budget " << budget << "B (" << uavBytes / uavs << "B in the UAVs)" << endl;
+        }
+    }
+    std::ostringstream summary;
+    memoryUsage.printSummary(summary);
+    EV_INFO << "Memory summary:" << endl << summary.str();
+}
 
-            EV_INFO << __func__ << "(): Mission " << missionId << " assigned to node " << nodeShadow->getNode()->getFullName() << " (PROVISIONING)." << endl;
+void MissionControl::handleMessage(cMessage *msg)
+{
+    PROFILE_MESSAGE_SCOPE(profiling, msg);
+    if (msg->getKind() == MSG_START_SCHEDULING) {
+        std::string warmStartFile = par("warmStartFile").stdstringValue();
+        if (warmStartFile.empty()) {
+            assignMissions();
+        }
+        else {
+            restoreSnapshot(Snapshot::read(getRegionFileName(warmStartFile)));
         }
     }
-    else if (msg->isName("commandCompleted")) {
+    else if (msg->getKind() == MSG_WRITE_SNAPSHOT) {
+        writeSnapshot();
+    }
+    else if (msg->getKind() == MSG_SOLVE_ASSIGNMENT) {
+        // the timer is kept for the next assignment window
+        assignPendingReplacements();
+        return;
+    }
+    else if (msg->getKind() == MSG_COMMAND_COMPLETED) {
         CmdCompletedMsg *ccmsg = check_and_cast<CmdCompletedMsg *>(msg);
         NodeShadow* nodeShadow = managedNodeShadows.get(ccmsg->getSourceNodeIndex());
         EV_INFO << __func__ << "(): commandCompleted message received for " << nodeShadow->getNode()->getFullName() << endl;
@@ -108,7 +192,7 @@ void MissionControl::handleMessage(cMessage *msg)
             handleReplacementMessage(ccmsg->getReplacementData());
         }
     }
-    else if (msg->isName("exchangeCompleted")) {
+    else if (msg->getKind() == MSG_EXCHANGE_COMPLETED) {
         ExchangeCompletedMsg* ecmsg = check_and_cast<ExchangeCompletedMsg*>(msg);
         NodeShadow* nodeReplaced = managedNodeShadows.get(ecmsg->getReplacedNodeIndex());
         nodeReplaced->clearReplacementMsg();
@@ -118,77 +202,72 @@ void MissionControl::handleMessage(cMessage *msg)
         NodeShadow* nodeReplacing = managedNodeShadows.get(ecmsg->getReplacingNodeIndex());
         nodeReplacing->setStatus(NodeStatus::MISSION);
     }
-    else if (msg->isName("chargingUpdate")) {
+    else if (msg->getKind() == MSG_CHARGING_UPDATE) {
         UpdateChargingMsg* ucmsg = check_and_cast<UpdateChargingMsg*>(msg);
-        std::vector<std::string> nodes;
-        std::vector<std::string> info;
-        const char* nodeString = ucmsg->getUpdate();
-        if (std::strlen(nodeString) > 0) {
-            boost::split(nodes, nodeString, boost::algorithm::is_any_of(";"), boost::token_compress_on);
-            for (auto it = nodes.cbegin(); it != nodes.cend() && (std::strlen(it->c_str()) > 0); it++) {
-                boost::split(info, *it, boost::algorithm::is_any_of(","), boost::token_compress_on);
-                NodeShadow* shadow = managedNodeShadows.get(std::stoi(info.at(0)));
-                shadow->setKnownBattery(new Battery(std::stof(info.at(2)), std::stof(info.at(1))));
-                if (not shadow->isStatusReserved()) {
-                    if (shadow->getKnownBattery()->getRemainingPercentage() > 99)
-                        shadow->setStatus(NodeStatus::IDLE);
-                    else
-                        shadow->setStatus(NodeStatus::CHARGING);
-                    EV_TRACE << "shadow node update:" << shadow->getNode()->getFullName() << ": status:" << shadow->getStatusString() << " battery:"
-                            << shadow->getKnownBattery()->getRemainingPercentage() << "%" << endl;
-                }
+        for (unsigned int k = 0; k < ucmsg->getEntriesArraySize(); k++) {
+            const ChargingUpdateEntry& entry = ucmsg->getEntries(k);
+            if (entry.status != SPOT_CHARGING) continue;
+            NodeShadow* shadow = managedNodeShadows.get(entry.nodeIndex);
+            shadow->setKnownBattery(entry.capacity, entry.remaining);
+            if (not shadow->isStatusReserved()) {
+                if (shadow->getKnownBattery()->getRemainingPercentage() > 99)
+                    shadow->setStatus(NodeStatus::IDLE);
+                else
+                    shadow->setStatus(NodeStatus::CHARGING);
+                EV_TRACE << "shadow node update:" << shadow->getNode()->getFullName() << ": status:" << shadow->getStatusString() << " battery:"
+                        << shadow->getKnownBattery()->getRemainingPercentage() << "%" << endl;
             }
         }
     }
-    else if (msg->isName("provisionReplacement")) {
+    else if (msg->getKind() == MSG_PROVISION_REPLACEMENT) {
         // Identify node requesting replacement
         NodeShadow* nodeShadow = managedNodeShadows.getNodeRequestingReplacement(msg);
         GenericNode *replacingNode = nodeShadow->getReplacingNode();
-        ReplacementData *replData = nodeShadow->getReplacementData();
+        const ReplacementData& replData = nodeShadow->getReplacementData();
         EV_INFO << "provisionReplacement message received for node " << nodeShadow->getNode()->getFullName() << endl;
 
         // When the replacing node is charging currently send a message to stop the process
         if (replacingNode->getCommandExecEngine()) {
             if (replacingNode->getCommandExecEngine()->getCeeType() == CeeType::CHARGE) {
-                cMessage *exitMessage = new cMessage("mobileNodeExit");
+                cMessage *exitMessage = new cMessage("mobileNodeExit", MSG_MOBILE_NODE_EXIT);
                 send(exitMessage, "gate$o", replacingNode->getIndex());
             }
         }
 
         // Send provision mission to replacing node
         CommandQueue provMission;
-        provMission.push_back(new WaypointCommand(replData->x, replData->y, replData->z));
+        provMission.push_back(new WaypointCommand(replData.x, replData.y, replData.z));
         ExchangeCommand* exchangeCommand = new ExchangeCommand(nodeShadow->getNode(), false, false);
-        exchangeCommand->setX(replData->x);
-        exchangeCommand->setY(replData->y);
-        exchangeCommand->setZ(replData->z);
+        exchangeCommand->setX(replData.x);
+        exchangeCommand->setY(replData.y);
+        exchangeCommand->setZ(replData.z);
         provMission.push_back(exchangeCommand);
-        MissionMsg *nodeStartMission = new MissionMsg("startProvision");
-        nodeStartMission->setMission(provMission);
+        MissionMsg *nodeStartMission = new MissionMsg("startProvision", MSG_START_PROVISION);
+        nodeStartMission->setMission(MissionPtr(new Mission(provMission)));
         send(nodeStartMission, "gate$o", replacingNode->getIndex());
 
-        // Set "otherNode" for exchangeCEE of replaced node
-        // TODO: This is part of hack111...
-        UAVNode *replacedNode = dynamic_cast<UAVNode *>(nodeShadow->getNode());
-        replacedNode->replacingNode = replacingNode;
-        replacedNode->replacementX = replData->x;
-        replacedNode->replacementY = replData->y;
-        replacedNode->replacementZ = replData->z;
-        replacedNode->replacementTime = replData->timeOfReplacement;
+        // Tell the replaced node the "otherNode" of its exchangeCEE
+        ReplacementAssignedMsg *assignedMsg = new ReplacementAssignedMsg("replacementAssigned", MSG_REPLACEMENT_ASSIGNED);
+        assignedMsg->setReplacingNodeIndex(replacingNode->getIndex());
+        assignedMsg->setX(replData.x);
+        assignedMsg->setY(replData.y);
+        assignedMsg->setZ(replData.z);
+        assignedMsg->setTimeOfReplacement(replData.timeOfReplacement);
+        send(assignedMsg, "gate$o", nodeShadow->getNodeIndex());
 
         nodeShadow->setReplacementMsg(nullptr);
         managedNodeShadows.setStatus(replacingNode, NodeStatus::PROVISIONING);
 
         EV_INFO << __func__ << "(): Mission PROVISION assigned to node " << replacingNode->getFullName();
         EV_INFO << " (replacing node " << nodeShadow->getNode()->getFullName() << ")" << endl;
-        EV_DEBUG << "Node replacement at (" << replData->x << ", " << replData->y << ", " << replData->z << ")" << endl;
+        EV_DEBUG << "Node replacement at (" << replData.x << ", " << replData.y << ", " << replData.z << ")" << endl;
     }
-    else if (msg->isName("mobileNodeResponse")) {
+    else if (msg->getKind() == MSG_MOBILE_NODE_RESPONSE) {
         // write requested mobileNode information in corresponding nodeShadow's
         MobileNodeResponse *mnmsg = check_and_cast<MobileNodeResponse *>(msg);
         if (mnmsg->getNodeFound()) {
             NodeShadow* nodeShadow = managedNodeShadows.get(mnmsg->getMobileNodeIndex());
-            nodeShadow->setKnownBattery(new Battery(mnmsg->getCapacity(), mnmsg->getRemaining()));
+            nodeShadow->setKnownBattery(mnmsg->getCapacity(), mnmsg->getRemaining());
             if (not nodeShadow->isStatusReserved() && not nodeShadow->isStatusMission() && not nodeShadow->isStatusProvisioning()) {
                 if (mnmsg->getCapacity() > mnmsg->getRemaining())
                     nodeShadow->setStatus(NodeStatus::CHARGING);
@@ -197,17 +276,14 @@ void MissionControl::handleMessage(cMessage *msg)
             }
         }
         else {
-            std::string message = "No mobile node found for message: ";
-            message += mnmsg->getFullName();
-            EV_DEBUG << message << endl;
+            EV_DEBUG << "No mobile node found for message: " << mnmsg->getFullName() << endl;
         }
     }
     else {
-        std::string message = "Unknown message name encountered: ";
-        message += msg->getFullName();
-        throw cRuntimeError(message.c_str());
+        throw cRuntimeError("Unknown message name encountered: %s", msg->getFullName());
     }
-    delete msg;
+    // commandCompleted, chargingUpdate and mobileNodeResponse messages are reused by the nodes
+    MessagePool::getInstance().release(msg);
 }
 
 /**
@@ -217,8 +293,9 @@ void MissionControl::handleMessage(cMessage *msg)
  *
  * @param replData Incoming ReplacementData
  */
-void MissionControl::handleReplacementMessage(ReplacementData replData)
+void MissionControl::handleReplacementMessage(const ReplacementData& replData)
 {
+    PROFILE_MODULE_SCOPE(profiling, "MissionControl::handleReplacementMessage");
     NodeShadow* nodeShadow = managedNodeShadows.get(replData.nodeToReplace);
 
     // TODO: Test if new selection would differ...
@@ -231,9 +308,19 @@ void MissionControl::handleReplacementMessage(ReplacementData replData)
                     << ". No re-calculation needed. " << endl;
             return;
         }
-        nodeShadow->setReplacementData(new ReplacementData(replData));
+        nodeShadow->setReplacementData(replData);
         nodeShadow->setReplacingNode(replNode);
     }
+    else if (par("assignmentMethod").intValue() == 1) {
+        // Assigned together with the other requests of the assignment window
+        nodeShadow->setReplacementData(replData);
+        pendingReplacements.insert(nodeShadow->getNodeIndex());
+        if (not assignmentTimer->isScheduled()) {
+            scheduleAt(simTime() + par("assignmentWindow"), assignmentTimer);
+        }
+        EV_INFO << __func__ << "(): " << nodeShadow->getNode()->getFullName() << ": replacement request pending until " << assignmentTimer->getArrivalTime() << endl;
+        return;
+    }
     else {
         // ToDo: Add highest capacity from config
         this->requestChargedNodesInformation(5400);
@@ -261,40 +348,148 @@ void MissionControl::handleReplacementMessage(ReplacementData replData)
 
         // Assign as replacing node to this node
         replacingNodeShadow->setStatus(NodeStatus::RESERVED);
-        nodeShadow->setReplacementData(new ReplacementData(replData));
+        nodeShadow->setReplacementData(replData);
         nodeShadow->setReplacingNode(replacingNodeShadow->getNode());
 
         EV_INFO << __func__ << "(): " << nodeShadow->getNode()->getFullName() << ":";
         EV_INFO << " node " << nodeShadow->getReplacingNode()->getFullName() << " reserved for replacement" << endl;
     }
 
-    simtime_t timeOfProvisioning;
+    scheduleProvisioning(nodeShadow);
+}
+
+/**
+ * Assign every mission of the queue to an IDLE node. Either mission by mission to the closest node,
+ * or all missions at once with the minimal sum of the distances from the nodes to the mission starts (assignmentMethod 1).
+ */
+void MissionControl::assignMissions()
+{
+    std::vector<NodeShadow*> assigned;
+    if (par("assignmentMethod").intValue() == 1) {
+        std::vector<NodeShadow*> idle = managedNodeShadows.getAll(NodeStatus::IDLE);
+        unsigned int rows = missionQueue.size(), columns = idle.size();
+        if (rows > columns) {
+            throw cRuntimeError("assignMissions(): %u missions cannot be assigned to %u idle nodes", rows, columns);
+        }
+        std::vector<double> costs(rows * columns);
+        for (unsigned int i = 0; i < rows; i++) {
+            const MissionPtr& mission = missionQueue[i];
+            for (unsigned int j = 0; j < columns; j++) {
+                GenericNode *node = idle[j]->getNode();
+                double dx = node->getX() - mission->getX(0), dy = node->getY() - mission->getY(0), dz = node->getZ() - mission->getZ(0);
+                costs[i * columns + j] = sqrt(dx * dx + dy * dy + dz * dz);
+            }
+        }
+        const std::vector<int>& assignment = assignmentSolver.solve(costs, rows, columns);
+        for (unsigned int i = 0; i < rows; i++) {
+            assigned.push_back(idle[assignment[i]]);
+        }
+    }
+
+    for (auto it = missionQueue.begin(); it != missionQueue.end(); it++) {
+        MissionPtr mission = *it;
+        int missionId = it - missionQueue.begin();
+
+        //Select free idle node
+        NodeShadow *nodeShadow = assigned.empty() ? managedNodeShadows.getClosest(NodeStatus::IDLE, mission->getX(0), mission->getY(0), mission->getZ(0)) : assigned[missionId];
+
+        // Generate and send out start mission message
+        MissionMsg *nodeStartMission = new MissionMsg("startMission", MSG_START_MISSION);
+        nodeStartMission->setMissionId(missionId);
+        nodeStartMission->setMission(mission);
+        nodeStartMission->setMissionRepeat(true);
+        send(nodeStartMission, "gate$o", nodeShadow->getNodeIndex());
+
+        // Mark node accordingly
+        nodeShadow->setStatus(NodeStatus::RESERVED);
+        nodeShadow->setStatus(NodeStatus::PROVISIONING);
+        nodeShadow->setStatus(NodeStatus::MISSION);
+
+        EV_INFO << __func__ << "(): Mission " << missionId << " assigned to node " << nodeShadow->getNode()->getFullName() << " (PROVISIONING)." << endl;
+    }
+}
+
+/**
+ * Assign replacing nodes to all pending replacement requests at once.
+ * The cost of a pair is the negative predicted charge of the replacing node at the replacement location,
+ * so the matching maximizes the sum of the charges at replacement. Nodes that cannot reach the location
+ * are only chosen if no other node is left.
+ * If there are more requests than available nodes, the earliest replacements are assigned and the others
+ * wait for the next assignment window.
+ */
+void MissionControl::assignPendingReplacements()
+{
+    PROFILE_MODULE_SCOPE(profiling, "MissionControl::assignPendingReplacements");
+    if (pendingReplacements.empty()) return;
+
+    // ToDo: Add highest capacity from config
+    this->requestChargedNodesInformation(5400);
+
+    std::vector<NodeShadow*> requests;
+    for (int index : pendingReplacements) {
+        requests.push_back(managedNodeShadows.get(index));
+    }
+    std::stable_sort(requests.begin(), requests.end(), [](NodeShadow* a, NodeShadow* b) {
+        return a->getReplacementTime() < b->getReplacementTime();
+    });
+
+    std::vector<NodeShadow*> candidates = managedNodeShadows.getAvailableForReplacement();
+    unsigned int rows = std::min(requests.size(), candidates.size()), columns = candidates.size();
+    std::vector<double> costs(rows * columns);
+    for (unsigned int i = 0; i < rows; i++) {
+        const ReplacementData& replData = requests[i]->getReplacementData();
+        double *row = costs.data() + i * columns;
+        managedNodeShadows.estimateRemainingAtReplacement(candidates, replData.x, replData.y, replData.z, row);
+        for (unsigned int j = 0; j < columns; j++) {
+            row[j] = (row[j] > 0) ? -row[j] : INFEASIBLE_REPLACEMENT_COST - row[j];
+        }
+    }
+
+    const std::vector<int>& assignment = assignmentSolver.solve(costs, rows, columns);
+    for (unsigned int i = 0; i < rows; i++) {
+        NodeShadow* nodeShadow = requests[i];
+        NodeShadow* replacingNodeShadow = candidates[assignment[i]];
+        replacingNodeShadow->setStatus(NodeStatus::RESERVED);
+        nodeShadow->setReplacingNode(replacingNodeShadow->getNode());
+        pendingReplacements.erase(nodeShadow->getNodeIndex());
+
+        EV_INFO << __func__ << "(): " << nodeShadow->getNode()->getFullName() << ":";
+        EV_INFO << " node " << replacingNodeShadow->getNode()->getFullName() << " reserved for replacement" << endl;
+        scheduleProvisioning(nodeShadow);
+    }
+
+    if (not pendingReplacements.empty()) {
+        EV_WARN << __func__ << "(): no node available for " << pendingReplacements.size() << " replacement requests, retrying in the next window" << endl;
+        scheduleAt(simTime() + par("assignmentWindow"), assignmentTimer);
+    }
+}
+
+/**
+ * (Re)schedule the 'provisionReplacement' self-message of a node with a replacing node.
+ * An already scheduled message is moved to the new provisioning time instead of being replaced,
+ * and left alone if the time did not change.
+ */
+void MissionControl::scheduleProvisioning(NodeShadow *nodeShadow)
+{
     //Retrieve provisioning time
     UAVNode* replacingUavNode = check_and_cast<UAVNode *>(nodeShadow->getReplacingNode());
+    const ReplacementData& replData = nodeShadow->getReplacementData();
+    WaypointCommand provisioningCommand(replData.x, replData.y, replData.z);
     CommandQueue commands;
-    commands.push_back(new WaypointCommand(nodeShadow->getReplacementData()->x, nodeShadow->getReplacementData()->y, nodeShadow->getReplacementData()->z));
+    commands.push_back(&provisioningCommand);
     simtime_t timeOfReplacement = nodeShadow->getReplacementTime();
-    CommandQueue* extractedCommands = replacingUavNode->extractAllCommands();
-    replacingUavNode->clearCommands();
-    replacingUavNode->loadCommands(commands);
-    double timeForProvisioning = replacingUavNode->estimateCommandsDuration();
-    timeOfProvisioning = timeOfReplacement - timeForProvisioning;
-    replacingUavNode->clearCommands();
-    replacingUavNode->loadCommands(*extractedCommands, false);
-    delete extractedCommands;
+    double timeForProvisioning = replacingUavNode->estimateDuration(commands);
+    simtime_t timeOfProvisioning = timeOfReplacement - timeForProvisioning;
 
-    cMessage *replacementMsg = new cMessage("provisionReplacement");
+    bool reprovision = nodeShadow->hasReplacementMsg() && nodeShadow->getReplacementMsg()->isSelfMessage();
+    cMessage *replacementMsg = reprovision ? nodeShadow->getReplacementMsg() : new cMessage("provisionReplacement", MSG_PROVISION_REPLACEMENT);
 
     if (simTime() < timeOfProvisioning) {
-        // Delete and reschedule if old msg available
-        bool reprovision = false;
-        if (nodeShadow->hasReplacementMsg()) {
-            if (nodeShadow->getReplacementMsg()->isSelfMessage()) {
-                cancelEvent(nodeShadow->getReplacementMsg());
-                delete nodeShadow->getReplacementMsg();
-                reprovision = true;
-            }
+        if (reprovision && replacementMsg->isScheduled() && replacementMsg->getArrivalTime() == timeOfProvisioning) {
+            EV_DEBUG << __func__ << "(): Provision time of node " << nodeShadow->getNode()->getFullName() << " unchanged." << endl;
+            return;
         }
+        if (reprovision) cancelEvent(replacementMsg);
         nodeShadow->setReplacementMsg(replacementMsg);
         scheduleAt(timeOfProvisioning, replacementMsg);
         EV_INFO << __func__ << "(): " << (reprovision ? "Updating provision time." : "Provisioning node.");
@@ -304,18 +499,10 @@ void MissionControl::handleReplacementMessage(ReplacementData replData)
     }
     else {
         // this happens if the replacingNode cannot reach replacement location "in time"
-
-        // cancel old message
-        if (nodeShadow->hasReplacementMsg()) {
-            if (nodeShadow->getReplacementMsg()->isSelfMessage()) {
-                cancelEvent(nodeShadow->getReplacementMsg());
-                delete nodeShadow->getReplacementMsg();
-            }
-        }
+        if (reprovision) cancelEvent(replacementMsg);
         nodeShadow->setReplacementMsg(replacementMsg);
         timeOfProvisioning = simTime() + timeForProvisioning;
 
-        // schedule new one
         scheduleAt(simTime(), replacementMsg);
 
         EV_WARN << "Prediction time is in the past. Updating provision time.";
@@ -325,6 +512,125 @@ void MissionControl::handleReplacementMessage(ReplacementData replData)
     }
 }
 
+/**
+ * Every region of a RegionalNet has its own MissionControl, its files get the region as suffix in front of the extension,
+ * e.g. "state-region[1].snapshot", like the files of the TelemetryRecorder.
+ */
+std::string MissionControl::getRegionFileName(const std::string& fileName) const
+{
+    if (getParentModule() == getSystemModule()) return fileName;
+    size_t extension = fileName.rfind('.');
+    if (extension == std::string::npos || extension < fileName.find_last_of('/') + 1) extension = fileName.size();
+    return fileName.substr(0, extension) + "-" + getParentModule()->getFullName() + fileName.substr(extension);
+}
+
+/**
+ * Write the positions, batteries, missions, node shadow statuses, charging queues and random stream
+ * positions of all UAVs of the region to snapshotFile.
+ */
+void MissionControl::writeSnapshot()
+{
+    Snapshot snapshot;
+    snapshot.simTime = simTime().dbl();
+    snapshot.missionCount = missionQueue.size();
+    for (SubmoduleIterator it(getParentModule()); !it.end(); ++it) {
+        cModule *module = *it;
+        if (not module->isName("uav")) continue;
+        UAVNode *node = check_and_cast<UAVNode *>(module);
+        snapshot.seedSet = node->getRunSeedSet();
+        Snapshot::NodeState state = node->getSnapshotState();
+        state.status = (int32_t) managedNodeShadows.get(node)->getStatus();
+        snapshot.nodes.push_back(state);
+    }
+    for (auto it = chargingNodes.begin(); it != chargingNodes.end(); it++) {
+        ChargingNode *chargingNode = check_and_cast<ChargingNode *>(*it);
+        snapshot.chargingNodes.push_back( { chargingNode->getIndex(), chargingNode->getQueuedNodeIndices() });
+    }
+
+    std::string fileName = getRegionFileName(par("snapshotFile").stdstringValue());
+    snapshot.write(fileName);
+    EV_INFO << __func__ << "(): State of " << snapshot.nodes.size() << " nodes written to " << fileName << endl;
+}
+
+/**
+ * Warm start from a snapshot, replaces the mission assignment at startTime.
+ * UAVs that served a mission continue it at the stored command, UAVs that headed to or were at a charging node
+ * are placed at it and queued in the stored order, all other UAVs stay idle at their stored position.
+ * Replacements and reservations in progress are not stored, they are requested again by the UAVs.
+ */
+void MissionControl::restoreSnapshot(const Snapshot& snapshot)
+{
+    if (snapshot.missionCount != missionQueue.size()) {
+        throw cRuntimeError("restoreSnapshot(): Snapshot holds %u missions, %d missions are loaded", snapshot.missionCount, (int) missionQueue.size());
+    }
+    if ((int) snapshot.nodes.size() != managedNodeShadows.size()) {
+        throw cRuntimeError("restoreSnapshot(): Snapshot holds %d nodes, %d nodes are managed", (int) snapshot.nodes.size(), managedNodeShadows.size());
+    }
+
+    cModule *region = getParentModule();
+    std::map<int, std::vector<MobileNode *>> chargingQueues;
+    std::set<int> charging;
+    for (auto it = snapshot.nodes.begin(); it != snapshot.nodes.end(); it++) {
+        const Snapshot::NodeState& state = *it;
+        UAVNode *node = check_and_cast<UAVNode *>(region->getSubmodule("uav", state.index));
+        NodeShadow *nodeShadow = managedNodeShadows.get(state.index);
+        Snapshot::NodeState restored = state;
+
+        if (state.missionId >= 0) {
+            if (state.missionId >= (int) missionQueue.size()) throw cRuntimeError("restoreSnapshot(): Unknown mission %d", state.missionId);
+            node->restoreSnapshotState(restored, snapshot.seedSet);
+            MissionMsg *nodeStartMission = new MissionMsg("startMission", MSG_START_MISSION);
+            nodeStartMission->setMissionId(state.missionId);
+            nodeStartMission->setMission(missionQueue[state.missionId]);
+            nodeStartMission->setMissionCursor(std::max(state.missionCursor, 0));
+            nodeStartMission->setMissionRepeat(state.missionRepeat != 0);
+            send(nodeStartMission, "gate$o", nodeShadow->getNodeIndex());
+            nodeShadow->setStatus(NodeStatus::RESERVED);
+            nodeShadow->setStatus(NodeStatus::PROVISIONING);
+            nodeShadow->setStatus(NodeStatus::MISSION);
+        }
+        else if (state.chargingNode >= 0 && state.remaining < state.capacity) {
+            ChargingNode *chargingNode = check_and_cast<ChargingNode *>(region->getSubmodule("cs", state.chargingNode));
+            restored.x = chargingNode->getX();
+            restored.y = chargingNode->getY();
+            restored.z = chargingNode->getZ();
+            node->restoreSnapshotState(restored, snapshot.seedSet);
+            CommandQueue commands;
+            commands.push_back(new ChargeCommand(chargingNode));
+            commands.push_back(new IdleCommand());
+            MissionMsg *nodeStartCharge = new MissionMsg("startProvision", MSG_START_PROVISION);
+            nodeStartCharge->setMission(MissionPtr(new Mission(commands)));
+            send(nodeStartCharge, "gate$o", nodeShadow->getNodeIndex());
+            nodeShadow->setStatus(NodeStatus::CHARGING);
+            charging.insert(state.index);
+        }
+        else {
+            // a new idle CEE at the restored position
+            node->restoreSnapshotState(restored, snapshot.seedSet);
+            send(new cMessage("initIdle", MSG_INIT_IDLE), "gate$o", nodeShadow->getNodeIndex());
+        }
+        nodeShadow->setKnownBattery(state.capacity, state.remaining);
+    }
+
+    // charging queues in the stored order, UAVs that had no spot yet are appended
+    for (auto it = snapshot.chargingNodes.begin(); it != snapshot.chargingNodes.end(); it++) {
+        for (int32_t index : it->queue) {
+            if (charging.erase(index)) chargingQueues[it->index].push_back(check_and_cast<MobileNode *>(region->getSubmodule("uav", index)));
+        }
+    }
+    for (int index : charging) {
+        const Snapshot::NodeState& state = *std::find_if(snapshot.nodes.begin(), snapshot.nodes.end(), [index](const Snapshot::NodeState& s) {
+            return s.index == index;
+        });
+        chargingQueues[state.chargingNode].push_back(check_and_cast<MobileNode *>(region->getSubmodule("uav", index)));
+    }
+    for (auto it = chargingQueues.begin(); it != chargingQueues.end(); it++) {
+        check_and_cast<ChargingNode *>(region->getSubmodule("cs", it->first))->restoreQueue(it->second);
+    }
+
+    EV_INFO << __func__ << "(): State of " << snapshot.nodes.size() << " nodes restored from the snapshot at " << snapshot.simTime << "s" << endl;
+}
+
 /**
  * Load commands from a Mission Planner *.waypoints text file.
  * See: http://qgroundcontrol.org/mavlink/waypoint_protocol#waypoint_file_format
@@ -333,83 +639,56 @@ void MissionControl::handleReplacementMessage(ReplacementData replData)
  */
 CommandQueue MissionControl::loadCommandsFromWaypointsFile(const char* fileName)
 {
-    CommandQueue commands;
-    std::ifstream inputFile(fileName);
-    int lineCnt = 1;
-    int cmdId, unknown1, unknown2, commandType;
-    std::string commandName;
-    double p1, p2, p3, p4;
-    double lat, lon, alt;
-    int unknown3;
-
-    // Skip first line (header)
-    std::string str;
-    std::getline(inputFile, str);
-    EV_INFO << "Line " << lineCnt << " skipped (1)" << endl;
-    // Skip second line (home)
-    lineCnt++;
-    std::getline(inputFile, str);
-    EV_INFO << "Line " << lineCnt << " skipped (2)" << endl;
-
-    while (true) {
-        lineCnt++;
-        inputFile >> cmdId >> unknown1 >> unknown2 >> commandType >> p1 >> p2 >> p3 >> p4 >> lat >> lon >> alt >> unknown3;
-
-        if (inputFile.fail()) { //TODO differentiate between EOF and failure
-            EV_INFO << "Line " << lineCnt << " failed (EOF)" << endl;
-            break;
-        }
-        //EV_INFO << "Line " << lineCnt << " okay" << endl;
+    return toCommands(createWaypointsLoader().load(fileName));
+}
 
-        switch (commandType) {
-            case 16: { // WAYPOINT
-                commands.push_back(new WaypointCommand(OsgEarthScene::getInstance()->toX(lon), OsgEarthScene::getInstance()->toY(lat), alt));
-                EV_DEBUG << "WaypointCommand(" << OsgEarthScene::getInstance()->toX(lon) << ", " << OsgEarthScene::getInstance()->toY(lat) << ", " << alt << ")"
-                        << endl;
-                break;
-            }
-            case 17: { // LOITER_UNLIM
-                throw cRuntimeError("loadCommandsFromWaypointsFile(): Command not implemented yet: LOITER_UNLIM");
-                break;
-            }
-            case 19: { // LOITER_TIME
-                commands.push_back(new HoldPositionCommand(OsgEarthScene::getInstance()->toX(lon), OsgEarthScene::getInstance()->toY(lat), alt, p1));
-                EV_DEBUG << "HoldPositionCommand(" << OsgEarthScene::getInstance()->toX(lon) << ", " << OsgEarthScene::getInstance()->toY(lat) << ", " << alt
-                        << ", " << p1 << ")" << endl;
-                break;
-            }
-            case 20: { // RETURN_TO_LAUNCH
-                throw cRuntimeError("loadCommandsFromWaypointsFile(): Command not implemented yet: RETURN_TO_LAUNCH");
-                break;
-            }
-            case 21: { // LAND
-                throw cRuntimeError("loadCommandsFromWaypointsFile(): Command not implemented yet: LAND");
+/**
+ * Projection and cache directory are taken from the network and module parameters.
+ */
+WaypointsLoader MissionControl::createWaypointsLoader()
+{
+    cModule *network = cSimulation::getActiveSimulation()->getSystemModule();
+    WaypointsProjection projection(network->par("playgroundLatitude").doubleValue(), network->par("playgroundLongitude").doubleValue());
+    return WaypointsLoader(projection, par("missionCacheDirectory").stdstringValue());
+}
+
+/**
+ * Create the commands of a loaded *.waypoints file.
+ *
+ * @throws cRuntimeError if the file could not be loaded
+ */
+CommandQueue MissionControl::toCommands(const WaypointsFile& file)
+{
+    if (not file.error.empty()) {
+        throw cRuntimeError("loadCommandsFromWaypointsFile(): %s", file.error.c_str());
+    }
+
+    CommandQueue commands;
+    for (auto it = file.records.begin(); it != file.records.end(); it++) {
+        switch (it->commandType) {
+            case WAYPOINTS_CMD_WAYPOINT:
+                commands.push_back(new WaypointCommand(it->x, it->y, it->z));
                 break;
-            }
-            case 22: { // TAKEOFF
-                commands.push_back(new TakeoffCommand(alt));
-                EV_DEBUG << "TakeoffCommand(" << alt << ")" << endl;
+            case WAYPOINTS_CMD_LOITER_TIME:
+                commands.push_back(new HoldPositionCommand(it->x, it->y, it->z, it->p1));
                 break;
-            }
-            default: {
-                throw cRuntimeError("loadCommandsFromWaypointsFile(): Unexpected file content.");
+            case WAYPOINTS_CMD_TAKEOFF:
+                commands.push_back(new TakeoffCommand(it->z));
                 break;
-            }
+            default:
+                throw cRuntimeError("loadCommandsFromWaypointsFile(): Unexpected command %d in %s.", it->commandType, file.fileName.c_str());
         }
     }
+    EV_INFO << file.fileName << ": " << commands.size() << " commands loaded" << (file.fromCache ? " from cache." : ".") << endl;
     return commands;
 }
 
 void MissionControl::requestChargedNodesInformation(double remainingBattery)
 {
     // Send request to all ChargingStations
-    cModule *network = cSimulation::getActiveSimulation()->getSystemModule();
-    for (SubmoduleIterator it(network); !it.end(); ++it) {
-        cModule *module = *it;
-        if (not module->isName("cs")) {
-            continue;
-        }
-        MobileNodeRequest *mnRequest = new MobileNodeRequest("mobileNodeRequest");
+    for (cModule *module : chargingNodes) {
+        MobileNodeRequest *mnRequest = MessagePool::getInstance().acquire<MobileNodeRequest>(MSG_MOBILE_NODE_REQUEST);
+        if (mnRequest->getOwner() != this) take(mnRequest);
         mnRequest->setRemaining(remainingBattery);
         send(mnRequest, getOutputGateTo(module));
     }
@@ -417,23 +696,12 @@ void MissionControl::requestChargedNodesInformation(double remainingBattery)
 
 /**
  * Find and return the cGate pointing to another cModule.
+ * The gates are looked up in a table built on the first call instead of scanning all gates.
  *
  * @param cMod
  * @return cGate*, 'nullptr' if no gate found
  */
 cGate* MissionControl::getOutputGateTo(cModule *cMod)
 {
-    for (int i = 0; i < this->gateCount(); i++) {
-        cGate *gate = this->gateByOrdinal(i);
-        if (gate->getType() == cGate::Type::OUTPUT) {
-            cModule *gateOwner = gate->getPathEndGate()->getOwnerModule();
-            if (gateOwner == cMod) {
-                return gate;
-            }
-            //EV_INFO << "Node is connected to " << gateOwner->getFullName() << " through gate at index " << i << ": " << gate->getFullName() << endl;
-        }
-    }
-    return nullptr;
+    return outputGates.getOutputGateTo(this, cMod);
 }
-
-#endif // WITH_OSG
@@ -19,6 +19,8 @@
 #include <omnetpp.h>
 
 #include <deque>
+#include <set>
+#include <vector>
 
 #include "OsgEarthScene.h"
 #include "Command.h"
@@ -32,6 +34,10 @@
 #include "msgs/MobileNodeRequest_m.h"
 #include "msgs/MobileNodeResponse_m.h"
 #include "MissionControlDataMap.h"
+#include "GateRoutingTable.h"
+#include "AssignmentSolver.h"
+#include "Snapshot.h"
+#include "WaypointsLoader.h"
 
 using namespace omnetpp;
 
@@ -41,14 +47,36 @@ using namespace omnetpp;
 class MissionControl : public cSimpleModule {
 private:
     ManagedNodeShadows managedNodeShadows;
-    std::deque<CommandQueue> missionQueue;
+    std::deque<MissionPtr> missionQueue;
+    /// Message handler timers, empty unless compiled with WITH_PROFILING
+    ModuleProfiling profiling;
+    /// Output gate per node, see getOutputGateTo()
+    GateRoutingTable outputGates;
+    /// All charging nodes of the network, collected in initialize()
+    std::vector<cModule *> chargingNodes;
+    /// Batch assignment of missions and replacements, see assignmentMethod
+    AssignmentSolver assignmentSolver;
+    /// Nodes waiting for a replacing node until the assignmentTimer fires
+    std::set<int> pendingReplacements;
+    cMessage *assignmentTimer = nullptr;
+public:
+    virtual ~MissionControl();
 protected:
     virtual void initialize() override;
     virtual void finish() override;
     virtual void handleMessage(cMessage *msg) override;
     virtual CommandQueue loadCommandsFromWaypointsFile(const char *fileName);
-    virtual void handleReplacementMessage(ReplacementData replData);
+    virtual CommandQueue toCommands(const WaypointsFile& file);
+    WaypointsLoader createWaypointsLoader();
+    virtual void handleReplacementMessage(const ReplacementData& replData);
+    virtual void assignMissions();
+    virtual void assignPendingReplacements();
+    virtual void scheduleProvisioning(NodeShadow *nodeShadow);
+    std::string getRegionFileName(const std::string& fileName) const;
+    virtual void writeSnapshot();
+    virtual void restoreSnapshot(const Snapshot& snapshot);
     virtual void requestChargedNodesInformation(double remainingBattery);
+    virtual void recordMemoryUsage(MemoryUsage& memoryUsage);
     virtual cGate* getOutputGateTo(cModule *cMod);
 };
 
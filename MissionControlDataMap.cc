@@ -13,24 +13,33 @@
 // along with this program.  If not, see http://www.gnu.org/licenses/.
 //
 
+#include <algorithm>
+#include <iterator>
 #include "MissionControlDataMap.h"
+#include "TelemetryRecorder.h"
 #include <omnetpp.h>
 
 NodeShadow::NodeShadow(GenericNode* node)
 {
     this->node = node;
     this->index = node->getIndex();
+    this->kinematicsSlot = node->getKinematicsSlot();
+    NodeKinematics::getInstance().setStatus(kinematicsSlot, (int) status);
 }
 
 NodeShadow::~NodeShadow()
 {
-    delete knownBattery;
+    // the node may be deleted before the MissionControl, only reset the slot if it still belongs to the node
+    NodeKinematics& kinematics = NodeKinematics::getInstance();
+    if (kinematicsSlot < kinematics.size() && kinematics.getNode(kinematicsSlot) == node) {
+        kinematics.setStatus(kinematicsSlot, NodeKinematics::NO_STATUS);
+    }
 }
 
-void NodeShadow::setReplacementData(ReplacementData* replacementData)
+void NodeShadow::setReplacementData(const ReplacementData& replacementData)
 {
-    if (this->replacementData != nullptr) delete this->replacementData;
     this->replacementData = replacementData;
+    replacementDataValid = true;
 }
 
 void NodeShadow::setReplacementMsg(cMessage* replacementMsg)
@@ -38,9 +47,15 @@ void NodeShadow::setReplacementMsg(cMessage* replacementMsg)
     this->replacementMsg = replacementMsg;
 }
 
+void NodeShadow::notifyKnownBatteryChanged()
+{
+    if (managedBy != nullptr) managedBy->updateChargeIndex(this);
+}
+
 void NodeShadow::setStatus(NodeStatus status)
 {
     if (this->status != status) {
+        NodeStatus oldStatus = this->status;
         switch (this->status) {
             case NodeStatus::DEAD:
                 EV_WARN << "No status change from DEAD possible!!!";
@@ -124,13 +139,18 @@ void NodeShadow::setStatus(NodeStatus status)
             default:
                 throw cRuntimeError("Unknown node status");
         }
+        NodeKinematics::getInstance().setStatus(kinematicsSlot, (int) this->status);
+        if (this->status != oldStatus) {
+            if (TelemetryRecorder *recorder = TelemetryRecorder::getInstance()) recorder->recordStatusChange(node);
+            if (managedBy != nullptr) managedBy->statusChanged(this, oldStatus);
+        }
     }
 }
 
 void NodeShadow::setReplacingNode(GenericNode* replacingNode)
 {
     if (not hasReplacementData()) throw cRuntimeError("No replacementData available, this method should not be called here");
-    this->replacementData->replacingNode = replacingNode;
+    this->replacementData.replacingNode = replacingNode;
 }
 
 void NodeShadow::clearReplacementMsg()
@@ -140,13 +160,12 @@ void NodeShadow::clearReplacementMsg()
 
 void NodeShadow::clearReplacementData()
 {
-    if (hasReplacementData()) delete this->replacementData;
-    this->replacementData = nullptr;
+    replacementDataValid = false;
 }
 
 void NodeShadow::clearReplacementNode()
 {
-    if (hasReplacementData()) this->replacementData->replacingNode = nullptr;
+    if (hasReplacementData()) this->replacementData.replacingNode = nullptr;
 }
 
 /**
@@ -158,6 +177,9 @@ ManagedNodeShadows::ManagedNodeShadows()
 
 ManagedNodeShadows::~ManagedNodeShadows()
 {
+    for (auto& managedNode : managedNodes) {
+        delete managedNode.second;
+    }
 }
 
 bool ManagedNodeShadows::has(int index)
@@ -171,11 +193,50 @@ void ManagedNodeShadows::add(NodeShadow* nodeShadow)
     if (has(index)) throw cRuntimeError("addNode(): Node with index already exists in map.");
     std::pair<int, NodeShadow*> nodePair(index, nodeShadow);
     managedNodes.insert(nodePair);
+    nodeShadow->managedBy = this;
+    nodesByStatus[(int) nodeShadow->getStatus()].insert(index);
+    updateChargeIndex(nodeShadow);
 }
 
 void ManagedNodeShadows::remove(int index)
 {
-    if (has(index)) managedNodes.erase(index);
+    if (not has(index)) return;
+    NodeShadow* nodeShadow = managedNodes.at(index);
+    nodesByStatus[(int) nodeShadow->getStatus()].erase(index);
+    removeFromChargeIndex(index);
+    managedNodes.erase(index);
+    delete nodeShadow;
+}
+
+void ManagedNodeShadows::statusChanged(NodeShadow* nodeShadow, NodeStatus oldStatus)
+{
+    int index = nodeShadow->getNodeIndex();
+    nodesByStatus[(int) oldStatus].erase(index);
+    nodesByStatus[(int) nodeShadow->getStatus()].insert(index);
+    updateChargeIndex(nodeShadow);
+}
+
+/**
+ * (Re)inserts the node into the charge ordered index if it is CHARGING or IDLE and its battery is known.
+ */
+void ManagedNodeShadows::updateChargeIndex(NodeShadow* nodeShadow)
+{
+    int index = nodeShadow->getNodeIndex();
+    removeFromChargeIndex(index);
+    if (not (nodeShadow->isStatusCharging() || nodeShadow->isStatusIdle()) || nodeShadow->getKnownBattery() == nullptr) {
+        return;
+    }
+    int percentage = nodeShadow->getKnownBattery()->getRemainingPercentage();
+    nodesByCharge.insert(std::make_pair(percentage, index));
+    chargeKeys[index] = percentage;
+}
+
+void ManagedNodeShadows::removeFromChargeIndex(int index)
+{
+    auto key = chargeKeys.find(index);
+    if (key == chargeKeys.end()) return;
+    nodesByCharge.erase(std::make_pair(key->second, index));
+    chargeKeys.erase(key);
 }
 
 void ManagedNodeShadows::setStatus(int index, NodeStatus newStatus)
@@ -206,20 +267,27 @@ NodeShadow* ManagedNodeShadows::get(GenericNode* node)
  */
 NodeShadow* ManagedNodeShadows::getClosest(NodeStatus requestedStatus, float x, float y, float z)
 {
+    // Only the nodes with the requested status are scanned, positions are read from the shared kinematics table
+    GenericNode::refreshExtrapolatedPositions();
+    const NodeKinematics& kinematics = NodeKinematics::getInstance();
+    const double *posX = kinematics.getX(), *posY = kinematics.getY(), *posZ = kinematics.getZ();
+
+    // the status index is ordered by node index, as needed for the random choice
     std::vector<NodeShadow*> candidates;
     double shortestDistance = DBL_MAX;
-    for (auto it = managedNodes.begin(); it != managedNodes.end(); ++it) {
-        double distance = sqrt(
-                pow(it->second->getNode()->getX() - x, 2) + pow(it->second->getNode()->getY() - y, 2) + pow(it->second->getNode()->getZ() - z, 2));
-        if (it->second->isStatus(requestedStatus)) {
-            if (distance < shortestDistance) {
-                // new shortest distance
-                candidates.clear();
-                shortestDistance = distance;
-            }
-            if (distance == shortestDistance) {
-                candidates.push_back(it->second);
-            }
+    // only managed nodes are in the status index, unmanaged slots of the table are never looked up
+    for (int index : nodesByStatus[(int) requestedStatus]) {
+        NodeShadow* nodeShadow = managedNodes.at(index);
+        int slot = nodeShadow->getKinematicsSlot();
+        double dx = posX[slot] - x, dy = posY[slot] - y, dz = posZ[slot] - z;
+        double distance = dx * dx + dy * dy + dz * dz;
+        if (distance < shortestDistance) {
+            // new shortest distance
+            candidates.clear();
+            shortestDistance = distance;
+        }
+        if (distance == shortestDistance) {
+            candidates.push_back(nodeShadow);
         }
     }
     if (candidates.empty()) return nullptr;
@@ -234,70 +302,103 @@ NodeShadow* ManagedNodeShadows::getClosest(NodeStatus requestedStatus, float x,
  */
 NodeShadow* ManagedNodeShadows::getFirst(NodeStatus currentStatus)
 {
-    for (auto it = managedNodes.begin(); it != managedNodes.end(); ++it) {
-        if (it->second->isStatus(currentStatus)) {
-            return it->second;
-        }
-    }
-//    throw cRuntimeError("getNode(): No available Nodes found. This case is not handled yet.");
-    return nullptr;
-
+    const std::set<int>& nodes = nodesByStatus[(int) currentStatus];
+    if (nodes.empty()) return nullptr;
+    return managedNodes.at(*nodes.begin());
 }
 
 /**
  * Get the node with the highest charge that is available for missions.
+ * On equal charge the node with the highest index is chosen.
  */
 NodeShadow* ManagedNodeShadows::getHighestCharged()
 {
-    NodeShadow* highestChargedNode = nullptr;
-    for (auto it = managedNodes.begin(); it != managedNodes.end(); ++it) {
-        if (not (it->second->isStatusCharging() || it->second->isStatusIdle())) {
-            continue;
-        }
-
-        Battery* tempKnownBattery = it->second->getKnownBattery();
-        if (tempKnownBattery == nullptr) {
-            continue;
-        }
+    if (nodesByCharge.empty()) return nullptr;
+    return managedNodes.at(nodesByCharge.rbegin()->second);
+}
 
-        if (highestChargedNode == nullptr) {
-            highestChargedNode = it->second;
-        }
-        else if (highestChargedNode->getKnownBattery()->getRemainingPercentage() <= tempKnownBattery->getRemainingPercentage()) {
-            highestChargedNode = it->second;
-        }
+/**
+ * All nodes of a certain status, in the order of their node index.
+ */
+std::vector<NodeShadow*> ManagedNodeShadows::getAll(NodeStatus currentStatus)
+{
+    std::vector<NodeShadow*> nodes;
+    for (int index : nodesByStatus[(int) currentStatus]) {
+        nodes.push_back(managedNodes.at(index));
     }
-    return highestChargedNode;
+    return nodes;
 }
 
 /**
- * Returns the node with the highest charge after the flight to the given coordinates that is available for missions.
+ * The CHARGING and IDLE nodes, in the order of their node index.
  */
-NodeShadow* ManagedNodeShadows::getHighestChargeAtReplacement(float destX, float destY, float destZ)
+std::vector<NodeShadow*> ManagedNodeShadows::getAvailableForReplacement()
 {
-    std::vector<NodeShadow*> candidates;
-    double maxRemainingAtRepl = 0; // remaining battery after flight to exchange
-    for (auto it = managedNodes.cbegin(); it != managedNodes.cend(); ++it) {
-        if (not (it->second->isStatusCharging() || it->second->isStatusIdle())) {
-                continue;
-        }
+    std::vector<int> available;
+    const std::set<int>& charging = nodesByStatus[(int) NodeStatus::CHARGING];
+    const std::set<int>& idle = nodesByStatus[(int) NodeStatus::IDLE];
+    std::merge(charging.begin(), charging.end(), idle.begin(), idle.end(), std::back_inserter(available));
+
+    std::vector<NodeShadow*> nodes;
+    nodes.reserve(available.size());
+    for (int index : available) {
+        nodes.push_back(managedNodes.at(index));
+    }
+    return nodes;
+}
 
-        UAVNode* node = (UAVNode*) it->second->getNode();
-        Battery* tempKnownBattery = it->second->getKnownBattery();
+/**
+ * Evaluates the flights of the nodes to the given coordinates in one batch.
+ *
+ * @param remainingAtRepl Receives the known remaining battery of every node minus its flight consumption, in [mAh]
+ */
+void ManagedNodeShadows::estimateRemainingAtReplacement(const std::vector<NodeShadow*>& nodes, float destX, float destY, float destZ,
+        double* remainingAtRepl)
+{
+    unsigned int count = nodes.size();
+    if (count == 0) return;
+    std::vector<double> fromX(count), fromY(count), fromZ(count);
+    std::vector<float> consumption(count);
+    for (unsigned int i = 0; i < count; i++) {
+        GenericNode* node = nodes[i]->getNode();
+        fromX[i] = node->getX();
+        fromY[i] = node->getY();
+        fromZ[i] = node->getZ();
 
         //TODO: Inaccurate workaround
         double fullBatteryCapacity = 5200;
-        double remaining = (tempKnownBattery != nullptr) ? tempKnownBattery->getRemaining() : fullBatteryCapacity;
+        const Battery* tempKnownBattery = nodes[i]->getKnownBattery();
+        remainingAtRepl[i] = (tempKnownBattery != nullptr) ? tempKnownBattery->getRemaining() : fullBatteryCapacity;
         if (tempKnownBattery == nullptr) {
             EV_WARN << "Defaulting to a full battery during replacement candidate selection. " //
                     << "This should only be seen in the beginning of a simulation!" << endl;
         }
+    }
+    UAVNode* estimator = check_and_cast<UAVNode*>(nodes[0]->getNode());
+    estimator->estimateFlightEnergy(fromX.data(), fromY.data(), fromZ.data(), count, destX, destY, destZ, consumption.data());
+    for (unsigned int i = 0; i < count; i++) {
+        remainingAtRepl[i] -= consumption[i];
+    }
+}
+
+/**
+ * Returns the node with the highest charge after the flight to the given coordinates that is available for missions.
+ */
+NodeShadow* ManagedNodeShadows::getHighestChargeAtReplacement(float destX, float destY, float destZ)
+{
+    std::vector<NodeShadow*> available = getAvailableForReplacement();
+
+    ASSERT(not available.empty());
 
-        WaypointCommand waypointCmd = WaypointCommand(destX, destY, destZ);
-        WaypointCEE waypointCEE = WaypointCEE(node, &waypointCmd);
-        waypointCEE.initializeCEE();
-        double consumption = waypointCEE.predictFullConsumptionQuantile();
-        double remainingAtRepl = remaining - consumption;
+    unsigned int count = available.size();
+    std::vector<double> remaining(count);
+    estimateRemainingAtReplacement(available, destX, destY, destZ, remaining.data());
+
+    std::vector<NodeShadow*> candidates;
+    double maxRemainingAtRepl = 0; // remaining battery after flight to exchange
+    float tolerance = 1.0;
+    for (unsigned int i = 0; i < count; i++) {
+        double remainingAtRepl = remaining[i];
 
         if (remainingAtRepl > maxRemainingAtRepl) {
             // new shortest distance
@@ -305,9 +406,8 @@ NodeShadow* ManagedNodeShadows::getHighestChargeAtReplacement(float destX, float
             maxRemainingAtRepl = remainingAtRepl;
         }
 
-        float tolerance = 1.0;
         if (fabs(remainingAtRepl - maxRemainingAtRepl) < tolerance) {
-            candidates.push_back(it->second);
+            candidates.push_back(available[i]);
         }
     }
 
@@ -327,3 +427,16 @@ NodeShadow* ManagedNodeShadows::getNodeRequestingReplacement(cMessage* msg)
     throw cRuntimeError("getNodeRequestingReplacement(): Message not found amongst the managed nodes.");
     return nullptr;
 }
+
+/**
+ * Adds the shadows and their secondary indexes.
+ */
+void ManagedNodeShadows::addMemoryUsage(MemoryUsage& usage) const
+{
+    size_t bytes = MemoryUsage::ofNodes(managedNodes) + managedNodes.size() * sizeof(NodeShadow);
+    for (int status = 0; status < NUM_NODE_STATUS; status++) {
+        bytes += MemoryUsage::ofNodes(nodesByStatus[status]);
+    }
+    bytes += MemoryUsage::ofNodes(nodesByCharge) + MemoryUsage::ofNodes(chargeKeys);
+    usage.add("missionControl.nodeShadows", bytes, managedNodes.size());
+}
@@ -19,10 +19,15 @@
 #include <omnetpp.h>
 
 #include <map>
+#include <set>
+#include <unordered_map>
+#include <vector>
 
 #include "GenericNode.h"
 #include "ReplacementData.h"
 #include "Battery.h"
+#include "NodeKinematics.h"
+#include "MemoryUsage.h"
 
 using namespace omnetpp;
 
@@ -33,17 +38,28 @@ enum class NodeStatus {
     IDLE, RESERVED, PROVISIONING, MISSION, MAINTENANCE, CHARGING, DEAD
 };
 
+#define NUM_NODE_STATUS 7
+
+class ManagedNodeShadows;
+
 /**
  * A summarized view on a node needed by the MissionControl for node management.
+ * The replacement data and the known battery are held by value, they are only valid while flagged.
  */
 class NodeShadow {
+    friend class ManagedNodeShadows;
 private:
     int index;
+    int kinematicsSlot;
     GenericNode* node;
     NodeStatus status = NodeStatus::IDLE;
-    ReplacementData* replacementData = nullptr;
+    ReplacementData replacementData;
+    bool replacementDataValid = false;
     cMessage* replacementMsg = nullptr;
-    Battery* knownBattery = nullptr;
+    Battery knownBattery;
+    bool knownBatteryValid = false;
+    ManagedNodeShadows* managedBy = nullptr;
+    void notifyKnownBatteryChanged();
 public:
     NodeShadow(GenericNode* node);
     virtual ~NodeShadow();
@@ -57,6 +73,14 @@ public:
         return node;
     }
 
+    /**
+     * Slot of the node in the NodeKinematics table, cached as the node may be deleted before its shadow
+     */
+    int getKinematicsSlot() const
+    {
+        return kinematicsSlot;
+    }
+
     NodeStatus getStatus() const
     {
         return status;
@@ -91,10 +115,10 @@ public:
 
     bool hasReplacementData() const
     {
-        return (this->replacementData != nullptr);
+        return replacementDataValid;
     }
 
-    ReplacementData* getReplacementData() const
+    const ReplacementData& getReplacementData() const
     {
         if (not hasReplacementData()) {
             std::string error_msg = std::string(node->getFullName()) + ": no replacementData available, NodeShadow::getReplacementData() should not be called.";
@@ -150,7 +174,7 @@ public:
 
     bool hasReplacingNode() const
     {
-        return (this->replacementData != nullptr && this->replacementData->replacingNode != nullptr);
+        return replacementDataValid && replacementData.replacingNode != nullptr;
     }
 
     GenericNode* getReplacingNode() const
@@ -159,7 +183,7 @@ public:
             std::string error_msg = std::string(node->getFullName()) + ": no replacingNode available, NodeShadow::getReplacingNode() should not be called.";
             throw cRuntimeError(error_msg.c_str());
         }
-        return this->replacementData->replacingNode;
+        return replacementData.replacingNode;
     }
 
     int getReplacingNodeIndex() const
@@ -169,7 +193,7 @@ public:
                     + ": no replacingNode available, NodeShadow::getReplacingNodeIndex() should not be called.";
             throw cRuntimeError(error_msg.c_str());
         }
-        return this->replacementData->replacingNode->getIndex();
+        return replacementData.replacingNode->getIndex();
     }
 
     simtime_t getReplacementTime() const
@@ -178,35 +202,50 @@ public:
             std::string error_msg = std::string(node->getFullName()) + ": no replacementData available, NodeShadow::getReplacementTime() should not be called.";
             throw cRuntimeError(error_msg.c_str());
         }
-        return this->replacementData->timeOfReplacement;
+        return replacementData.timeOfReplacement;
     }
 
     void clearReplacementMsg();
     void clearReplacementData();
     void clearReplacementNode();
     void setStatus(NodeStatus status);
-    void setReplacementData(ReplacementData* replacementData);
+    void setReplacementData(const ReplacementData& replacementData);
     void setReplacementMsg(cMessage* replacementMsg);
     void setReplacingNode(GenericNode* replacingNode);
 
-    Battery* getKnownBattery()
+    /**
+     * @return The last reported battery of the node, nullptr if none was reported yet
+     */
+    const Battery* getKnownBattery() const
     {
-        return knownBattery;
+        return knownBatteryValid ? &knownBattery : nullptr;
     }
 
-    void setKnownBattery(Battery* knownBattery = nullptr)
+    void setKnownBattery(float capacity, float remaining)
     {
-        if (this->knownBattery != nullptr) delete this->knownBattery;
-        this->knownBattery = knownBattery;
+        knownBattery = Battery(capacity, remaining);
+        knownBatteryValid = true;
+        notifyKnownBatteryChanged();
     }
 };
 
 /**
  * A comprising map of all NodeShadow objects needed by the MissionControl for node management.
+ * Secondary indexes are kept up to date by the NodeShadow objects on every status or known battery change:
+ * the node indices per status and the CHARGING/IDLE nodes with a known battery ordered by charge.
+ * Owns the added NodeShadow objects.
  */
 class ManagedNodeShadows {
+    friend class NodeShadow;
 private:
     std::map<int, NodeShadow*> managedNodes;
+    std::set<int> nodesByStatus[NUM_NODE_STATUS];
+    // (remaining percentage, node index) of CHARGING/IDLE nodes with a known battery
+    std::set<std::pair<int, int>> nodesByCharge;
+    std::unordered_map<int, int> chargeKeys;
+    void statusChanged(NodeShadow* nodeShadow, NodeStatus oldStatus);
+    void updateChargeIndex(NodeShadow* nodeShadow);
+    void removeFromChargeIndex(int index);
 public:
     ManagedNodeShadows();
     virtual ~ManagedNodeShadows();
@@ -221,7 +260,11 @@ public:
     NodeShadow* getClosest(NodeStatus currentStatus, float x, float y, float z);
     NodeShadow* getHighestCharged();
     NodeShadow* getHighestChargeAtReplacement(float x, float y, float z);
+    std::vector<NodeShadow*> getAll(NodeStatus currentStatus);
+    std::vector<NodeShadow*> getAvailableForReplacement();
+    void estimateRemainingAtReplacement(const std::vector<NodeShadow*>& nodes, float x, float y, float z, double* remainingAtRepl);
     NodeShadow* getNodeRequestingReplacement(cMessage *msg); //TODO: Replace!
+    void addMemoryUsage(MemoryUsage& usage) const;
     int size() const
     {
         return managedNodes.size();
@@ -13,24 +13,29 @@
 // along with this program.  If not, see http://www.gnu.org/licenses/.
 //
 
-#ifdef WITH_OSG
+#include <algorithm>
+#include "MobileNode.h"
+#include "OsgEarthScene.h"
+#include "Profiling.h"
+#include "ModelCache.h"
+#include "MessageKind.h"
+#include "RealTimeScheduler.h"
+
+#if defined(WITH_OSG) && defined(WITH_OSGEARTH)
 #include <osg/Node>
 #include <osg/Texture2D>
-#include <osg/ShapeDrawable>
 #include <osg/PositionAttitudeTransform>
 #include <osgEarth/Capabilities>
 #include <osgEarthAnnotation/LabelNode>
 #include <osgEarthSymbology/Geometry>
 #include <osgEarthFeatures/Feature>
 
-#include "MobileNode.h"
-#include "OsgEarthScene.h"
-
-using namespace omnetpp;
-
 using namespace osgEarth;
 using namespace osgEarth::Annotation;
 using namespace osgEarth::Features;
+#endif
+
+using namespace omnetpp;
 
 MobileNode::MobileNode()
 {
@@ -46,17 +51,21 @@ void MobileNode::initialize(int stage)
     GenericNode::initialize(stage);
     switch (stage) {
         case 0:
+            chargingNodeIndex = &ChargingNodeIndex::getInstance(getParentModule());
             trailLength = par("trailLength");
             trailColor = par("trailColor").stringValue();
             commandPreviewCommandCount = par("commandPreviewCommandCount");
             commandPreviewEnabled = par("commandPreviewEnabled").boolValue();
+#if defined(WITH_OSG) && defined(WITH_OSGEARTH)
             commandPreviewMissionColor = osgEarth::Color(par("commandPreviewMissionColor").stringValue());
             commandPreviewMaintenanceColor = osgEarth::Color(par("commandPreviewMaintenanceColor").stringValue());
+#endif
             break;
 
         case 1:
+#if defined(WITH_OSG) && defined(WITH_OSGEARTH)
             // create a node containing a track showing the past trail of the model
-            if (trailLength > 0) {
+            if (trailLength > 0 && getEnvir()->isGUI()) {
                 trailStyle.getOrCreate<LineSymbol>()->stroke()->color() = osgEarth::Color(trailColor);
                 trailStyle.getOrCreate<LineSymbol>()->stroke()->width() = 50.0f;
                 trailStyle.getOrCreate<AltitudeSymbol>()->clamping() = AltitudeSymbol::CLAMP_RELATIVE_TO_TERRAIN;
@@ -78,6 +87,7 @@ void MobileNode::initialize(int stage)
                 waypointsMaintNode = new FeatureNode(mapNode.get(), new Feature(new LineString(), geoSRS));
                 mapNode->getModelLayerGroup()->addChild(waypointsMaintNode);
             }
+#endif
 
             //Initialize Energy storage
             int capacity = int(par("batteryCapacity"));
@@ -132,70 +142,93 @@ void MobileNode::finish()
     recordScalar("utilizationFail", utilizationFail);
     //
     recordScalar("simulationTime", simTime().dbl());
+    profiling.recordStatistics(this);
 }
 
 void MobileNode::refreshDisplay() const
 {
     GenericNode::refreshDisplay();
+    if (RealTimeScheduler::isBehind()) return;
+#if defined(WITH_OSG) && defined(WITH_OSGEARTH)
     auto geoSRS = mapNode->getMapSRS(); //->getGeographicSRS();
     // if we are showing the model's track, update geometry in the trackNode
-    if (trailNode) {
+    if (trailNode && trailChanged) {
         // create and assign a new feature containing the updated geometry
-        // representing the movement trail as continuous line segments
-        auto trailFeature = new Feature(new LineString(&trail), geoSRS, trailStyle);
+        // representing the movement trail as continuous line segments, oldest point first
+        osgEarth::Vec3dVector orderedTrail(trail.begin() + trailHead, trail.end());
+        orderedTrail.insert(orderedTrail.end(), trail.begin(), trail.begin() + trailHead);
+        auto trailFeature = new Feature(new LineString(&orderedTrail), geoSRS, trailStyle);
         trailFeature->geoInterp() = GEOINTERP_GREAT_CIRCLE;
         trailNode->setFeature(trailFeature);
+        trailChanged = false;
     }
+    evaluateBatteryCharge();
+#endif
 }
 
 void MobileNode::handleMessage(cMessage *msg)
 {
     double stepSize = 0;
-    if (msg->isName("mobileNodeExit")) {
+    if (msg->getKind() == MSG_MOBILE_NODE_EXIT) {
         ChargeCEE *cee = check_and_cast<ChargeCEE *>(commandExecEngine);
         ChargingNode *cn = cee->extractCommand()->getChargingNode();
         delete msg;
         msg = nullptr;
-        send(new cMessage("mobileNodeExit"), getOutputGateTo(cn));
+        send(new cMessage("mobileNodeExit", MSG_MOBILE_NODE_EXIT), getOutputGateTo(cn));
     }
     else {
-        bool commandPreview = commandPreviewEnabled && (msg->isName("nextCommand") || msg->isName("startProvision") || msg->isName("startMission"));
+        bool commandPreview = commandPreviewEnabled && (msg->getKind() == MSG_NEXT_COMMAND || msg->getKind() == MSG_START_PROVISION || msg->getKind() == MSG_START_MISSION);
 
         GenericNode::handleMessage(msg);
         msg = nullptr;
 
+#if defined(WITH_OSG) && defined(WITH_OSGEARTH)
         if (commandPreview && getEnvir()->isGUI()) drawCommandPreview();
+#endif
     }
 
     if (msg != nullptr) {
         scheduleAt(simTime() + stepSize, msg);
     }
 
-    evaluateBatteryCharge();
-
+#if defined(WITH_OSG) && defined(WITH_OSGEARTH)
     // update the trail data based on the new position
     if (trailNode) {
         // store the new position to be able to create a track later
-        trail.push_back(osg::Vec3d(getLongitude(), getLatitude(), getAltitude()));
+        osg::Vec3d position(getLongitude(), getLatitude(), getAltitude());
 
-        // if trail is at max length, remove the oldest point to keep it at "trailLength"
-        if (trail.size() > trailLength) trail.erase(trail.begin());
+        // if trail is at max length, overwrite the oldest point to keep it at "trailLength"
+        if (trail.size() < trailLength) {
+            trail.push_back(position);
+        }
+        else {
+            trail[trailHead] = position;
+            trailHead = (trailHead + 1) % trailLength;
+        }
+        trailChanged = true;
     }
+#endif
 }
 
+#if defined(WITH_OSG) && defined(WITH_OSGEARTH)
 /**
  * Adjusts the sublabel color according to current battery charge.
+ * The style is only touched if the charge changed by at least one percent.
  */
-void inline MobileNode::evaluateBatteryCharge()
+void MobileNode::evaluateBatteryCharge() const
 {
-    double remainingPercentage = getBattery()->getRemainingPercentage();
-    double h = 300 * (remainingPercentage / 100);
+    int remainingPercentage = battery.getRemainingPercentage();
+    if (not sublabelNode || remainingPercentage == displayedBatteryPercentage) return;
+    displayedBatteryPercentage = remainingPercentage;
+
+    double h = 300 * (remainingPercentage / 100.0);
     const double s = 1;
     const double v = 1;
     osg::Vec4f colorVec = hsv2rgb(h, s, v);
-    labelStyle.getOrCreate<TextSymbol>()->fill()->color() = osgEarth::Color(colorVec);
-    labelStyle.getOrCreate<TextSymbol>()->halo()->color() = osgEarth::Color::Black;
-    sublabelNode.get()->setStyle(labelStyle);
+    osgEarth::Style style = labelStyle;
+    style.getOrCreate<TextSymbol>()->fill()->color() = osgEarth::Color(colorVec);
+    style.getOrCreate<TextSymbol>()->halo()->color() = osgEarth::Color::Black;
+    sublabelNode.get()->setStyle(style);
 }
 
 /**
@@ -236,47 +269,52 @@ osg::Vec4f MobileNode::hsv2rgb(double h, double s, double v)
     colorVec.z() = (colorVec.z() + m);
     return colorVec;
 }
+#endif
 
-ChargingNode* MobileNode::findNearestCN(double nodeX, double nodeY, double nodeZ)
+/**
+ * Find the nearest charging node using the ChargingNodeIndex.
+ *
+ * @param metric ChargingNodeIndex::MANHATTAN (default) or ChargingNodeIndex::EUCLIDEAN
+ * @return The nearest charging node, nullptr if there is none
+ */
+ChargingNode* MobileNode::findNearestCN(double nodeX, double nodeY, double nodeZ, int metric)
 {
-    //cModule* osgEarthNet = getModuleByPath("OsgEarthNet");
-    //cModule* osgEarthNet = getModuleByPath("OsgEarthNet.cs");
-    //EV_INFO << "MobileNode #" << this->getIndex() << " name: " << this->getFullName() << " parent name: " << osgEarthNet->getFullName() << endl;
-    double minDistance = DBL_MAX;
-    ChargingNode *nearest = nullptr;
-    cModule *network = cSimulation::getActiveSimulation()->getSystemModule();
-    for (SubmoduleIterator it(network); !it.end(); ++it) {
-        cModule *mod = *it;
-        if (mod->isName("cs")) {
-            //EV << "Module " << mod->getName() << mod->getFullName() << mod->getFullPath() << endl;
-            ChargingNode *cs = dynamic_cast<ChargingNode *>(mod);
-            double distanceSum = fabs(cs->getX() - nodeX) + fabs(cs->getY() - nodeY) + fabs(cs->getZ() - nodeZ);
-            //EV << "ChargingNode " << cs->getFullName() << " distanceSum=" << distanceSum << endl;
-            if (distanceSum < minDistance) {
-                minDistance = distanceSum;
-                nearest = cs;
-            }
-        }
-    }
-    //EV << "ChargingNode selected: " << nearest->getFullName() << endl;
-    return nearest;
+    PROFILE_SCOPE("MobileNode::findNearestCN");
+    return chargingNodeIndex->findNearest(nodeX, nodeY, nodeZ, metric);
 }
 
+/**
+ * The battery as of the last update of the node, e.g. to charge it.
+ * Modules only reading the charge use getExtrapolatedBattery().
+ */
 Battery* MobileNode::getBattery()
 {
     return &battery;
 }
 
+/**
+ * In analyticMotion mode the battery is only updated at events, like the position.
+ * Returns a copy drained by the consumption of the current CEE since lastUpdate, so other modules
+ * read the current charge without changing the battery, only updateState() drains it.
+ */
+Battery MobileNode::getExtrapolatedBattery() const
+{
+    Battery extrapolated = battery;
+    if (not analyticMotion || not activeInField || commandExecEngine == nullptr || commandExecEngine->getConsumptionPerSecond() <= 0) return extrapolated;
+    double due = commandExecEngine->getConsumptionPerSecond() * (simTime() - lastUpdate).dbl();
+    due = std::min(due, (double) extrapolated.getRemaining());
+    if (due > 0) extrapolated.discharge(due);
+    return extrapolated;
+}
+
+#if defined(WITH_OSG) && defined(WITH_OSGEARTH)
 void MobileNode::drawCommandPreview()
 {
     if (not waypoints.empty()) waypoints.clear();
     if (not waypointsMaint.empty()) waypointsMaint.clear();
-    if (not holdCommandNodes.empty()) {
-        for (std::vector<osg::ref_ptr<osgEarth::Util::ObjectLocatorNode>>::iterator it = holdCommandNodes.begin(); it != holdCommandNodes.end(); ++it) {
-            mapNode->getModelLayerGroup()->removeChild(*it);
-        }
-        holdCommandNodes.clear();
-    }
+
+    // markers of hold and exchange commands are moved instead of rebuilt, surplus ones are removed afterwards
+    size_t countMarkers = 0;
 
     // add current location
     unsigned short countDrawnCommands = 0;
@@ -296,37 +334,17 @@ void MobileNode::drawCommandPreview()
         else if (cee->isCeeType(CeeType::CHARGE)) {
             // do nothing
         }
-        else if (cee->isCeeType(CeeType::HOLDPOSITION)) {
-            auto sphere = new osg::Sphere(osg::Vec3(0, 0, 0), 5);
-            auto sphereDrawable = new osg::ShapeDrawable(sphere);
-            sphereDrawable->setColor(commandPreviewMissionColor);
-            sphereDrawable->getOrCreateStateSet()->setMode(GL_BLEND, osg::StateAttribute::ON);
-            auto sphereGeode = new osg::Geode();
-            sphereGeode->addDrawable(sphereDrawable);
-            osg::ref_ptr<osgEarth::Util::ObjectLocatorNode> node = new osgEarth::Util::ObjectLocatorNode(mapNode->getMap());
-            node->addChild(sphereGeode);
-            node->getLocator()->setPosition(osg::Vec3d( //
-                    OsgEarthScene::getInstance()->toLongitude(cee->getX1()), //
-                    OsgEarthScene::getInstance()->toLatitude(cee->getY1()), //
-                    cee->getZ1()));
-            mapNode->getModelLayerGroup()->addChild(node);
-            holdCommandNodes.push_back(node);
-        }
-        else if (cee->isCeeType(CeeType::EXCHANGE)) {
-            auto sphere = new osg::Sphere(osg::Vec3(0, 0, 0), 5);
-            auto sphereDrawable = new osg::ShapeDrawable(sphere);
-            sphereDrawable->setColor(commandPreviewMissionColor);
-            sphereDrawable->getOrCreateStateSet()->setMode(GL_BLEND, osg::StateAttribute::ON);
-            auto sphereGeode = new osg::Geode();
-            sphereGeode->addDrawable(sphereDrawable);
-            osg::ref_ptr<osgEarth::Util::ObjectLocatorNode> node = new osgEarth::Util::ObjectLocatorNode(mapNode->getMap());
-            node->addChild(sphereGeode);
-            node->getLocator()->setPosition(osg::Vec3d( //
+        else if (cee->isCeeType(CeeType::HOLDPOSITION) || cee->isCeeType(CeeType::EXCHANGE)) {
+            if (countMarkers == holdCommandNodes.size()) {
+                osg::ref_ptr<osgEarth::Util::ObjectLocatorNode> node = new osgEarth::Util::ObjectLocatorNode(mapNode->getMap());
+                node->addChild(ModelCache::getInstance().getMarker(commandPreviewMissionColor));
+                mapNode->getModelLayerGroup()->addChild(node);
+                holdCommandNodes.push_back(node);
+            }
+            holdCommandNodes[countMarkers++]->getLocator()->setPosition(osg::Vec3d( //
                     OsgEarthScene::getInstance()->toLongitude(cee->getX1()), //
                     OsgEarthScene::getInstance()->toLatitude(cee->getY1()), //
                     cee->getZ1()));
-            mapNode->getModelLayerGroup()->addChild(node);
-            holdCommandNodes.push_back(node);
         }
         else {
             if (cee->isPartOfMission()) {
@@ -349,6 +367,10 @@ void MobileNode::drawCommandPreview()
 
         countDrawnCommands++;
     }
+    for (size_t i = countMarkers; i < holdCommandNodes.size(); i++) {
+        mapNode->getModelLayerGroup()->removeChild(holdCommandNodes[i]);
+    }
+    holdCommandNodes.resize(countMarkers);
 
     auto geoSRS = mapNode->getMapSRS();
     auto waypointsFeature = new Feature(new LineString(&waypoints), geoSRS, waypointStyle);
@@ -359,4 +381,4 @@ void MobileNode::drawCommandPreview()
     waypointsMaintNode->setFeature(waypointsMaintFeature);
 }
 
-#endif // WITH_OSG
+#endif
@@ -16,15 +16,19 @@
 #ifndef __MOBILENODE_H__
 #define __MOBILENODE_H__
 
+#include <omnetpp.h>
+
+#if defined(WITH_OSG) && defined(WITH_OSGEARTH)
 #include <osgEarth/MapNode>
 #include <osgEarthAnnotation/CircleNode>
 #include <osgEarthAnnotation/LabelNode>
 #include <osgEarthAnnotation/FeatureNode>
 #include <osgEarthUtil/ObjectLocator>
+#endif
 
-#include <omnetpp.h>
 #include "GenericNode.h"
 #include "ChargingNode.h"
+#include "ChargingNodeIndex.h"
 #include "Battery.h"
 
 using namespace omnetpp;
@@ -36,18 +40,23 @@ class ChargingNode;
  * model's track can be shown along with its label.
  */
 class MobileNode : public GenericNode {
+    friend class IdleCEE;
 
 protected:
     //trail (recently visited points)
-    osg::ref_ptr<osgEarth::Annotation::FeatureNode> trailNode = nullptr;
-    osgEarth::Vec3dVector trail;
     unsigned int trailLength;
-    osgEarth::Style trailStyle;
     std::string trailColor;
 
     // Path/Commands Preview
     bool commandPreviewEnabled;
     unsigned int commandPreviewCommandCount;
+
+#if defined(WITH_OSG) && defined(WITH_OSGEARTH)
+    osg::ref_ptr<osgEarth::Annotation::FeatureNode> trailNode = nullptr;
+    osgEarth::Vec3dVector trail; // ring buffer, trailHead is the oldest point once it is full
+    unsigned int trailHead = 0;
+    mutable bool trailChanged = false;
+    osgEarth::Style trailStyle;
     osgEarth::Color commandPreviewMissionColor;
     osgEarth::Color commandPreviewMaintenanceColor;
     osg::ref_ptr<osgEarth::Annotation::FeatureNode> waypointsNode = nullptr;
@@ -58,9 +67,16 @@ protected:
     osgEarth::Style waypointMaintStyle;
     std::vector <osg::ref_ptr<osgEarth::Util::ObjectLocatorNode>> holdCommandNodes;
 
+    // battery percentage the sublabel color was last computed for
+    mutable int displayedBatteryPercentage = -1;
+#endif
+
     double speed; //speed (3D) in [m/s]
     Battery battery; //energy storage
 
+    /// Charging nodes of the region (parent module) this node belongs to
+    ChargingNodeIndex *chargingNodeIndex = nullptr;
+
     // Performance metrics
     double utilizationSecMission = 0;
     double utilizationSecMaintenance = 0;
@@ -87,19 +103,24 @@ public:
     MobileNode();
     virtual ~MobileNode();
     Battery* getBattery();
+    Battery getExtrapolatedBattery() const;
+#if defined(WITH_OSG) && defined(WITH_OSGEARTH)
     static osg::Vec4f hsv2rgb(double h, double s, double v);
+#endif
 
 protected:
     virtual void initialize(int stage) override;
     virtual void finish() override;
     virtual void refreshDisplay() const override;
     virtual void handleMessage(cMessage *msg) override;
-    static ChargingNode* findNearestCN(double nodeX, double nodeY, double nodeZ);
+    ChargingNode* findNearestCN(double nodeX, double nodeY, double nodeZ, int metric = ChargingNodeIndex::MANHATTAN);
     virtual float energyToNearestCN(double fromX, double fromY, double fromZ) = 0;
 
 private:
-    void inline evaluateBatteryCharge();
+#if defined(WITH_OSG) && defined(WITH_OSGEARTH)
+    void evaluateBatteryCharge() const;
     void drawCommandPreview();
+#endif
 };
 
 #endif
@@ -0,0 +1,105 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#include "ModelCache.h"
+
+#if defined(WITH_OSG) && defined(WITH_OSGEARTH)
+
+#include <algorithm>
+#include <cfloat>
+#include <omnetpp.h>
+#include <osg/Geode>
+#include <osg/LOD>
+#include <osg/Material>
+#include <osg/Program>
+#include <osg/ShapeDrawable>
+#include <osgDB/ReadFile>
+#include <osgEarth/Color>
+
+using namespace omnetpp;
+
+ModelCache& ModelCache::getInstance()
+{
+    static ModelCache instance;
+    return instance;
+}
+
+osg::Node* ModelCache::getModel(const std::string& url, const std::string& color, double lodDistance)
+{
+    auto key = std::make_tuple(url, color, lodDistance);
+    auto it = models.find(key);
+    if (it != models.end()) return it->second.get();
+
+    // the file itself is shared by all colors and LOD distances
+    osg::ref_ptr<osg::Node>& file = files[url];
+    if (!file) {
+        file = osgDB::readNodeFile(url);
+        if (!file) {
+            files.erase(url);
+            throw cRuntimeError("Model file \"%s\" not found", url.c_str());
+        }
+    }
+
+    // disable shader and lighting on the model so textures are correctly shown
+    osg::ref_ptr<osg::Group> model = new osg::Group();
+    model->addChild(file);
+    model->getOrCreateStateSet()->setAttributeAndModes(new osg::Program(), osg::StateAttribute::OFF | osg::StateAttribute::OVERRIDE);
+    model->getOrCreateStateSet()->setMode(GL_LIGHTING, osg::StateAttribute::OFF);
+
+    if (not color.empty()) {
+        auto modelColor = osgEarth::Color(color);
+        auto material = new osg::Material();
+        material->setAmbient(osg::Material::FRONT_AND_BACK, modelColor);
+        material->setDiffuse(osg::Material::FRONT_AND_BACK, modelColor);
+        material->setAlpha(osg::Material::FRONT_AND_BACK, 1.0);
+        model->getOrCreateStateSet()->setAttribute(material, osg::StateAttribute::OFF | osg::StateAttribute::OVERRIDE);
+    }
+
+    osg::ref_ptr<osg::Node> node = model;
+    if (lodDistance > 0) {
+        // far away nodes are drawn as a marker of roughly the model's size
+        float radius = std::max(1.0f, file->getBound().radius());
+        auto lod = new osg::LOD();
+        lod->addChild(model, 0, lodDistance);
+        lod->addChild(getMarker(color.empty() ? osg::Vec4(1, 1, 1, 1) : osg::Vec4(osgEarth::Color(color)), radius), lodDistance, FLT_MAX);
+        node = lod;
+    }
+    models[key] = node;
+    return node.get();
+}
+
+osg::Node* ModelCache::getMarker(const osg::Vec4& color, float radius)
+{
+    auto key = std::make_tuple(color.r(), color.g(), color.b(), color.a(), radius);
+    osg::ref_ptr<osg::Node>& marker = markers[key];
+    if (!marker) {
+        auto sphereDrawable = new osg::ShapeDrawable(new osg::Sphere(osg::Vec3(0, 0, 0), radius));
+        sphereDrawable->setColor(color);
+        sphereDrawable->getOrCreateStateSet()->setMode(GL_BLEND, osg::StateAttribute::ON);
+        auto sphereGeode = new osg::Geode();
+        sphereGeode->addDrawable(sphereDrawable);
+        marker = sphereGeode;
+    }
+    return marker.get();
+}
+
+void ModelCache::clear()
+{
+    models.clear();
+    markers.clear();
+    files.clear();
+}
+
+#endif
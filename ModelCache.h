@@ -0,0 +1,63 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef MODELCACHE_H_
+#define MODELCACHE_H_
+
+#if defined(WITH_OSG) && defined(WITH_OSGEARTH)
+
+#include <map>
+#include <string>
+#include <tuple>
+#include <osg/Node>
+#include <osg/Vec4>
+
+/**
+ * Process wide cache of the 3D models and markers shown by the nodes.
+ * Every model file is loaded once, all nodes showing it with the same color share one
+ * subgraph (with one state set), so the GPU holds each model only once.
+ */
+class ModelCache {
+public:
+    static ModelCache& getInstance();
+
+    /**
+     * @param url Model file, may contain osg pseudo filters
+     * @param color Color the model is tinted with in osgEarth color format, "" keeps the textures
+     * @param lodDistance If > 0 the model is replaced by a small marker beyond this camera distance in meters
+     * @return Shared node to be added as a child of the node's own transform
+     * @throws cRuntimeError if the model file could not be loaded
+     */
+    osg::Node* getModel(const std::string& url, const std::string& color, double lodDistance = 0);
+
+    /**
+     * @return Shared sphere of the given radius and color, e.g. for command preview markers
+     */
+    osg::Node* getMarker(const osg::Vec4& color, float radius = 5);
+
+    /**
+     * Releases all cached nodes, e.g. when the scene is torn down.
+     */
+    void clear();
+
+private:
+    std::map<std::string, osg::ref_ptr<osg::Node>> files;
+    std::map<std::tuple<std::string, std::string, double>, osg::ref_ptr<osg::Node>> models;
+    std::map<std::tuple<float, float, float, float, float>, osg::ref_ptr<osg::Node>> markers;
+};
+
+#endif
+
+#endif /* MODELCACHE_H_ */
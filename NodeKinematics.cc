@@ -0,0 +1,55 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#include "NodeKinematics.h"
+
+NodeKinematics& NodeKinematics::getInstance()
+{
+    static NodeKinematics instance;
+    return instance;
+}
+
+/**
+ * Slots of unregistered nodes are reused, so the arrays stay dense over repeated runs.
+ */
+int NodeKinematics::registerNode(GenericNode* node)
+{
+    int slot;
+    if (not freeSlots.empty()) {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+        nodes[slot] = node;
+    }
+    else {
+        slot = nodes.size();
+        nodes.push_back(node);
+        x.push_back(0);
+        y.push_back(0);
+        z.push_back(0);
+        yaw.push_back(0);
+        pitch.push_back(0);
+        status.push_back(NO_STATUS);
+    }
+    status[slot] = NO_STATUS;
+    return slot;
+}
+
+void NodeKinematics::unregisterNode(int slot)
+{
+    if (slot < 0 || slot >= (int) nodes.size() || nodes[slot] == nullptr) return;
+    nodes[slot] = nullptr;
+    status[slot] = NO_STATUS;
+    freeSlots.push_back(slot);
+}
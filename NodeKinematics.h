@@ -0,0 +1,117 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef NODEKINEMATICS_H_
+#define NODEKINEMATICS_H_
+
+#include <vector>
+
+class GenericNode;
+
+/**
+ * Central structure-of-arrays table of the kinematic state of all nodes.
+ * Nodes write their position into their slot after every update, fleet wide scans
+ * read the contiguous arrays instead of calling into the scattered node modules.
+ * The status is the NodeStatus as seen by the MissionControl, NO_STATUS if unmanaged.
+ */
+class NodeKinematics {
+public:
+    static const int NO_STATUS = -1;
+
+    static NodeKinematics& getInstance();
+
+    /**
+     * @return The slot of the node, valid until unregisterNode()
+     */
+    int registerNode(GenericNode* node);
+    void unregisterNode(int slot);
+
+    void setPosition(int slot, double x, double y, double z, double yaw, double pitch)
+    {
+        this->x[slot] = x;
+        this->y[slot] = y;
+        this->z[slot] = z;
+        this->yaw[slot] = yaw;
+        this->pitch[slot] = pitch;
+    }
+
+    void setStatus(int slot, int status)
+    {
+        this->status[slot] = status;
+    }
+
+    int size() const
+    {
+        return nodes.size();
+    }
+
+    GenericNode* getNode(int slot) const
+    {
+        return nodes[slot];
+    }
+
+    const double* getX() const
+    {
+        return x.data();
+    }
+
+    const double* getY() const
+    {
+        return y.data();
+    }
+
+    const double* getZ() const
+    {
+        return z.data();
+    }
+
+    const double* getYaw() const
+    {
+        return yaw.data();
+    }
+
+    const double* getPitch() const
+    {
+        return pitch.data();
+    }
+
+    const int* getStatus() const
+    {
+        return status.data();
+    }
+
+    /**
+     * @return Bytes held by the slot arrays
+     */
+    size_t getAllocatedBytes() const
+    {
+        return nodes.capacity() * sizeof(GenericNode*) + (x.capacity() + y.capacity() + z.capacity() + yaw.capacity() + pitch.capacity()) * sizeof(double)
+                + (status.capacity() + freeSlots.capacity()) * sizeof(int);
+    }
+
+private:
+    std::vector<GenericNode*> nodes;
+    std::vector<double> x;
+    std::vector<double> y;
+    std::vector<double> z;
+    std::vector<double> yaw;
+    std::vector<double> pitch;
+    std::vector<int> status;
+    std::vector<int> freeSlots;
+
+    NodeKinematics() {};
+};
+
+#endif /* NODEKINEMATICS_H_ */
@@ -0,0 +1,213 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include "ObstacleIndex.h"
+
+void ObstacleIndex::add(const std::vector<std::vector<double>>& rings, double top)
+{
+    Obstacle obstacle = { DBL_MAX, DBL_MAX, -DBL_MAX, -DBL_MAX, top, (unsigned int) (edges.size() / 4), 0 };
+    for (const std::vector<double>& ring : rings) {
+        size_t vertices = ring.size() / 2;
+        if (vertices < 3) continue;
+        for (size_t i = 0; i < vertices; i++) {
+            double x = ring[2 * i], y = ring[2 * i + 1];
+            size_t next = (i + 1) % vertices;
+            // closed rings repeat the first vertex
+            if (next == 0 && x == ring[0] && y == ring[1]) break;
+            edges.insert(edges.end(), { x, y, ring[2 * next], ring[2 * next + 1] });
+            obstacle.edgeCount++;
+            obstacle.minX = std::min(obstacle.minX, x);
+            obstacle.minY = std::min(obstacle.minY, y);
+            obstacle.maxX = std::max(obstacle.maxX, x);
+            obstacle.maxY = std::max(obstacle.maxY, y);
+        }
+    }
+    if (obstacle.edgeCount > 0) obstacles.push_back(obstacle);
+}
+
+void ObstacleIndex::build()
+{
+    nodes.clear();
+    if (obstacles.empty()) return;
+    nodes.reserve(2 * obstacles.size());
+    nodes.push_back(Node());
+    split(0, 0, obstacles.size());
+}
+
+/**
+ * Fills the node with the obstacles first..first+count-1, splits them at the median of the longer axis of their centers.
+ */
+void ObstacleIndex::split(unsigned int index, unsigned int first, unsigned int count)
+{
+    Node node = { DBL_MAX, DBL_MAX, -DBL_MAX, -DBL_MAX, 0, first, count };
+    double minCX = DBL_MAX, minCY = DBL_MAX, maxCX = -DBL_MAX, maxCY = -DBL_MAX;
+    for (unsigned int i = first; i < first + count; i++) {
+        const Obstacle& obstacle = obstacles[i];
+        node.minX = std::min(node.minX, obstacle.minX);
+        node.minY = std::min(node.minY, obstacle.minY);
+        node.maxX = std::max(node.maxX, obstacle.maxX);
+        node.maxY = std::max(node.maxY, obstacle.maxY);
+        node.maxTop = std::max(node.maxTop, obstacle.top);
+        minCX = std::min(minCX, obstacle.minX + obstacle.maxX);
+        minCY = std::min(minCY, obstacle.minY + obstacle.maxY);
+        maxCX = std::max(maxCX, obstacle.minX + obstacle.maxX);
+        maxCY = std::max(maxCY, obstacle.minY + obstacle.maxY);
+    }
+    if (count <= LEAF_SIZE) {
+        nodes[index] = node;
+        return;
+    }
+
+    bool alongX = (maxCX - minCX) >= (maxCY - minCY);
+    std::nth_element(obstacles.begin() + first, obstacles.begin() + first + count / 2, obstacles.begin() + first + count,
+            [alongX](const Obstacle& a, const Obstacle& b) {
+                return alongX ? (a.minX + a.maxX < b.minX + b.maxX) : (a.minY + a.maxY < b.minY + b.maxY);
+            });
+    node.first = nodes.size();
+    node.count = 0;
+    nodes[index] = node;
+    nodes.push_back(Node());
+    nodes.push_back(Node());
+    split(node.first, first, count / 2);
+    split(node.first + 1, first + count / 2, count - count / 2);
+}
+
+/**
+ * Clips the segment (x0, y0) + t * (dx, dy), t in [0, 1] to the box.
+ *
+ * @return Whether the segment overlaps the box, within t0..t1
+ */
+bool ObstacleIndex::clipSegment(double minX, double minY, double maxX, double maxY, double x0, double y0, double dx, double dy,
+        double& t0, double& t1)
+{
+    t0 = 0;
+    t1 = 1;
+    const double origin[2] = { x0, y0 }, direction[2] = { dx, dy }, lower[2] = { minX, minY }, upper[2] = { maxX, maxY };
+    for (int axis = 0; axis < 2; axis++) {
+        if (direction[axis] == 0) {
+            if (origin[axis] < lower[axis] || origin[axis] > upper[axis]) return false;
+            continue;
+        }
+        double tLower = (lower[axis] - origin[axis]) / direction[axis];
+        double tUpper = (upper[axis] - origin[axis]) / direction[axis];
+        if (tLower > tUpper) std::swap(tLower, tUpper);
+        t0 = std::max(t0, tLower);
+        t1 = std::min(t1, tUpper);
+        if (t0 > t1) return false;
+    }
+    return true;
+}
+
+/**
+ * Even-odd rule over all rings, so holes are not part of the footprint.
+ */
+bool ObstacleIndex::insideFootprint(const Obstacle& obstacle, double x, double y) const
+{
+    if (x < obstacle.minX || x > obstacle.maxX || y < obstacle.minY || y > obstacle.maxY) return false;
+    bool inside = false;
+    const double* edge = &edges[4 * obstacle.firstEdge];
+    for (unsigned int i = 0; i < obstacle.edgeCount; i++, edge += 4) {
+        if ((edge[1] > y) != (edge[3] > y) && x < edge[0] + (y - edge[1]) * (edge[2] - edge[0]) / (edge[3] - edge[1])) {
+            inside = not inside;
+        }
+    }
+    return inside;
+}
+
+/**
+ * @return Whether the segment enters the footprint of the obstacle below its top
+ */
+bool ObstacleIndex::touches(const Obstacle& obstacle, double x0, double y0, double x1, double y1, double z0, double z1) const
+{
+    if (z0 < obstacle.top && insideFootprint(obstacle, x0, y0)) return true;
+    if (z1 < obstacle.top && insideFootprint(obstacle, x1, y1)) return true;
+
+    double dx = x1 - x0, dy = y1 - y0, dz = z1 - z0;
+    const double* edge = &edges[4 * obstacle.firstEdge];
+    for (unsigned int i = 0; i < obstacle.edgeCount; i++, edge += 4) {
+        double ex = edge[2] - edge[0], ey = edge[3] - edge[1];
+        double denominator = dx * ey - dy * ex;
+        if (denominator == 0) continue; // parallel, collinear overlaps are found at neighboring edges
+        double ox = edge[0] - x0, oy = edge[1] - y0;
+        double t = (ox * ey - oy * ex) / denominator;
+        double s = (ox * dy - oy * dx) / denominator;
+        if (t >= 0 && t <= 1 && s >= 0 && s <= 1 && z0 + t * dz < obstacle.top) return true;
+    }
+    return false;
+}
+
+bool ObstacleIndex::intersects(double x0, double y0, double z0, double x1, double y1, double z1) const
+{
+    if (nodes.empty() || std::min(z0, z1) >= nodes[0].maxTop) return false;
+
+    double dx = x1 - x0, dy = y1 - y0, dz = z1 - z0;
+    double t0, t1;
+    unsigned int stack[64];
+    int depth = 0;
+    stack[depth++] = 0;
+    while (depth > 0) {
+        const Node& node = nodes[stack[--depth]];
+        if (not clipSegment(node.minX, node.minY, node.maxX, node.maxY, x0, y0, dx, dy, t0, t1)) continue;
+        // lowest point of the segment within the box
+        if (std::min(z0 + t0 * dz, z0 + t1 * dz) >= node.maxTop) continue;
+        if (node.count == 0) {
+            stack[depth++] = node.first;
+            stack[depth++] = node.first + 1;
+            continue;
+        }
+        for (unsigned int i = node.first; i < node.first + node.count; i++) {
+            const Obstacle& obstacle = obstacles[i];
+            if (not clipSegment(obstacle.minX, obstacle.minY, obstacle.maxX, obstacle.maxY, x0, y0, dx, dy, t0, t1)) continue;
+            if (std::min(z0 + t0 * dz, z0 + t1 * dz) >= obstacle.top) continue;
+            if (touches(obstacle, x0, y0, x1, y1, z0, z1)) return true;
+        }
+    }
+    return false;
+}
+
+bool ObstacleIndex::contains(double x, double y, double z) const
+{
+    return intersects(x, y, z, x, y, z);
+}
+
+double ObstacleIndex::maxTopAlong(double x0, double y0, double x1, double y1) const
+{
+    double maxTop = 0;
+    double dx = x1 - x0, dy = y1 - y0;
+    double t0, t1;
+    unsigned int stack[64];
+    int depth = 0;
+    if (not nodes.empty()) stack[depth++] = 0;
+    while (depth > 0) {
+        const Node& node = nodes[stack[--depth]];
+        if (node.maxTop <= maxTop) continue;
+        if (not clipSegment(node.minX, node.minY, node.maxX, node.maxY, x0, y0, dx, dy, t0, t1)) continue;
+        if (node.count == 0) {
+            stack[depth++] = node.first;
+            stack[depth++] = node.first + 1;
+            continue;
+        }
+        for (unsigned int i = node.first; i < node.first + node.count; i++) {
+            const Obstacle& obstacle = obstacles[i];
+            if (obstacle.top <= maxTop) continue;
+            if (not clipSegment(obstacle.minX, obstacle.minY, obstacle.maxX, obstacle.maxY, x0, y0, dx, dy, t0, t1)) continue;
+            if (touches(obstacle, x0, y0, x1, y1, -DBL_MAX, -DBL_MAX)) maxTop = obstacle.top;
+        }
+    }
+    return maxTop;
+}
@@ -0,0 +1,93 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef OBSTACLEINDEX_H_
+#define OBSTACLEINDEX_H_
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * Bounding volume hierarchy over extruded polygon footprints (buildings) in playground coordinates.
+ *
+ * An obstacle is the even-odd area of its rings between the ground and its top. The nodes of the
+ * hierarchy hold the 2D bounding box and the highest top of their obstacles, so segments above all
+ * obstacles of a subtree are pruned without visiting it. The index is static: add() all obstacles,
+ * then build() once before the first query.
+ */
+class ObstacleIndex {
+public:
+    /**
+     * Adds an obstacle, rings is a list of closed rings of (x, y) vertex pairs.
+     */
+    void add(const std::vector<std::vector<double>>& rings, double top);
+    void build();
+
+    size_t size() const
+    {
+        return obstacles.size();
+    }
+
+    /**
+     * @return Highest top of all obstacles, 0 without obstacles
+     */
+    double getMaxTop() const
+    {
+        return nodes.empty() ? 0 : nodes[0].maxTop;
+    }
+
+    /**
+     * @return Whether the segment runs through an obstacle below its top
+     */
+    bool intersects(double x0, double y0, double z0, double x1, double y1, double z1) const;
+
+    /**
+     * @return Whether the coordinate is inside an obstacle below its top
+     */
+    bool contains(double x, double y, double z) const;
+
+    /**
+     * @return Highest top of the obstacles whose footprints are touched by the 2D segment, 0 if there are none
+     */
+    double maxTopAlong(double x0, double y0, double x1, double y1) const;
+
+private:
+    struct Obstacle {
+        double minX, minY, maxX, maxY;
+        double top;
+        unsigned int firstEdge, edgeCount;
+    };
+
+    /// Leaves hold count > 0 obstacles starting at first, inner nodes their children at first and first + 1
+    struct Node {
+        double minX, minY, maxX, maxY;
+        double maxTop;
+        unsigned int first, count;
+    };
+
+    static const unsigned int LEAF_SIZE = 4;
+
+    std::vector<Obstacle> obstacles;
+    std::vector<double> edges; // x0, y0, x1, y1 of all edges, grouped by obstacle
+    std::vector<Node> nodes;
+
+    void split(unsigned int node, unsigned int first, unsigned int count);
+    bool insideFootprint(const Obstacle& obstacle, double x, double y) const;
+    bool touches(const Obstacle& obstacle, double x0, double y0, double x1, double y1, double z0, double z1) const;
+    static bool clipSegment(double minX, double minY, double maxX, double maxY, double x0, double y0, double dx, double dy,
+            double& t0, double& t1);
+};
+
+#endif /* OBSTACLEINDEX_H_ */
@@ -0,0 +1,246 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <strings.h>
+#include <fstream>
+#include <iterator>
+#include "ObstacleMap.h"
+#include "OsgEarthScene.h"
+
+Define_Module(ObstacleMap);
+
+#define SHAPE_POLYGON 5
+#define SHAPE_POLYGON_Z 15
+#define SHAPE_POLYGON_M 25
+
+ObstacleMap *ObstacleMap::instance = nullptr;
+
+namespace {
+
+std::vector<unsigned char> readFile(const std::string& fileName)
+{
+    std::ifstream file(fileName, std::ios::in | std::ios::binary);
+    if (not file) return std::vector<unsigned char>();
+    return std::vector<unsigned char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+uint32_t readUInt32(const unsigned char* p, bool bigEndian)
+{
+    return bigEndian ? (uint32_t) p[0] << 24 | (uint32_t) p[1] << 16 | (uint32_t) p[2] << 8 | p[3]
+                     : (uint32_t) p[3] << 24 | (uint32_t) p[2] << 16 | (uint32_t) p[1] << 8 | p[0];
+}
+
+double readDouble(const unsigned char* p)
+{
+    uint64_t bits = (uint64_t) readUInt32(p + 4, false) << 32 | readUInt32(p, false);
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+}
+
+ObstacleMap::ObstacleMap()
+{
+    if (instance) throw cRuntimeError("There can be only one ObstacleMap instance in the network");
+    instance = this;
+}
+
+ObstacleMap::~ObstacleMap()
+{
+    instance = nullptr;
+}
+
+void ObstacleMap::initialize(int stage)
+{
+    // the playground conversions of the OsgEarthScene are set up in stage 0
+    if (stage != 1) return;
+    loadShapefile(par("shapeFile").stdstringValue());
+    EV_INFO << "ObstacleMap: " << index.size() << " buildings loaded, highest top " << index.getMaxTop() << "m" << endl;
+}
+
+void ObstacleMap::handleMessage(cMessage *msg)
+{
+    throw cRuntimeError("ObstacleMap does not handle messages: %s", msg->getFullName());
+}
+
+int ObstacleMap::getDetour(double fromX, double fromY, double fromZ, double toX, double toY, double toZ, double* waypoints) const
+{
+    if (not index.intersects(fromX, fromY, fromZ, toX, toY, toZ)) return 0;
+    if (index.contains(fromX, fromY, fromZ) || index.contains(toX, toY, toZ)) return 0;
+
+    double altitude = index.maxTopAlong(fromX, fromY, toX, toY);
+    int count = 0;
+    if (fromZ < altitude) {
+        waypoints[3 * count] = fromX;
+        waypoints[3 * count + 1] = fromY;
+        waypoints[3 * count + 2] = altitude;
+        count++;
+    }
+    waypoints[3 * count] = toX;
+    waypoints[3 * count + 1] = toY;
+    waypoints[3 * count + 2] = altitude;
+    return count + 1;
+}
+
+/**
+ * Reads the (multi-)polygons of an ESRI shapefile in UTM coordinates, the building heights from the dBASE file next to it.
+ * Buildings farther than margin from the playground are skipped.
+ */
+void ObstacleMap::loadShapefile(const std::string& fileName)
+{
+    std::vector<unsigned char> data = readFile(fileName);
+    if (data.size() < 100 || readUInt32(data.data(), true) != 9994) throw cRuntimeError("ObstacleMap: %s is no shapefile", fileName.c_str());
+
+    // count the records first to read the heights of all records at once
+    size_t records = 0;
+    for (size_t offset = 100; offset + 8 <= data.size(); offset += 8 + 2 * (size_t) readUInt32(&data[offset + 4], true)) {
+        records++;
+    }
+    std::string dbfFileName = fileName.substr(0, fileName.find_last_of('.')) + ".dbf";
+    std::vector<double> heights = readHeights(dbfFileName, par("heightField").stringValue(), records);
+
+    OsgEarthScene *scene = OsgEarthScene::getInstance();
+    int zone = par("utmZone").intValue();
+    double storyHeight = par("storyHeight").doubleValue();
+    double clearance = par("clearance").doubleValue();
+    double margin = par("margin").doubleValue();
+    double width = getSystemModule()->par("playgroundWidth").doubleValue();
+    double height = getSystemModule()->par("playgroundHeight").doubleValue();
+
+    std::vector<std::vector<double>> rings;
+    size_t record = 0;
+    for (size_t offset = 100; offset + 8 <= data.size(); record++) {
+        size_t length = 2 * (size_t) readUInt32(&data[offset + 4], true);
+        const unsigned char* shape = &data[offset + 8];
+        offset += 8 + length;
+        if (offset > data.size() || length < 44) continue;
+        uint32_t type = readUInt32(shape, false);
+        if (type != SHAPE_POLYGON && type != SHAPE_POLYGON_Z && type != SHAPE_POLYGON_M) continue;
+
+        uint32_t numParts = readUInt32(shape + 36, false);
+        uint32_t numPoints = readUInt32(shape + 40, false);
+        if (44 + 4 * (size_t) numParts + 16 * (size_t) numPoints > length) throw cRuntimeError("ObstacleMap: invalid record in %s", fileName.c_str());
+        const unsigned char* parts = shape + 44;
+        const unsigned char* points = parts + 4 * numParts;
+
+        rings.assign(numParts, std::vector<double>());
+        double minX = HUGE_VAL, minY = HUGE_VAL, maxX = -HUGE_VAL, maxY = -HUGE_VAL;
+        for (uint32_t part = 0; part < numParts; part++) {
+            uint32_t first = readUInt32(parts + 4 * part, false);
+            uint32_t end = (part + 1 < numParts) ? readUInt32(parts + 4 * (part + 1), false) : numPoints;
+            for (uint32_t point = first; point < end && point < numPoints; point++) {
+                double latitude, longitude;
+                utmToGeographic(readDouble(points + 16 * point), readDouble(points + 16 * point + 8), zone, latitude, longitude);
+                double x = scene->toX(longitude);
+                double y = scene->toY(latitude);
+                rings[part].push_back(x);
+                rings[part].push_back(y);
+                minX = std::min(minX, x);
+                minY = std::min(minY, y);
+                maxX = std::max(maxX, x);
+                maxY = std::max(maxY, y);
+            }
+        }
+        if (maxX < -margin || maxY < -margin || minX > width + margin || minY > height + margin) continue;
+
+        double stories = (record < heights.size()) ? heights[record] : 1;
+        index.add(rings, storyHeight * std::max(stories, 1.0) + clearance);
+    }
+    index.build();
+}
+
+/**
+ * Reads a numeric field of all records of a dBASE file, as the earth files extrude the buildings by the number of stories.
+ *
+ * @return The values of the first count records, empty if the file or field does not exist
+ */
+std::vector<double> ObstacleMap::readHeights(const std::string& fileName, const char* field, size_t count)
+{
+    std::vector<double> values;
+    std::vector<unsigned char> data = readFile(fileName);
+    if (data.size() < 32) {
+        EV_WARN << "ObstacleMap: No building heights in " << fileName << ", assuming one story" << endl;
+        return values;
+    }
+    size_t records = readUInt32(&data[4], false);
+    size_t headerLength = data[8] | data[9] << 8;
+    size_t recordLength = data[10] | data[11] << 8;
+
+    // field descriptors of 32 bytes up to the terminator 0x0D, values start after the deletion flag
+    size_t fieldOffset = 1, fieldLength = 0;
+    bool found = false;
+    for (size_t descriptor = 32; descriptor + 32 <= data.size() && data[descriptor] != 0x0D; descriptor += 32) {
+        std::string name(reinterpret_cast<const char*>(&data[descriptor]), strnlen(reinterpret_cast<const char*>(&data[descriptor]), 11));
+        fieldLength = data[descriptor + 16];
+        if (strcasecmp(name.c_str(), field) == 0) {
+            found = true;
+            break;
+        }
+        fieldOffset += fieldLength;
+    }
+    if (not found) {
+        EV_WARN << "ObstacleMap: No field " << field << " in " << fileName << ", assuming one story" << endl;
+        return values;
+    }
+
+    records = std::min(records, count);
+    values.resize(records, 1);
+    for (size_t record = 0; record < records; record++) {
+        size_t offset = headerLength + record * recordLength + fieldOffset;
+        if (offset + fieldLength > data.size()) break;
+        std::string value(reinterpret_cast<const char*>(&data[offset]), fieldLength);
+        values[record] = strtod(value.c_str(), nullptr);
+    }
+    return values;
+}
+
+/**
+ * Inverse transverse Mercator projection of the northern UTM zones on the WGS84 ellipsoid (Snyder 1987).
+ */
+void ObstacleMap::utmToGeographic(double easting, double northing, int zone, double& latitude, double& longitude)
+{
+    const double a = 6378137.0;
+    const double f = 1 / 298.257223563;
+    const double k0 = 0.9996;
+    const double e2 = f * (2 - f);
+    const double ep2 = e2 / (1 - e2);
+    const double e1 = (1 - sqrt(1 - e2)) / (1 + sqrt(1 - e2));
+
+    double x = easting - 500000;
+    double mu = northing / k0 / (a * (1 - e2 / 4 - 3 * e2 * e2 / 64 - 5 * e2 * e2 * e2 / 256));
+    double phi = mu + (3 * e1 / 2 - 27 * pow(e1, 3) / 32) * sin(2 * mu) + (21 * e1 * e1 / 16 - 55 * pow(e1, 4) / 32) * sin(4 * mu)
+            + (151 * pow(e1, 3) / 96) * sin(6 * mu) + (1097 * pow(e1, 4) / 512) * sin(8 * mu);
+
+    double sinPhi = sin(phi), cosPhi = cos(phi), tanPhi = tan(phi);
+    double c = ep2 * cosPhi * cosPhi;
+    double t = tanPhi * tanPhi;
+    double n = a / sqrt(1 - e2 * sinPhi * sinPhi);
+    double r = a * (1 - e2) / pow(1 - e2 * sinPhi * sinPhi, 1.5);
+    double d = x / (n * k0);
+
+    latitude = phi
+            - (n * tanPhi / r)
+                    * (d * d / 2 - (5 + 3 * t + 10 * c - 4 * c * c - 9 * ep2) * pow(d, 4) / 24
+                            + (61 + 90 * t + 298 * c + 45 * t * t - 252 * ep2 - 3 * c * c) * pow(d, 6) / 720);
+    longitude = (d - (1 + 2 * t + c) * pow(d, 3) / 6 + (5 - 2 * c + 28 * t - 3 * c * c + 8 * ep2 + 24 * t * t) * pow(d, 5) / 120) / cosPhi;
+    latitude = latitude * 180 / M_PI;
+    longitude = zone * 6 - 183 + longitude * 180 / M_PI;
+}
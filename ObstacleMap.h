@@ -0,0 +1,90 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef OBSTACLEMAP_H_
+#define OBSTACLEMAP_H_
+
+#include <string>
+#include <vector>
+#include <omnetpp.h>
+
+#include "ObstacleIndex.h"
+
+using namespace omnetpp;
+
+/**
+ * Building obstacles of the playground, loaded once from the polygon shapefile also shown by the earth file.
+ *
+ * The footprints are converted from UTM into playground coordinates and extruded to the height of the
+ * building plus a safety clearance. Flights whose straight line runs through a building are flown as a
+ * detour over it: climb at the origin, fly above the highest building crossed, descend at the destination.
+ */
+class ObstacleMap : public cSimpleModule {
+public:
+    /// Upper bound of intermediate waypoints returned by getDetour()
+    static const int MAX_DETOUR_WAYPOINTS = 2;
+
+    ObstacleMap();
+    virtual ~ObstacleMap();
+
+    /**
+     * @return The obstacle map of the network, nullptr if it has none
+     */
+    static ObstacleMap *getInstance()
+    {
+        return instance;
+    }
+
+    const ObstacleIndex& getIndex() const
+    {
+        return index;
+    }
+
+    /**
+     * @return Whether the direct flight between both coordinates runs through a building
+     */
+    bool isBlocked(double fromX, double fromY, double fromZ, double toX, double toY, double toZ) const
+    {
+        return index.intersects(fromX, fromY, fromZ, toX, toY, toZ);
+    }
+
+    /**
+     * Intermediate waypoints of the flight over the buildings between both coordinates, the flight
+     * from the last one to the destination is left to the caller. Flights starting or ending inside
+     * a building are not detoured.
+     *
+     * @param waypoints Output array of MAX_DETOUR_WAYPOINTS waypoints (x, y, z)
+     * @return Number of intermediate waypoints, 0 if the direct flight is clear
+     */
+    int getDetour(double fromX, double fromY, double fromZ, double toX, double toY, double toZ, double* waypoints) const;
+
+protected:
+    virtual void initialize(int stage) override;
+    virtual int numInitStages() const override
+    {
+        return 2;
+    }
+    virtual void handleMessage(cMessage *msg) override;
+
+private:
+    static ObstacleMap *instance;
+    ObstacleIndex index;
+
+    void loadShapefile(const std::string& fileName);
+    std::vector<double> readHeights(const std::string& fileName, const char* field, size_t count);
+    static void utmToGeographic(double easting, double northing, int zone, double& latitude, double& longitude);
+};
+
+#endif /* OBSTACLEMAP_H_ */
@@ -13,18 +13,21 @@
 // along with this program.  If not, see http://www.gnu.org/licenses/.
 //
 
-#ifdef WITH_OSG
+#include "OsgEarthScene.h"
+#include "ModelCache.h"
+
+#if defined(WITH_OSG) && defined(WITH_OSGEARTH)
 #include <osgDB/ReadFile>
 #include <osgEarth/Viewpoint>
 #include <osgEarth/MapNode>
 #include <osgEarth/Capabilities>
 #include <osgEarthAnnotation/RectangleNode>
 
-#include "OsgEarthScene.h"
-
-using namespace omnetpp;
 using namespace osgEarth;
 using namespace osgEarth::Annotation;
+#endif
+
+using namespace omnetpp;
 
 Define_Module(OsgEarthScene);
 
@@ -39,17 +42,22 @@ OsgEarthScene::OsgEarthScene()
 OsgEarthScene::~OsgEarthScene()
 {
     instance = nullptr;
+#if defined(WITH_OSG) && defined(WITH_OSGEARTH)
+    ModelCache::getInstance().clear();
+#endif
 }
 
 void OsgEarthScene::initialize()
 {
-    scene = osgDB::readNodeFile(par("scene"));
-    if (!scene) throw cRuntimeError("Could not read scene file \"%s\"", par("scene").stringValue());
-
     playgroundLat = getSystemModule()->par("playgroundLatitude");
     playgroundLon = getSystemModule()->par("playgroundLongitude");
     playgroundHeight = getSystemModule()->par("playgroundHeight");
     playgroundWidth = getSystemModule()->par("playgroundWidth");
+
+#if defined(WITH_OSG) && defined(WITH_OSGEARTH)
+    scene = osgDB::readNodeFile(par("scene"));
+    if (!scene) throw cRuntimeError("Could not read scene file \"%s\"", par("scene").stringValue());
+
     double centerLongitude = toLongitude(playgroundWidth / 2);
     double centerLatitude = toLatitude(playgroundHeight / 2);
 
@@ -76,6 +84,9 @@ void OsgEarthScene::initialize()
     RectangleNode *rect = new RectangleNode(mapNode, GeoPoint(geoSRS, centerLongitude, centerLatitude), Linear(playgroundWidth, Units::METERS),
             Linear(playgroundHeight, Units::METERS), rectStyle);
     mapNode->getModelLayerGroup()->addChild(rect);
+#else
+    EV_INFO << "Built without OpenSceneGraph/osgEarth, the 3D scene is not loaded" << endl;
+#endif
 }
 
 OsgEarthScene *OsgEarthScene::getInstance()
@@ -88,5 +99,3 @@ void OsgEarthScene::handleMessage(cMessage *msg)
 {
     throw cRuntimeError("This module does not handle messages from the outside");
 }
-
-#endif // WITH_OSG
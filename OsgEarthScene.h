@@ -16,14 +16,18 @@
 #ifndef __OSGEARTHSCENE_H__
 #define __OSGEARTHSCENE_H__
 
+#include <cmath>
 #include <omnetpp.h>
+#if defined(WITH_OSG) && defined(WITH_OSGEARTH)
 #include <osg/Node>
 #include <osgEarth/MapNode>
+#endif
 
 using namespace omnetpp;
 
 /**
  * Initialize global 3d canvas and load the configured earth model file.
+ * Without OpenSceneGraph/osgEarth only the playground coordinate conversions are provided.
  */
 class OsgEarthScene : public cSimpleModule {
 protected:
@@ -32,17 +36,21 @@ protected:
     double playgroundHeight;
     double playgroundWidth;
     static OsgEarthScene *instance;
+#if defined(WITH_OSG) && defined(WITH_OSGEARTH)
     osg::ref_ptr<osg::Node> scene;
+#endif
 
 public:
     OsgEarthScene();
     virtual ~OsgEarthScene();
 
     static OsgEarthScene *getInstance();
+#if defined(WITH_OSG) && defined(WITH_OSGEARTH)
     virtual osg::Node *getScene()
     {
         return scene;
     }
+#endif
     // latitude from local y coordinate
     virtual double toLatitude(double y)
     {
@@ -63,7 +71,7 @@ public:
     {
         return (longitude - playgroundLon) * cos(fabs(playgroundLat / 180 * M_PI)) * 111111;
     }
-    
+
 protected:
     virtual void initialize() override;
     virtual void handleMessage(cMessage *msg) override;
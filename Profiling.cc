@@ -0,0 +1,86 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+
+#include <algorithm>
+#include <iomanip>
+#include <vector>
+
+#include "Profiling.h"
+
+Profiling& Profiling::getInstance()
+{
+    static Profiling instance;
+    return instance;
+}
+
+Profiling::Entry* Profiling::getEntry(const char *name)
+{
+    for (auto& entry : entries) {
+        if (entry.name == name) return &entry;
+    }
+    entries.emplace_back();
+    entries.back().name = name;
+    return &entries.back();
+}
+
+void Profiling::reset()
+{
+    for (auto& entry : entries) {
+        entry.calls = 0;
+        entry.seconds = 0;
+    }
+}
+
+void Profiling::recordScalars(cComponent *component) const
+{
+    for (auto& entry : entries) {
+        component->recordScalar(("profile." + entry.name + ".calls").c_str(), entry.calls);
+        component->recordScalar(("profile." + entry.name + ".seconds").c_str(), entry.seconds, "s");
+    }
+}
+
+void Profiling::printSummary(std::ostream& out) const
+{
+    std::vector<const Entry *> sorted;
+    for (auto& entry : entries) {
+        if (entry.calls > 0) sorted.push_back(&entry);
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const Entry *a, const Entry *b) {return a->seconds > b->seconds;});
+
+    out << std::left << std::setw(48) << "hot path" << std::right << std::setw(14) << "calls" << std::setw(14) << "seconds" << std::setw(14)
+            << "us/call" << std::endl;
+    for (auto entry : sorted) {
+        out << std::left << std::setw(48) << entry->name << std::right << std::setw(14) << entry->calls << std::setw(14) << std::fixed
+                << std::setprecision(3) << entry->seconds << std::setw(14) << entry->seconds / entry->calls * 1e6 << std::endl;
+    }
+}
+
+ModuleProfiling::Entry* ModuleProfiling::getEntry(const std::string& name)
+{
+    auto it = entries.find(name);
+    if (it != entries.end()) return &it->second;
+    Entry& entry = entries[name];
+    entry.global = Profiling::getInstance().getEntry(name.c_str());
+    entry.durations.setName(("profile." + name).c_str());
+    return &entry;
+}
+
+void ModuleProfiling::recordStatistics(cComponent *component)
+{
+    for (auto& entry : entries) {
+        if (entry.second.durations.getCount() > 0) component->recordStatistic(&entry.second.durations, "s");
+    }
+}
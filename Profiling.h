@@ -0,0 +1,162 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+
+#ifndef PROFILING_H_
+#define PROFILING_H_
+
+#include <chrono>
+#include <deque>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <omnetpp.h>
+
+using namespace omnetpp;
+
+/**
+ * Process wide call counts and wall time of hot code paths.
+ * Only filled if compiled with WITH_PROFILING ("make PROFILING=yes"),
+ * otherwise the PROFILE_* macros expand to nothing and no clock is read.
+ */
+class Profiling {
+public:
+    struct Entry {
+        std::string name;
+        unsigned long calls = 0;
+        double seconds = 0;
+    };
+
+    static Profiling& getInstance();
+
+    /**
+     * @return The entry of the given name, its address stays valid for the whole process
+     */
+    Entry* getEntry(const char *name);
+
+    /**
+     * Zeroes all entries, e.g. at the start of a new run in the same process.
+     */
+    void reset();
+
+    /**
+     * Records calls and seconds of every entry as scalars of the given module.
+     */
+    void recordScalars(cComponent *component) const;
+
+    /**
+     * Writes a table of all entries, sorted by the time spent in them.
+     */
+    void printSummary(std::ostream& out) const;
+
+private:
+    std::deque<Entry> entries;
+};
+
+/**
+ * Adds the wall time between construction and destruction to an entry.
+ */
+class ProfilingScope {
+public:
+    explicit ProfilingScope(Profiling::Entry *entry) :
+            entry(entry), start(std::chrono::steady_clock::now())
+    {
+    }
+    ~ProfilingScope()
+    {
+        entry->calls++;
+        entry->seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+private:
+    Profiling::Entry *entry;
+    std::chrono::steady_clock::time_point start;
+};
+
+/**
+ * Call counts and durations of the code paths of a single module.
+ * Every call is also added to the process wide Profiling entry of the same name.
+ */
+class ModuleProfiling {
+public:
+    struct Entry {
+        Profiling::Entry *global = nullptr;
+        cStdDev durations;
+    };
+
+    /**
+     * Lookup by address, name has to be a string literal.
+     */
+    Entry* getEntry(const char *name)
+    {
+        auto it = literalEntries.find(name);
+        if (it != literalEntries.end()) return it->second;
+        Entry *entry = getEntry(std::string(name));
+        literalEntries[name] = entry;
+        return entry;
+    }
+    Entry* getEntry(const std::string& name);
+
+    /**
+     * Records the durations of every entry as statistic "profile.<name>" of the given module.
+     */
+    void recordStatistics(cComponent *component);
+
+private:
+    std::unordered_map<std::string, Entry> entries;
+    std::unordered_map<const char *, Entry *> literalEntries;
+};
+
+/**
+ * Adds the wall time between construction and destruction to a module entry and its process wide entry.
+ */
+class ModuleProfilingScope {
+public:
+    explicit ModuleProfilingScope(ModuleProfiling::Entry *entry) :
+            entry(entry), start(std::chrono::steady_clock::now())
+    {
+    }
+    ~ModuleProfilingScope()
+    {
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        entry->durations.collect(seconds);
+        entry->global->calls++;
+        entry->global->seconds += seconds;
+    }
+
+private:
+    ModuleProfiling::Entry *entry;
+    std::chrono::steady_clock::time_point start;
+};
+
+#ifdef WITH_PROFILING
+#define PROFILE_MODULE_SCOPE(profiling, name) \
+    ModuleProfilingScope moduleProfilingScope((profiling).getEntry(name))
+#define PROFILE_MESSAGE_SCOPE(profiling, msg) \
+    ModuleProfilingScope moduleProfilingScope((profiling).getEntry(std::string("handleMessage(") + (msg)->getName() + ")"))
+#else
+#define PROFILE_MODULE_SCOPE(profiling, name)
+#define PROFILE_MESSAGE_SCOPE(profiling, msg)
+#endif
+
+#ifdef WITH_PROFILING
+#define PROFILE_SCOPE(name) \
+    static Profiling::Entry *profilingEntry = Profiling::getInstance().getEntry(name); \
+    ProfilingScope profilingScope(profilingEntry)
+#else
+#define PROFILE_SCOPE(name)
+#endif
+
+#endif /* PROFILING_H_ */
@@ -0,0 +1,144 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include "RealTimeScheduler.h"
+
+Register_Class(RealTimeScheduler);
+
+Register_GlobalConfigOption(CFGID_REALTIME_SCALING, "realtime-scaling", CFG_DOUBLE, "1", "RealTimeScheduler: simulated seconds per wall clock second");
+Register_GlobalConfigOptionU(CFGID_REALTIME_TICK, "realtime-tick", "s", "100ms", "RealTimeScheduler: events within one tick are executed as one batch");
+Register_GlobalConfigOptionU(CFGID_REALTIME_MAX_LAG, "realtime-max-lag", "s", "500ms",
+        "RealTimeScheduler: display refreshes are skipped while the simulation is more than this behind the wall clock");
+
+#define MAX_SLEEP std::chrono::milliseconds(20) // keeps the GUI responsive while waiting
+
+bool RealTimeScheduler::behind = false;
+simsignal_t RealTimeScheduler::lagSignal = cComponent::registerSignal("realtimeLag");
+simsignal_t RealTimeScheduler::jitterSignal = cComponent::registerSignal("realtimeJitter");
+simsignal_t RealTimeScheduler::behindSignal = cComponent::registerSignal("realtimeBehind");
+
+RealTimeScheduler::RealTimeScheduler()
+{
+}
+
+RealTimeScheduler::~RealTimeScheduler()
+{
+    behind = false;
+}
+
+std::string RealTimeScheduler::info() const
+{
+    char buffer[80];
+    snprintf(buffer, sizeof(buffer), "scaling %g, tick %gs, %ld batches", scaling, tick, batches);
+    return buffer;
+}
+
+void RealTimeScheduler::startRun()
+{
+    scaling = getEnvir()->getConfig()->getAsDouble(CFGID_REALTIME_SCALING);
+    tick = getEnvir()->getConfig()->getAsDouble(CFGID_REALTIME_TICK);
+    maxLag = getEnvir()->getConfig()->getAsDouble(CFGID_REALTIME_MAX_LAG);
+    if (scaling <= 0) throw cRuntimeError("RealTimeScheduler: realtime-scaling must be positive");
+    if (tick <= 0) throw cRuntimeError("RealTimeScheduler: realtime-tick must be positive");
+    baseTime = Clock::now();
+    tickEnd = SIMTIME_ZERO;
+    lastLag = 0;
+    batches = 0;
+    behind = false;
+}
+
+void RealTimeScheduler::endRun()
+{
+    behind = false;
+}
+
+/**
+ * Continues at the current simulation time after the simulation was stopped, e.g. in the GUI.
+ */
+void RealTimeScheduler::executionResumed()
+{
+    baseTime = Clock::now() - std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(sim->getSimTime().dbl() / scaling));
+    tickEnd = SIMTIME_ZERO;
+    setBehind(false);
+}
+
+cEvent *RealTimeScheduler::guessNextEvent()
+{
+    return sim->getFES()->peekFirst();
+}
+
+/**
+ * Events of the current tick are returned immediately, the first event of a later tick after waiting for its start.
+ *
+ * @return nullptr if the user interrupted the wait
+ */
+cEvent *RealTimeScheduler::takeNextEvent()
+{
+    cEvent *event = sim->getFES()->peekFirst();
+    if (event == nullptr) throw cTerminationException(E_ENDEDOK);
+
+    simtime_t arrival = event->getArrivalTime();
+    if (arrival >= tickEnd) {
+        double tickIndex = floor(arrival.dbl() / tick);
+        Clock::time_point target = toWallClock(tickIndex * tick);
+        if (not waitUntil(target)) return nullptr;
+        tickEnd = (tickIndex + 1) * tick;
+
+        double lag = std::chrono::duration<double>(Clock::now() - target).count();
+        sim->getSystemModule()->emit(lagSignal, lag);
+        if (batches > 0) sim->getSystemModule()->emit(jitterSignal, fabs(lag - lastLag));
+        lastLag = lag;
+        batches++;
+        if (not behind && lag > maxLag) setBehind(true);
+        else if (behind && lag < maxLag / 2) setBehind(false);
+    }
+    return sim->getFES()->removeFirst();
+}
+
+void RealTimeScheduler::putBackEvent(cEvent *event)
+{
+    sim->getFES()->putBackFirst(event);
+}
+
+RealTimeScheduler::Clock::time_point RealTimeScheduler::toWallClock(simtime_t t) const
+{
+    return baseTime + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(t.dbl() / scaling));
+}
+
+/**
+ * Sleeps in short steps, so an interrupt by the user is handled in time.
+ *
+ * @return false if the user interrupted the wait
+ */
+bool RealTimeScheduler::waitUntil(Clock::time_point target)
+{
+    while (true) {
+        if (getEnvir()->idle()) return false;
+        Clock::time_point now = Clock::now();
+        if (now >= target) return true;
+        std::this_thread::sleep_for(std::min<Clock::duration>(target - now, MAX_SLEEP));
+    }
+}
+
+void RealTimeScheduler::setBehind(bool value)
+{
+    if (behind == value) return;
+    behind = value;
+    sim->getSystemModule()->emit(behindSignal, behind);
+    if (behind) EV_WARN << "RealTimeScheduler: " << lastLag << "s behind the wall clock, skipping display refreshes" << endl;
+}
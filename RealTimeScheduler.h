@@ -0,0 +1,80 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef REALTIMESCHEDULER_H_
+#define REALTIMESCHEDULER_H_
+
+#include <chrono>
+#include <omnetpp.h>
+
+using namespace omnetpp;
+
+/**
+ * Real-time scheduler that releases the events tick by tick, e.g. to run next to ground station software.
+ *
+ * All events within one tick of realtime-tick simulated seconds are one batch: the scheduler waits until
+ * the wall clock reaches the start of the tick, then executes the batch without further waits. Nodes with
+ * alignTimeStep update at the same instants, so their updates fall into one batch. Targets are computed
+ * from the start of the run, the simulation does not drift when single ticks are late.
+ *
+ * The lag of every batch behind the wall clock and its change to the previous batch (jitter) are emitted
+ * as realtimeLag and realtimeJitter signals of the network. If the lag exceeds realtime-max-lag, the
+ * nodes skip their display refreshes until it dropped below half of it again.
+ *
+ * Select it with scheduler-class = "RealTimeScheduler".
+ */
+class RealTimeScheduler : public cScheduler {
+public:
+    RealTimeScheduler();
+    virtual ~RealTimeScheduler();
+
+    /**
+     * @return Whether the simulation is behind the wall clock by more than realtime-max-lag, always false with other schedulers
+     */
+    static bool isBehind()
+    {
+        return behind;
+    }
+
+    virtual std::string info() const override;
+    virtual void startRun() override;
+    virtual void endRun() override;
+    virtual void executionResumed() override;
+    virtual cEvent *guessNextEvent() override;
+    virtual cEvent *takeNextEvent() override;
+    virtual void putBackEvent(cEvent *event) override;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    static bool behind;
+    static simsignal_t lagSignal;
+    static simsignal_t jitterSignal;
+    static simsignal_t behindSignal;
+
+    double scaling = 1;
+    double tick = 0.1;
+    double maxLag = 0.5;
+    Clock::time_point baseTime; // wall clock time of simulation time 0
+    simtime_t tickEnd;
+    double lastLag = 0;
+    long batches = 0;
+
+    Clock::time_point toWallClock(simtime_t t) const;
+    bool waitUntil(Clock::time_point target);
+    void setBehind(bool value);
+};
+
+#endif /* REALTIMESCHEDULER_H_ */
@@ -25,17 +25,15 @@ using namespace omnetpp;
 
 /**
  * Contains data needed for an exchange of a node.
- * In one scenario this data is sent from a node to the mission control to ask for a replacement at a given time and position
+ * In one scenario this data is sent from a node to the mission control to ask for a replacement at a given time and position.
+ * Passed and stored by value, e.g. in the CmdCompletedMsg and the NodeShadow of the node to replace.
  */
 class ReplacementData {
 public:
-    ReplacementData();
-    virtual ~ReplacementData();
-
     /**
      * The node to be replaced by another
      */
-    GenericNode* nodeToReplace;
+    GenericNode* nodeToReplace = nullptr;
 
     /**
      * The node replacing the other one. This field is optional.
@@ -52,8 +50,7 @@ public:
      * Where the replacement should take place.
      * Might be calculated by the node based on it's prediction for future maneuvers.
      */
-    double x, y, z;
-//private:
+    double x = 0, y = 0, z = 0;
 };
 
 #endif /* REPLACEMENTDATA_H_ */
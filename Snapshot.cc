@@ -0,0 +1,85 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#include <algorithm>
+#include <fstream>
+#include <omnetpp.h>
+#include "Snapshot.h"
+
+using namespace omnetpp;
+
+#define SNAPSHOT_MAGIC 0x32534d55 // "UMS2"
+
+void Snapshot::write(const std::string& fileName) const
+{
+    std::ofstream file(fileName, std::ios::out | std::ios::binary | std::ios::trunc);
+    uint32_t magic = SNAPSHOT_MAGIC;
+    uint32_t nodeCount = nodes.size();
+    uint32_t chargingNodeCount = chargingNodes.size();
+    file.write(reinterpret_cast<const char*>(&magic), sizeof(magic));
+    file.write(reinterpret_cast<const char*>(&simTime), sizeof(simTime));
+    file.write(reinterpret_cast<const char*>(&missionCount), sizeof(missionCount));
+    file.write(reinterpret_cast<const char*>(&seedSet), sizeof(seedSet));
+    file.write(reinterpret_cast<const char*>(&nodeCount), sizeof(nodeCount));
+    file.write(reinterpret_cast<const char*>(nodes.data()), nodeCount * sizeof(NodeState));
+    file.write(reinterpret_cast<const char*>(&chargingNodeCount), sizeof(chargingNodeCount));
+    for (auto it = chargingNodes.begin(); it != chargingNodes.end(); it++) {
+        uint32_t queueLength = it->queue.size();
+        file.write(reinterpret_cast<const char*>(&it->index), sizeof(it->index));
+        file.write(reinterpret_cast<const char*>(&queueLength), sizeof(queueLength));
+        file.write(reinterpret_cast<const char*>(it->queue.data()), queueLength * sizeof(int32_t));
+    }
+    if (not file) throw cRuntimeError("Snapshot::write(): Could not write %s", fileName.c_str());
+}
+
+Snapshot Snapshot::read(const std::string& fileName)
+{
+    std::ifstream file(fileName, std::ios::in | std::ios::binary);
+    if (not file) throw cRuntimeError("Snapshot::read(): Could not open %s", fileName.c_str());
+    // counts are checked against the remaining bytes before allocating, a corrupt count would allocate for it
+    file.seekg(0, std::ios::end);
+    std::streamoff fileSize = file.tellg();
+    file.seekg(0);
+    auto remainingBytes = [&file, fileSize]() {
+        return (uint64_t) std::max<std::streamoff>(fileSize - file.tellg(), 0);
+    };
+
+    Snapshot snapshot;
+    uint32_t magic = 0, nodeCount = 0, chargingNodeCount = 0;
+    file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+    if (not file || magic != SNAPSHOT_MAGIC) throw cRuntimeError("Snapshot::read(): %s is no snapshot file", fileName.c_str());
+    file.read(reinterpret_cast<char*>(&snapshot.simTime), sizeof(snapshot.simTime));
+    file.read(reinterpret_cast<char*>(&snapshot.missionCount), sizeof(snapshot.missionCount));
+    file.read(reinterpret_cast<char*>(&snapshot.seedSet), sizeof(snapshot.seedSet));
+    file.read(reinterpret_cast<char*>(&nodeCount), sizeof(nodeCount));
+    if (not file || nodeCount > remainingBytes() / sizeof(NodeState)) throw cRuntimeError("Snapshot::read(): %s is truncated", fileName.c_str());
+    snapshot.nodes.resize(nodeCount);
+    file.read(reinterpret_cast<char*>(snapshot.nodes.data()), nodeCount * sizeof(NodeState));
+    file.read(reinterpret_cast<char*>(&chargingNodeCount), sizeof(chargingNodeCount));
+    if (not file || chargingNodeCount > remainingBytes() / (2 * sizeof(int32_t))) {
+        throw cRuntimeError("Snapshot::read(): %s is truncated", fileName.c_str());
+    }
+    snapshot.chargingNodes.resize(chargingNodeCount);
+    for (auto it = snapshot.chargingNodes.begin(); it != snapshot.chargingNodes.end(); it++) {
+        uint32_t queueLength = 0;
+        file.read(reinterpret_cast<char*>(&it->index), sizeof(it->index));
+        file.read(reinterpret_cast<char*>(&queueLength), sizeof(queueLength));
+        if (not file || queueLength > remainingBytes() / sizeof(int32_t)) throw cRuntimeError("Snapshot::read(): %s is truncated", fileName.c_str());
+        it->queue.resize(queueLength);
+        file.read(reinterpret_cast<char*>(it->queue.data()), queueLength * sizeof(int32_t));
+    }
+    if (not file) throw cRuntimeError("Snapshot::read(): %s is truncated", fileName.c_str());
+    return snapshot;
+}
@@ -0,0 +1,73 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef SNAPSHOT_H_
+#define SNAPSHOT_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Fleet state of one MissionControl at a point in time, written to a compact binary file
+ * (snapshotFile at snapshotTime) and read by later runs as warm start (warmStartFile).
+ *
+ * The file holds a header, the NodeState records and per charging node its queue. It is written in
+ * the native byte order, like the mission cache of the WaypointsLoader.
+ * Each region of a RegionalNet writes and reads its own file, its name gets the region as suffix.
+ */
+struct Snapshot {
+    /**
+     * State of one UAV, plain data so that the records are written as one block.
+     */
+    struct NodeState {
+        int32_t index;
+        double x, y, z, yaw;
+        float capacity, remaining;
+        int32_t status;         // NodeStatus of the node shadow
+        int32_t missionId;      // -1: no mission
+        int32_t missionCursor;  // index of the next mission command, -1: none
+        int32_t missionRepeat;
+        int32_t chargingNode;   // index of the charging node the UAV heads to or charges at, -1: none
+        uint64_t rngDraws;      // numbers drawn from the random stream of the UAV
+    };
+
+    /**
+     * Nodes in the charging spots and in the waiting queue of one charging node, in this order.
+     */
+    struct ChargingNodeState {
+        int32_t index;
+        std::vector<int32_t> queue;
+    };
+
+    double simTime = 0;
+    uint32_t missionCount = 0;
+    /// seed set of the run that wrote the snapshot, the random streams of the UAVs continue from it
+    uint32_t seedSet = 0;
+    std::vector<NodeState> nodes;
+    std::vector<ChargingNodeState> chargingNodes;
+
+    /**
+     * @throws cRuntimeError if the file could not be written
+     */
+    void write(const std::string& fileName) const;
+
+    /**
+     * @throws cRuntimeError if the file could not be read or is no snapshot
+     */
+    static Snapshot read(const std::string& fileName);
+};
+
+#endif /* SNAPSHOT_H_ */
@@ -0,0 +1,201 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#include <algorithm>
+#include "TelemetryRecorder.h"
+#include "MobileNode.h"
+#include "NodeKinematics.h"
+#include "CommandExecEngine.h"
+
+Define_Module(TelemetryRecorder);
+
+#define TELEMETRY_MAGIC 0x31544d55 // "UMT1"
+
+TelemetryRecorder *TelemetryRecorder::instance = nullptr;
+
+void TelemetryRecorder::Chunk::clear()
+{
+    time.clear();
+    node.clear();
+    x.clear();
+    y.clear();
+    z.clear();
+    yaw.clear();
+    remaining.clear();
+    ceeType.clear();
+    status.clear();
+    reason.clear();
+}
+
+TelemetryRecorder::TelemetryRecorder()
+{
+    if (instance) throw cRuntimeError("There can be only one TelemetryRecorder instance in the network");
+    instance = this;
+}
+
+TelemetryRecorder::~TelemetryRecorder()
+{
+    stop();
+    cancelAndDelete(sampleTimer);
+    instance = nullptr;
+}
+
+void TelemetryRecorder::initialize()
+{
+    recordUpdates = par("recordUpdates").boolValue();
+    recordStatusChanges = par("recordStatusChanges").boolValue();
+    samplingInterval = par("samplingInterval");
+    bufferRecords = std::max(1, (int) par("bufferRecords").intValue());
+
+    std::string fileName = par("fileName").stdstringValue();
+    if (fileName.empty()) {
+        cConfigurationEx *config = getEnvir()->getConfigEx();
+        fileName = std::string(config->getVariable(CFGVAR_RESULTDIR)) + "/" + config->getVariable(CFGVAR_CONFIGNAME) + "-"
+                + config->getVariable(CFGVAR_RUNNUMBER);
+        // recorders of the regions of a parallel simulation
+        if (getParentModule() != getSystemModule()) fileName += std::string("-") + getParentModule()->getFullName();
+        fileName += ".telemetry";
+    }
+    file.open(fileName, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (not file) throw cRuntimeError("TelemetryRecorder: Could not open %s", fileName.c_str());
+    uint32_t magic = TELEMETRY_MAGIC;
+    file.write(reinterpret_cast<const char*>(&magic), sizeof(magic));
+
+    chunk.reset(new Chunk());
+    stopWriter = false;
+    writer = std::thread(&TelemetryRecorder::writeChunks, this);
+
+    if (samplingInterval > 0) {
+        sampleTimer = new cMessage("sample");
+        scheduleAt(simTime(), sampleTimer);
+    }
+}
+
+void TelemetryRecorder::handleMessage(cMessage *msg)
+{
+    if (msg == sampleTimer) {
+        sampleAll();
+        scheduleAt(simTime() + samplingInterval, sampleTimer);
+    }
+    else {
+        throw cRuntimeError("Unknown message name encountered: %s", msg->getFullName());
+    }
+}
+
+void TelemetryRecorder::finish()
+{
+    stop();
+    recordScalar("telemetryRecords", recordCount);
+}
+
+void TelemetryRecorder::record(GenericNode *node, Reason reason)
+{
+    MobileNode *mobileNode = dynamic_cast<MobileNode *>(node);
+    if (mobileNode == nullptr || chunk == nullptr || node->getKinematicsSlot() < 0) return;
+
+    CommandExecEngine *cee = node->getCommandExecEngine();
+    chunk->time.push_back(simTime().dbl());
+    // the index repeats in every region of a RegionalNet, the module id is unique in the process
+    chunk->node.push_back(node->getId());
+    chunk->x.push_back(node->getX());
+    chunk->y.push_back(node->getY());
+    chunk->z.push_back(node->getZ());
+    chunk->yaw.push_back(node->getYaw());
+    chunk->remaining.push_back(mobileNode->getExtrapolatedBattery().getRemaining());
+    chunk->ceeType.push_back((cee != nullptr) ? (int8_t) cee->getCeeType() : -1);
+    chunk->status.push_back(NodeKinematics::getInstance().getStatus()[node->getKinematicsSlot()]);
+    chunk->reason.push_back(reason);
+    recordCount++;
+
+    if (chunk->size() >= bufferRecords) submitChunk();
+}
+
+/**
+ * One record per mobile node, in the order of the kinematics table.
+ */
+void TelemetryRecorder::sampleAll()
+{
+    const NodeKinematics& kinematics = NodeKinematics::getInstance();
+    for (int slot = 0; slot < kinematics.size(); slot++) {
+        GenericNode *node = kinematics.getNode(slot);
+        if (node != nullptr) record(node, SAMPLE);
+    }
+}
+
+/**
+ * Hands the current chunk to the writer thread and continues with a spare one.
+ */
+void TelemetryRecorder::submitChunk()
+{
+    std::unique_ptr<Chunk> next;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        fullChunks.push_back(std::move(chunk));
+        if (not spareChunks.empty()) {
+            next = std::move(spareChunks.back());
+            spareChunks.pop_back();
+        }
+    }
+    chunksChanged.notify_one();
+    chunk = next ? std::move(next) : std::unique_ptr<Chunk>(new Chunk());
+}
+
+/**
+ * Writer thread: writes the full chunks column by column until stop() is called and all chunks are written.
+ */
+void TelemetryRecorder::writeChunks()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        chunksChanged.wait(lock, [this]() {return stopWriter || not fullChunks.empty();});
+        if (fullChunks.empty()) break;
+        std::unique_ptr<Chunk> full = std::move(fullChunks.front());
+        fullChunks.pop_front();
+        lock.unlock();
+
+        uint32_t count = full->size();
+        file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+        file.write(reinterpret_cast<const char*>(full->time.data()), count * sizeof(double));
+        file.write(reinterpret_cast<const char*>(full->node.data()), count * sizeof(int32_t));
+        for (const std::vector<float>* column : { &full->x, &full->y, &full->z, &full->yaw, &full->remaining }) {
+            file.write(reinterpret_cast<const char*>(column->data()), count * sizeof(float));
+        }
+        file.write(reinterpret_cast<const char*>(full->ceeType.data()), count);
+        file.write(reinterpret_cast<const char*>(full->status.data()), count);
+        file.write(reinterpret_cast<const char*>(full->reason.data()), count);
+        full->clear();
+
+        lock.lock();
+        spareChunks.push_back(std::move(full));
+    }
+}
+
+/**
+ * Writes the records collected so far and closes the file, called by finish() or on deletion.
+ */
+void TelemetryRecorder::stop()
+{
+    if (not writer.joinable()) return;
+    if (chunk != nullptr && chunk->size() > 0) submitChunk();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopWriter = true;
+    }
+    chunksChanged.notify_one();
+    writer.join();
+    chunk.reset();
+    spareChunks.clear();
+    file.close();
+}
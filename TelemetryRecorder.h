@@ -0,0 +1,129 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef TELEMETRYRECORDER_H_
+#define TELEMETRYRECORDER_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <omnetpp.h>
+
+#include "GenericNode.h"
+
+using namespace omnetpp;
+
+/**
+ * Streams the trajectories and battery traces of all mobile nodes into a binary file, as replacement
+ * for the eventlog in long runs.
+ *
+ * Records are sampled every samplingInterval, after every node update (recordUpdates) and on every
+ * NodeStatus change (recordStatusChanges). They are collected in chunks of bufferRecords records,
+ * full chunks are written by a background thread, so the simulation does not wait for the disk.
+ *
+ * File layout (native byte order): uint32 magic "UMT1", then chunks of uint32 count followed by the
+ * columns of the count records: double time[], int32 node[], float x[], y[], z[], yaw[], remaining[],
+ * int8 ceeType[], int8 status[], uint8 reason[]. node is the module id, unique over all regions of a
+ * RegionalNet, unlike the node index. See scripts/telemetry.py for a reader.
+ */
+class TelemetryRecorder : public cSimpleModule {
+public:
+    /// Why a record was written
+    enum Reason : uint8_t {
+        SAMPLE = 0, UPDATE = 1, STATUS_CHANGE = 2
+    };
+
+    TelemetryRecorder();
+    virtual ~TelemetryRecorder();
+
+    /**
+     * @return The recorder of the network, nullptr if it has none
+     */
+    static TelemetryRecorder *getInstance()
+    {
+        return instance;
+    }
+
+    /**
+     * Called by the nodes after every update.
+     */
+    void recordUpdate(GenericNode *node)
+    {
+        if (recordUpdates) record(node, UPDATE);
+    }
+
+    /**
+     * Called by the MissionControl node shadows on every status change.
+     */
+    void recordStatusChange(GenericNode *node)
+    {
+        if (recordStatusChanges) record(node, STATUS_CHANGE);
+    }
+
+protected:
+    virtual void initialize() override;
+    virtual void handleMessage(cMessage *msg) override;
+    virtual void finish() override;
+
+private:
+    /**
+     * Columns of up to bufferRecords records.
+     */
+    struct Chunk {
+        std::vector<double> time;
+        std::vector<int32_t> node;
+        std::vector<float> x, y, z, yaw, remaining;
+        std::vector<int8_t> ceeType, status;
+        std::vector<uint8_t> reason;
+
+        void clear();
+        size_t size() const
+        {
+            return time.size();
+        }
+    };
+
+    static TelemetryRecorder *instance;
+
+    bool recordUpdates = false;
+    bool recordStatusChanges = true;
+    simtime_t samplingInterval;
+    size_t bufferRecords = 0;
+    cMessage *sampleTimer = nullptr;
+    long recordCount = 0;
+
+    std::unique_ptr<Chunk> chunk;
+    std::ofstream file;
+    std::thread writer;
+    std::mutex mutex;
+    std::condition_variable chunksChanged;
+    std::deque<std::unique_ptr<Chunk>> fullChunks;  // waiting for the writer
+    std::vector<std::unique_ptr<Chunk>> spareChunks; // written, for reuse
+    bool stopWriter = false;
+
+    void record(GenericNode *node, Reason reason);
+    void sampleAll();
+    void submitChunk();
+    void writeChunks();
+    void stop();
+};
+
+#endif /* TELEMETRYRECORDER_H_ */
@@ -0,0 +1,51 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#include <algorithm>
+#include <boost/math/distributions/normal.hpp>
+#include "TruncatedNormal.h"
+
+const TruncatedNormal& TruncatedNormal::getInstance()
+{
+    static const TruncatedNormal instance;
+    return instance;
+}
+
+TruncatedNormal::TruncatedNormal()
+{
+    boost::math::normal standard(0, 1);
+    minProbability = cdf(-MAX_Z);
+    double step = (cdf(MAX_Z) - minProbability) / TABLE_SIZE;
+    inverseStep = 1 / step;
+
+    quantiles[0] = -MAX_Z;
+    for (u_int i = 1; i < TABLE_SIZE; i++) {
+        quantiles[i] = boost::math::quantile(standard, minProbability + i * step);
+    }
+    quantiles[TABLE_SIZE] = MAX_Z;
+}
+
+double TruncatedNormal::sample(double u, double lower, double upper) const
+{
+    if (lower >= upper) return lower;
+
+    double lowerProbability = cdf(lower);
+    double p = lowerProbability + u * (cdf(upper) - lowerProbability);
+
+    double position = (p - minProbability) * inverseStep;
+    u_int i = std::min((u_int) std::max(position, 0.0), TABLE_SIZE - 1);
+    double z = quantiles[i] + (position - i) * (quantiles[i + 1] - quantiles[i]);
+    return std::min(std::max(z, lower), upper);
+}
@@ -0,0 +1,72 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef TRUNCATEDNORMAL_H_
+#define TRUNCATEDNORMAL_H_
+
+#include <cmath>
+#include <sys/types.h>
+
+/**
+ * Inverse transform sampler for the standard normal distribution truncated to [-MAX_Z, +MAX_Z]
+ * or a narrower interval, with a fixed cost per draw.
+ *
+ * The quantile function is tabulated once over the probabilities of [-MAX_Z, +MAX_Z].
+ * A draw maps a uniform u to the probability range of the truncation interval and
+ * interpolates linearly in the table, unlike a rejection loop it never draws twice.
+ */
+class TruncatedNormal {
+public:
+    static constexpr double MAX_Z = 3;
+
+    static const TruncatedNormal& getInstance();
+
+    /**
+     * Distribution function of the standard normal distribution.
+     */
+    static double cdf(double z)
+    {
+        return 0.5 * std::erfc(-z * M_SQRT1_2);
+    }
+
+    /**
+     * @param u Uniform random value in [0, 1)
+     * @param lower Lower bound of the standard normal value, at least -MAX_Z
+     * @param upper Upper bound of the standard normal value, at most +MAX_Z
+     * @return Standard normal value within [lower, upper], lower if the interval is empty
+     */
+    double sample(double u, double lower, double upper) const;
+
+    /**
+     * Normal value with mean and stddev, truncated to mean +- MAX_Z * stddev and to values
+     * of at least minimum.
+     */
+    double sample(double u, double mean, double stddev, double minimum) const
+    {
+        double lower = std::fmax(-MAX_Z, (minimum - mean) / stddev);
+        return mean + stddev * sample(u, lower, MAX_Z);
+    }
+
+private:
+    TruncatedNormal();
+
+    static const u_int TABLE_SIZE = 4096;
+
+    double minProbability;
+    double inverseStep;
+    double quantiles[TABLE_SIZE + 1];
+};
+
+#endif /* TRUNCATEDNORMAL_H_ */
@@ -13,7 +13,7 @@
 // along with this program.  If not, see http://www.gnu.org/licenses/.
 //
 
-#ifdef WITH_OSG
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <sstream>
@@ -21,6 +21,10 @@
 #include "UAVNode.h"
 #include "OsgEarthScene.h"
 #include "ChannelController.h"
+#include "ObstacleMap.h"
+#include "RealTimeScheduler.h"
+#include "Profiling.h"
+#include "MessageKind.h"
 
 #include "msgs/MissionMsg_m.h"
 #include "msgs/ExchangeCompletedMsg_m.h"
@@ -29,14 +33,28 @@ using namespace omnetpp;
 
 Define_Module(UAVNode);
 
+std::set<float> UAVNode::predictionTableVerifiedQuantiles;
+
 #define ERROR_MARGIN 0.1875
 
+#define CN_SEARCH_MANHATTAN 0
+#define CN_SEARCH_EUCLIDEAN 1
+#define CN_SEARCH_ENERGY 2
+
+#define HEURISTIC_LATEST_OPPOTUNITY 0
+#define HEURISTIC_SHORTEST_RETURN 1
+#define HEURISTIC_BIOBJECTIVE 2
+
 UAVNode::UAVNode()
 {
 }
 
 UAVNode::~UAVNode()
 {
+    // deletes the commands owned by the CEEs, e.g. detours
+    releaseQueuedCEEs();
+    releaseCEE(commandExecEngine);
+    delete rng;
 }
 
 /**
@@ -54,6 +72,47 @@ void UAVNode::initialize(int stage)
             y = par("startY");
             z = par("startZ");
             quantile = par("predictionQuantile").doubleValue();
+            quantileZ = boost::math::quantile(boost::math::normal(0, 1), quantile);
+            usePredictionTable = par("usePredictionTable").boolValue();
+            initializeRNG();
+            chargingNodeSearchMethod = par("chargingNodeSearchMethod");
+            obstacleMap = ObstacleMap::getInstance();
+            if (chargingNodeSearchMethod < CN_SEARCH_MANHATTAN || chargingNodeSearchMethod > CN_SEARCH_ENERGY) {
+                throw cRuntimeError("Invalid chargingNodeSearchMethod selected.");
+            }
+            replacementMethod = par("replacementMethod");
+            weightedSumWeight = par("weightedSumWeight").doubleValue();
+            if (weightedSumWeight < 0 || weightedSumWeight > 1) {
+                throw cRuntimeError("Invalid weightedSumWeight %g, must be within 0..1", weightedSumWeight);
+            }
+            if (replacementMethod < HEURISTIC_LATEST_OPPOTUNITY || replacementMethod > HEURISTIC_BIOBJECTIVE) {
+                throw cRuntimeError("Invalid replacementMethod selected.");
+            }
+            evaluateAllHeuristics = par("evaluateAllHeuristics").boolValue();
+            if (evaluateAllHeuristics) {
+                for (double weight : cStringTokenizer(par("weightSweep").stringValue()).asDoubleVector()) {
+                    weightSweep.push_back(weight);
+                }
+                heuristicStatistics.resize(HEURISTIC_BIOBJECTIVE + weightSweep.size());
+                initHeuristicStatistics(heuristicStatistics[HEURISTIC_LATEST_OPPOTUNITY], "latestOpportunity");
+                initHeuristicStatistics(heuristicStatistics[HEURISTIC_SHORTEST_RETURN], "shortestReturn");
+                for (size_t i = 0; i < weightSweep.size(); i++) {
+                    if (weightSweep[i] < 0 || weightSweep[i] > 1) {
+                        throw cRuntimeError("Invalid weight %g in weightSweep, must be within 0..1", weightSweep[i]);
+                    }
+                    char name[32];
+                    snprintf(name, sizeof(name), "biObjective(%g)", weightSweep[i]);
+                    initHeuristicStatistics(heuristicStatistics[HEURISTIC_BIOBJECTIVE + i], name);
+                }
+            }
+            if (usePredictionTable && predictionTableVerifiedQuantiles.count(quantile) == 0) {
+                double deviation = UAVSoloEmpiricTable::getInstance().verify(par("predictionTableTolerance").doubleValue(), quantile);
+                if (deviation >= 0) {
+                    std::string error_msg = std::string("Prediction table deviates from the reference calculation by ") + std::to_string(deviation);
+                    throw cRuntimeError(error_msg.c_str());
+                }
+                predictionTableVerifiedQuantiles.insert(quantile);
+            }
             break;
         }
         case 1: {
@@ -83,6 +142,13 @@ void UAVNode::finish()
 
     if (utilizationFail && missionId >= 0) throw cRuntimeError("Nope!");
 
+    for (HeuristicStatistics& statistics : heuristicStatistics) {
+        if (statistics.commands.getCount() == 0) continue;
+        recordStatistic(&statistics.commands);
+        recordStatistic(&statistics.duration, "s");
+        recordStatistic(&statistics.returnEnergy, "mAh");
+    }
+
     MobileNode::finish();
 }
 
@@ -90,10 +156,11 @@ void UAVNode::handleMessage(cMessage *msg)
 {
     double stepSize = 0;
 
-    if (msg->isName("initIdle")) {
+    if (msg->getKind() == MSG_INIT_IDLE) {
         missionId = -2;
-        cees.clear();
-        CommandExecEngine *cee = new IdleCEE(this, new IdleCommand());
+        releaseQueuedCEEs();
+        CommandExecEngine *cee = ceePool.create<IdleCEE>(this, new IdleCommand());
+        cee->setCommandOwned();
         cee->setCommandId(-2);
         cee->setPartOfMission(false);
         cees.push_back(cee);
@@ -105,7 +172,7 @@ void UAVNode::handleMessage(cMessage *msg)
         msg = nullptr;
         return;
     }
-    else if (msg->isName("exchangeData")) {
+    else if (msg->getKind() == MSG_EXCHANGE_DATA) {
         EV_INFO << __func__ << "(): exchangeData message received" << endl;
 
         if (commandExecEngine->getCeeType() != CeeType::EXCHANGE) {
@@ -115,7 +182,8 @@ void UAVNode::handleMessage(cMessage *msg)
             receivedMission_valid = true;
             receivedMission_missionId = receivedMissionMsg->getMissionId();
             receivedMission_commandsRepeat = receivedMissionMsg->getMissionRepeat();
-            receivedMission_missionCommands = receivedMissionMsg->getMission();
+            receivedMission = receivedMissionMsg->getMission();
+            receivedMission_cursor = receivedMissionMsg->getMissionCursor();
             delete msg;
             msg = nullptr;
             return;
@@ -126,15 +194,15 @@ void UAVNode::handleMessage(cMessage *msg)
         MissionMsg * receivedMissionMsg = check_and_cast<MissionMsg *>(msg);
         missionId = receivedMissionMsg->getMissionId();
         commandsRepeat = receivedMissionMsg->getMissionRepeat();
-        CommandQueue missionCommands = receivedMissionMsg->getMission();
-        EV_INFO << __func__ << "(): Mission " << missionId << " exchange, clearing " << cees.size() << " cees, loading " << missionCommands.size() << endl;
+        EV_INFO << __func__ << "(): Mission " << missionId << " exchange, clearing " << cees.size() << " cees, loading from command "
+                << receivedMissionMsg->getMissionCursor() << endl;
         clearCommands();
-        loadCommands(missionCommands);
+        loadMission(receivedMissionMsg->getMission(), receivedMissionMsg->getMissionCursor(), commandsRepeat);
 
         // End ExchangeCEE, will trigger next command selection
         exchangeCEE->setCommandCompleted();
 
-        cMessage* ackMsg = new cMessage("exchangeAck");
+        cMessage* ackMsg = new cMessage("exchangeAck", MSG_EXCHANGE_ACK);
         EV_INFO << "Send exchangeAck to: " << exchangeCEE->getOtherNode()->getFullName() << endl;
         send(ackMsg, getOutputGateTo(exchangeCEE->getOtherNode()));
 
@@ -142,7 +210,7 @@ void UAVNode::handleMessage(cMessage *msg)
         msg = nullptr;
 
     }
-    else if (msg->isName("exchangeAck")) {
+    else if (msg->getKind() == MSG_EXCHANGE_ACK) {
         EV_INFO << __func__ << "(): exchangeAck message received" << endl;
 
         if (commandExecEngine->getCeeType() != CeeType::EXCHANGE) {
@@ -152,7 +220,7 @@ void UAVNode::handleMessage(cMessage *msg)
         ExchangeCEE *exchangeCEE = check_and_cast<ExchangeCEE *>(commandExecEngine);
 
         if (not exchangeCEE->isCommandCompleted()) {
-            ExchangeCompletedMsg* exchangeCompletedMsg = new ExchangeCompletedMsg("exchangeCompleted");
+            ExchangeCompletedMsg* exchangeCompletedMsg = new ExchangeCompletedMsg("exchangeCompleted", MSG_EXCHANGE_COMPLETED);
             exchangeCompletedMsg->setReplacedNodeIndex(this->getIndex());
             exchangeCompletedMsg->setReplacingNodeIndex(replacingNode->getIndex());
             EV_INFO << "Send exchange completed replacedNode: " << this->getFullName() << " replacingNode: " << replacingNode->getFullName() << endl;
@@ -168,6 +236,17 @@ void UAVNode::handleMessage(cMessage *msg)
         delete msg;
         msg = nullptr;
     }
+    else if (msg->getKind() == MSG_REPLACEMENT_ASSIGNED) {
+        ReplacementAssignedMsg *assignedMsg = check_and_cast<ReplacementAssignedMsg *>(msg);
+        replacingNode = check_and_cast<GenericNode *>(getParentModule()->getSubmodule("uav", assignedMsg->getReplacingNodeIndex()));
+        replacementX = assignedMsg->getX();
+        replacementY = assignedMsg->getY();
+        replacementZ = assignedMsg->getZ();
+        replacementTime = assignedMsg->getTimeOfReplacement();
+        EV_INFO << __func__ << "(): " << replacingNode->getFullName() << " replaces this node at " << replacementTime << endl;
+        delete msg;
+        msg = nullptr;
+    }
     else {
         MobileNode::handleMessage(msg);
         msg = nullptr;
@@ -178,16 +257,98 @@ void UAVNode::handleMessage(cMessage *msg)
     }
 }
 
+/**
+ * @return Index of the next mission command in the shared mission, i.e. of the first mission CEE in the queue, -1 if there is none
+ */
+int UAVNode::getMissionCursor() const
+{
+    for (auto it = cees.begin(); it != cees.end(); ++it) {
+        // detours carry the partOfMission flag of their leg, but their commands are not in the Mission
+        if ((*it)->isPartOfMission() && not (*it)->isCommandOwned()) {
+            return (mission != nullptr) ? mission->indexOf((*it)->extractCommand()) : -1;
+        }
+    }
+    return -1;
+}
+
+/**
+ * The state of the node for a warm start snapshot, the node shadow status is added by the MissionControl.
+ */
+Snapshot::NodeState UAVNode::getSnapshotState() const
+{
+    // value initialized, the padding bytes of the record are written to the file as well
+    Snapshot::NodeState state { };
+    state.index = getIndex();
+    state.x = getX();
+    state.y = getY();
+    state.z = getZ();
+    state.yaw = yaw;
+    state.capacity = battery.getCapacity();
+    state.remaining = std::max(battery.getRemaining(), 0.0f);
+    state.status = -1;
+    state.missionId = missionId;
+    state.missionCursor = (missionId >= 0) ? getMissionCursor() : -1;
+    state.missionRepeat = commandsRepeat;
+    state.rngDraws = rngDraws;
+
+    // the charging node of the current or a queued charge command
+    state.chargingNode = -1;
+    std::vector<CommandExecEngine*> engines(cees.begin(), cees.end());
+    engines.insert(engines.begin(), commandExecEngine);
+    for (auto it = engines.begin(); it != engines.end(); it++) {
+        if (*it != nullptr && (*it)->isCeeType(CeeType::CHARGE)) {
+            state.chargingNode = check_and_cast<ChargeCommand*>((*it)->extractCommand())->getChargingNode()->getIndex();
+            break;
+        }
+    }
+    return state;
+}
+
+/**
+ * Moves the node to the position of a snapshot and restores its battery and random stream.
+ * The random stream of the node is its own (see initializeRNG()) and only feeds its samples, so advancing it by the
+ * numbers the node had drawn when the snapshot was written puts it where it was at snapshot time. This needs the
+ * seed set and the network of the snapshot run; with another seed set the node keeps a fresh stream of this run.
+ * NED parameters like startX = uniform(...) are drawn from the physical RNGs and are not part of the stream.
+ * Commands are not restored, the MissionControl sends them afterwards.
+ */
+void UAVNode::restoreSnapshotState(const Snapshot::NodeState& state, uint32_t seedSet)
+{
+    Enter_Method_Silent();
+    x = state.x;
+    y = state.y;
+    z = state.z;
+    yaw = state.yaw;
+    positionTime = simTime();
+    battery = Battery(state.capacity, state.remaining);
+    if (seedSet != getRunSeedSet()) {
+        EV_WARN << __func__ << "(): Snapshot written with seed set " << seedSet << ", the random stream of seed set " << getRunSeedSet()
+                << " is used" << endl;
+    }
+    else if (rngDraws > state.rngDraws) {
+        EV_WARN << __func__ << "(): " << rngDraws << " numbers drawn before the restore, the snapshot has " << state.rngDraws << endl;
+    }
+    else {
+        for (; rngDraws < state.rngDraws; rngDraws++) {
+            rng->doubleRandNonz();
+        }
+    }
+    clearPredictionCache();
+    publishPosition();
+}
+
 void UAVNode::transferMissionDataTo(UAVNode* node)
 {
-    CommandQueue missionCommands = *extractCommands();
-    MissionMsg *exDataMsg = new MissionMsg("exchangeData");
-    exDataMsg->setMission(missionCommands);
+    // the first mission CEE in the queue is the cursor into the shared mission
+    int cursor = getMissionCursor();
+    MissionMsg *exDataMsg = new MissionMsg("exchangeData", MSG_EXCHANGE_DATA);
+    exDataMsg->setMission(mission);
+    exDataMsg->setMissionCursor(cursor);
     exDataMsg->setMissionRepeat(commandsRepeat);
     exDataMsg->setMissionId(missionId);
     cGate* gateToNode = getOutputGateTo(node);
     send(exDataMsg, gateToNode);
-    EV_INFO << __func__ << "(): " << missionCommands.size() << " commands extracted and sent to other node." << endl;
+    EV_INFO << __func__ << "(): mission continuing at command " << cursor << " sent to other node." << endl;
 }
 
 /**
@@ -198,8 +359,7 @@ void UAVNode::transferMissionDataTo(UAVNode* node)
 void UAVNode::selectNextCommand()
 {
     if (cees.size() == 0) {
-        std::string error_msg = "selectNextCommand(): " + std::string(this->getFullName()) + " has no commands in CEEs queue left.";
-        throw cRuntimeError(error_msg.c_str());
+        throw cRuntimeError("selectNextCommand(): %s has no commands in CEEs queue left.", getFullName());
     }
 
     CommandExecEngine *scheduledCEE = cees.front();
@@ -207,10 +367,8 @@ void UAVNode::selectNextCommand()
     scheduledCEE->initializeCEE();
 
     if (exchangeAfterCurrentCommand && not scheduledCEE->isCeeType(CeeType::EXCHANGE)) {
-        std::string error_msg = "selectNextCommand(): " + std::string(this->getFullName())
-                + " should have switched into Exchange CEE now. Another UAV is waiting...";
-//        throw cRuntimeError(error_msg.c_str());
-        EV_ERROR << __func__ << "():" << error_msg << endl;
+//        throw cRuntimeError("selectNextCommand(): %s should have switched into Exchange CEE now. Another UAV is waiting...", getFullName());
+        EV_ERROR << __func__ << "(): " << getFullName() << " should have switched into Exchange CEE now. Another UAV is waiting..." << endl;
     }
     else {
         exchangeAfterCurrentCommand = false;
@@ -252,11 +410,10 @@ void UAVNode::selectNextCommand()
         }
 
         if (replacingNode == nullptr && scheduledCEE->isReplacementNeeded()) {
-            std::string error_msg = "selectNextCommand(): replacingNode for " + std::string(this->getFullName())
-                    + " should be known by now (part of hack111). Battery critical (" + std::to_string(battery.getRemainingPercentage()) + "%)?";
-            throw cRuntimeError(error_msg.c_str());
+            throw cRuntimeError("selectNextCommand(): replacingNode for %s should be known by now (part of hack111). Battery critical (%f%%)?",
+                    getFullName(), battery.getRemainingPercentage());
             //TODO: For simtime analysis
-            //EV_ERROR << error_msg.c_str() << endl;
+            //EV_ERROR << ... << endl;
             //endSimulation();
         }
 
@@ -266,7 +423,8 @@ void UAVNode::selectNextCommand()
             exchangeCommand->setX(replacementX);
             exchangeCommand->setY(replacementY);
             exchangeCommand->setZ(replacementZ);
-            CommandExecEngine *exchangeCEE = new ExchangeCEE(this, exchangeCommand);
+            CommandExecEngine *exchangeCEE = ceePool.create<ExchangeCEE>(this, exchangeCommand);
+            exchangeCEE->setCommandOwned();
             exchangeCEE->setFromCoordinates(replacementX, replacementY, replacementZ);
             exchangeCEE->setToCoordinates(replacementX, replacementY, replacementZ);
             exchangeCEE->setPartOfMission(false);
@@ -275,8 +433,12 @@ void UAVNode::selectNextCommand()
         }
     }
 
-    // Activate next CEE
+    // Activate next CEE, the previous one is released unless it got reinjected
+    if (commandExecEngine != nullptr && std::find(cees.begin(), cees.end(), commandExecEngine) == cees.end()) {
+        releaseCEE(commandExecEngine);
+    }
     commandExecEngine = cees.front();
+    activeMission = mission;
     commandExecEngine->setFromCoordinates(getX(), getY(), getZ());
     commandExecEngine->initializeCEE();
     cees.pop_front();
@@ -362,7 +524,6 @@ void UAVNode::collectStatistics()
 /**
  * Initialize physical and logical state of the node based on the current CEE.
  * This method is normally called once at the beginning of the CEE execution life cycle.
- * Also update the visible label in the visualization to reflect the current command type of the UAV.
  */
 void UAVNode::initializeState()
 {
@@ -372,6 +533,20 @@ void UAVNode::initializeState()
     commandExecEngine->performEntryActions();
     commandExecEngine->setNodeParameters();
 
+    // the duration is only formatted if INFO logging is enabled
+    EV_INFO << "Consumption drawn for CEE: " << commandExecEngine->getConsumptionPerSecond() << "mAh/s * "
+            << (commandExecEngine->hasDeterminedDuration() ? std::to_string(commandExecEngine->getOverallDuration()) + "s" : std::string("...s")) << endl;
+}
+
+/**
+ * Update the visible labels to reflect the current command type and state of the UAV.
+ * The label strings are only built for graphical environments and only passed on if they changed.
+ */
+void UAVNode::refreshDisplay() const
+{
+    MobileNode::refreshDisplay();
+    if (not getEnvir()->isGUI() || commandExecEngine == nullptr || RealTimeScheduler::isBehind()) return;
+
     std::string text(getFullName());
     switch (commandExecEngine->getCeeType()) {
         case CeeType::WAYPOINT:
@@ -393,18 +568,39 @@ void UAVNode::initializeState()
             text += " ID";
             break;
         default:
-            throw cRuntimeError("initializeState(): CEE type not handled for label.");
+            throw cRuntimeError("refreshDisplay(): CEE type not handled for label.");
             break;
     }
-    labelNode->setText(text);
-    std::string duration = (commandExecEngine->hasDeterminedDuration()) ? std::to_string(commandExecEngine->getOverallDuration()) + "s" : "...s";
-    EV_INFO << "Consumption drawn for CEE: " << commandExecEngine->getConsumptionPerSecond() << "mAh/s * " << duration << endl;
+
+    //update sublabel with maneuver and battery info
+    std::ostringstream strs;
+    strs << std::setprecision(1) << std::fixed;
+    if (speed != 0) {
+        strs << speed << " m/s" << " | ";
+    }
+    strs << ((battery.getRemainingPercentage() < 10) ? "0" : "") << battery.getRemainingPercentage() << " %";
+    if (commandExecEngine->getConsumptionPerSecond() != 0) {
+        strs << " | " << (-1) * commandExecEngine->getConsumptionPerSecond() << " A";
+    }
+    std::string summary = strs.str();
+
+    if (text != displayedLabel) {
+        displayedLabel = text;
+#if defined(WITH_OSG) && defined(WITH_OSGEARTH)
+        labelNode->setText(text);
+#endif
+    }
+    if (summary != displayedSummary) {
+        displayedSummary = summary;
+#if defined(WITH_OSG) && defined(WITH_OSGEARTH)
+        sublabelNode->setText(summary);
+#endif
+    }
 }
 
 /*
  * Update physical and logical state of the node based on the current CEE.
  * This method is normally called at every simulation step of the CEE execution life cycle.
- * Also update the visible sublabel in the visualization to reflect the current state of the UAV.
  */
 void UAVNode::updateState()
 {
@@ -416,15 +612,16 @@ void UAVNode::updateState()
 
         missionId = receivedMission_missionId;
         commandsRepeat = receivedMission_commandsRepeat;
-        CommandQueue missionCommands = receivedMission_missionCommands;
-        EV_INFO << __func__ << "(): Mission " << missionId << " exchange, clearing " << cees.size() << " cees, loading " << missionCommands.size() << endl;
+        EV_INFO << __func__ << "(): Mission " << missionId << " exchange, clearing " << cees.size() << " cees, loading from command " << receivedMission_cursor
+                << endl;
         clearCommands();
-        loadCommands(missionCommands);
+        loadMission(receivedMission, receivedMission_cursor, commandsRepeat);
+        receivedMission = nullptr;
 
         // End ExchangeCEE, will trigger next command selection
         exchangeCEE->setCommandCompleted();
 
-        cMessage* ackMsg = new cMessage("exchangeAck");
+        cMessage* ackMsg = new cMessage("exchangeAck", MSG_EXCHANGE_ACK);
         EV_INFO << "Send exchangeAck to: " << exchangeCEE->getOtherNode()->getFullName() << endl;
         send(ackMsg, getOutputGateTo(exchangeCEE->getOtherNode()));
 
@@ -434,22 +631,6 @@ void UAVNode::updateState()
     //distance to move, based on simulation time passed since last update
     double stepSize = (simTime() - lastUpdate).dbl();
     commandExecEngine->updateState(stepSize);
-
-    //update sublabel with maneuver and battery info
-    std::ostringstream strs;
-    strs << std::setprecision(1) << std::fixed;
-    if (speed != 0) {
-        strs << speed << " m/s" << " | ";
-    }
-    strs << ((battery.getRemainingPercentage() < 10) ? "0" : "") << battery.getRemainingPercentage() << " %";
-    if (commandExecEngine->getConsumptionPerSecond() != 0) {
-        strs << " | " << (-1) * commandExecEngine->getConsumptionPerSecond() << " A";
-    }
-    //strs << " | ";
-    //(commandExecEngine->hasDeterminedDuration()) ? strs << commandExecEngine->getRemainingTime() : strs << "...";
-    //strs << " s left";
-    sublabelNode->setText(strs.str());
-    par("stateSummary").setStringValue(std::string(commandExecEngine->getCeeTypeString()) + " | " + strs.str());
 }
 
 /**
@@ -463,58 +644,88 @@ bool UAVNode::isCommandCompleted()
 }
 
 /**
- * Get the time in seconds till the end of current command
+ * Get the time in seconds till the end of current command.
+ * Commands without a determined end, e.g. charging or an exchange, are polled every timeStep, also in analyticMotion mode.
+ * When the timeStep is set to 0 a placeholder value (10 seconds) is returned for them.
  */
 double UAVNode::nextNeededUpdate()
 {
     if (commandExecEngine == nullptr) throw cRuntimeError("nextNeededUpdate(): Command Engine missing.");
     if (commandExecEngine->hasDeterminedDuration()) {
-        return commandExecEngine->getRemainingTime();
+        double remainingTime = commandExecEngine->getRemainingTime();
+        // without fixed time steps an event is needed when the battery runs empty
+        double consumption = commandExecEngine->getConsumptionPerSecond();
+        if (analyticMotion && consumption > 0 && not battery.isEmpty()) {
+            double secondsToEmpty = battery.getRemaining() / consumption;
+            if (secondsToEmpty > 0 && secondsToEmpty < remainingTime) return secondsToEmpty;
+        }
+        return remainingTime;
     }
     else {
-        //TODO unknown? this is just a first workaround!
-        return 10;
+        return timeStep ? timeStep : 10;
     }
 }
 
 /**
  * Load a queue of commands, generate cees out of these and store them as the cees to be executed by the node.
+ * Flights through buildings of the ObstacleMap get the WaypointCEEs of a detour over them in front.
  */
 void UAVNode::loadCommands(CommandQueue commands, bool isMission)
 {
+    clearPredictionCache();
     if (not cees.empty()) {
         EV_WARN << __func__ << "()" << " Replacing non-empty CEE queue." << endl;
-        cees.clear();
+        releaseQueuedCEEs();
     }
 
+    // position the node will be at when starting the next command
+    double fromX = getX(), fromY = getY(), fromZ = getZ();
+    CommandExecEngine* detour[ObstacleMap::MAX_DETOUR_WAYPOINTS];
     for (u_int index = 0; index < commands.size(); ++index) {
         Command *command = commands.at(index);
         CommandExecEngine *cee = nullptr;
 
         if (WaypointCommand *cmd = dynamic_cast<WaypointCommand *>(command)) {
-            cee = new WaypointCEE(this, cmd);
+            // the approach from the current position is not repeated
+            bool repeatedLeg = isMission && (index > 0 || not commandsRepeat);
+            int count = createDetourCEEs(fromX, fromY, fromZ, cmd->getX(), cmd->getY(), cmd->getZ(), repeatedLeg, detour);
+            for (int i = 0; i < count; i++) {
+                detour[i]->setCommandId(index);
+                cees.push_back(detour[i]);
+            }
+            cee = ceePool.create<WaypointCEE>(this, cmd);
+            fromX = cmd->getX();
+            fromY = cmd->getY();
+            fromZ = cmd->getZ();
         }
         else if (TakeoffCommand *cmd = dynamic_cast<TakeoffCommand *>(command)) {
-            cee = new TakeoffCEE(this, cmd);
+            cee = ceePool.create<TakeoffCEE>(this, cmd);
+            fromZ = cmd->getZ();
         }
         else if (HoldPositionCommand *cmd = dynamic_cast<HoldPositionCommand *>(command)) {
             // only if HoldPositionCommand is first command of mission and UAVNode is not already there
             if (isMission && index == 0 && not cmpCoord(*cmd, getX(), getY(), getZ())) {
+                int count = createDetourCEEs(fromX, fromY, fromZ, cmd->getX(), cmd->getY(), cmd->getZ(), false, detour);
+                cees.insert(cees.end(), detour, detour + count);
                 WaypointCommand* extraCommand = new WaypointCommand(cmd->getX(), cmd->getY(), cmd->getZ());
-                CommandExecEngine* extraCee = new WaypointCEE(this, extraCommand);
+                CommandExecEngine* extraCee = ceePool.create<WaypointCEE>(this, extraCommand);
+                extraCee->setCommandOwned();
                 extraCee->setPartOfMission(false);
                 cees.push_back(extraCee);
             }
-            cee = new HoldPositionCEE(this, cmd);
+            cee = ceePool.create<HoldPositionCEE>(this, cmd);
+            fromX = cmd->getX();
+            fromY = cmd->getY();
+            fromZ = cmd->getZ();
         }
         else if (ChargeCommand *cmd = dynamic_cast<ChargeCommand *>(command)) {
-            cee = new ChargeCEE(this, cmd);
+            cee = ceePool.create<ChargeCEE>(this, cmd);
         }
         else if (ExchangeCommand *cmd = dynamic_cast<ExchangeCommand *>(command)) {
-            cee = new ExchangeCEE(this, cmd);
+            cee = ceePool.create<ExchangeCEE>(this, cmd);
         }
         else if (IdleCommand *cmd = dynamic_cast<IdleCommand *>(command)) {
-            cee = new IdleCEE(this, cmd);
+            cee = ceePool.create<IdleCEE>(this, cmd);
         }
         else {
             throw cRuntimeError("UAVNode::loadCommands(): invalid cast or unexpected command type.");
@@ -523,9 +734,84 @@ void UAVNode::loadCommands(CommandQueue commands, bool isMission)
         cee->setCommandId(index);
         cees.push_back(cee);
     }
+
+    // repeated missions also fly from the last back to the first position
+    if (isMission && commandsRepeat && not cees.empty()) {
+        CommandExecEngine* first = nullptr;
+        for (CommandExecEngine* cee : cees) {
+            if (cee->isCeeType(CeeType::WAYPOINT) || cee->isCeeType(CeeType::HOLDPOSITION)) {
+                first = cee;
+                break;
+            }
+        }
+        if (first != nullptr) {
+            int count = createDetourCEEs(fromX, fromY, fromZ, first->getX1(), first->getY1(), first->getZ1(), true, detour);
+            for (int i = 0; i < count; i++) {
+                detour[i]->setCommandId(first->getCommandId());
+                cees.push_back(detour[i]);
+            }
+        }
+    }
     EV_INFO << __func__ << "(): " << commands.size() << " commands stored in node memory." << endl;
 }
 
+/**
+ * Creates the WaypointCEEs of the detour over the buildings from the given coordinate to the given coordinate,
+ * without the final flight to the destination.
+ *
+ * @param detour Output array of ObstacleMap::MAX_DETOUR_WAYPOINTS CEEs
+ * @return Number of created CEEs, 0 if the direct flight is clear
+ */
+int UAVNode::createDetourCEEs(double fromX, double fromY, double fromZ, double toX, double toY, double toZ, bool partOfMission,
+        CommandExecEngine** detour)
+{
+    if (obstacleMap == nullptr) return 0;
+    double waypoints[3 * ObstacleMap::MAX_DETOUR_WAYPOINTS];
+    int count = obstacleMap->getDetour(fromX, fromY, fromZ, toX, toY, toZ, waypoints);
+    for (int i = 0; i < count; i++) {
+        WaypointCommand* detourCommand = new WaypointCommand(waypoints[3 * i], waypoints[3 * i + 1], waypoints[3 * i + 2]);
+        detour[i] = ceePool.create<WaypointCEE>(this, detourCommand);
+        detour[i]->setCommandOwned();
+        detour[i]->setFromCoordinates(fromX, fromY, fromZ);
+        detour[i]->setPartOfMission(partOfMission);
+        fromX = waypoints[3 * i];
+        fromY = waypoints[3 * i + 1];
+        fromZ = waypoints[3 * i + 2];
+    }
+    if (count > 0) {
+        EV_DEBUG << __func__ << "(): Flight to (" << toX << ", " << toY << ", " << toZ << ") detoured over the buildings at "
+                        << waypoints[3 * count - 1] << "m" << endl;
+    }
+    return count;
+}
+
+void UAVNode::clearCommands()
+{
+    clearPredictionCache();
+    releaseQueuedCEEs();
+    GenericNode::clearCommands();
+}
+
+/**
+ * Returns a CEE to the pool, it must not be referenced anymore.
+ */
+void UAVNode::releaseCEE(CommandExecEngine* cee)
+{
+    predictionCache.erase(cee);
+    ceePool.release(cee);
+}
+
+/**
+ * Releases all CEEs of the queue except the active one and clears the queue.
+ */
+void UAVNode::releaseQueuedCEEs()
+{
+    for (auto it = cees.begin(); it != cees.end(); ++it) {
+        if (*it != commandExecEngine) releaseCEE(*it);
+    }
+    cees.clear();
+}
+
 /**
  * Calculate the overall flight time of a CommandQueue.
  * This method will ignore the Repeat property.
@@ -550,25 +836,84 @@ double UAVNode::estimateCommandsDuration()
     return duration;
 }
 
+/**
+ * Calculate the overall flight time of a CommandQueue as if it was loaded as a mission.
+ * Neither the CEEs of the node nor the node itself are altered, no random numbers are drawn.
+ * This method will ignore the Repeat property.
+ *
+ * @return Time needed for the commands in the command queue
+ */
+double UAVNode::estimateDuration(const CommandQueue& commands)
+{
+    double duration = 0;
+    double fromX = this->getX();
+    double fromY = this->getY();
+    double fromZ = this->getZ();
+    auto directDuration = [this](double fromX, double fromY, double fromZ, double toX, double toY, double toZ) {
+        double dx = toX - fromX;
+        double dy = toY - fromY;
+        double dz = toZ - fromZ;
+        double distance = sqrt(dx * dx + dy * dy + dz * dz);
+        if (abs(dx) < 1.e-10) dx = 0;
+        if (abs(dy) < 1.e-10) dy = 0;
+        if (abs(dz) < 1.e-10) dz = 0;
+        double speed = getSpeed(atan2(dz, sqrt(dx * dx + dy * dy)) / M_PI * 180);
+        if (distance < 1.e-10) distance = 0;
+        return distance / speed;
+    };
+    auto flightDuration = [this, &directDuration](double fromX, double fromY, double fromZ, double toX, double toY, double toZ) {
+        return sumFlightLegs(fromX, fromY, fromZ, toX, toY, toZ, directDuration);
+    };
+
+    for (u_int index = 0; index < commands.size(); ++index) {
+        Command *command = commands.at(index);
+        if (WaypointCommand *cmd = dynamic_cast<WaypointCommand *>(command)) {
+            duration += flightDuration(fromX, fromY, fromZ, cmd->getX(), cmd->getY(), cmd->getZ());
+            fromX = cmd->getX();
+            fromY = cmd->getY();
+            fromZ = cmd->getZ();
+        }
+        else if (TakeoffCommand *cmd = dynamic_cast<TakeoffCommand *>(command)) {
+            double speed = getSpeed((cmd->getZ() > fromZ) ? 90 : -90);
+            duration += fabs(cmd->getZ() - fromZ) / speed;
+            fromX = this->getX();
+            fromY = this->getY();
+            fromZ = cmd->getZ();
+        }
+        else if (HoldPositionCommand *cmd = dynamic_cast<HoldPositionCommand *>(command)) {
+            // loadCommands() inserts a flight to the position if needed
+            if (index == 0 && not cmpCoord(*cmd, getX(), getY(), getZ())) {
+                duration += flightDuration(fromX, fromY, fromZ, cmd->getX(), cmd->getY(), cmd->getZ());
+            }
+            duration += cmd->getHoldSeconds();
+            fromX = cmd->getX();
+            fromY = cmd->getY();
+            fromZ = cmd->getZ();
+        }
+        else {
+            throw cRuntimeError("UAVNode::estimateDuration(): command without determined duration.");
+        }
+    }
+    return duration;
+}
+
 #define IDX_FUTURE_CMDS 0
 #define IDX_CMD_ENERGY 1
 #define IDX_RETURN_ENERGY 2
 #define IDX_CMD_DURATION 3
-
-#define HEURISTIC_LATEST_OPPOTUNITY 0
-#define HEURISTIC_SHORTEST_RETURN 1
-#define HEURISTIC_BIOBJECTIVE 2
+#define PREDICTION_COLUMNS 4
 
 /**
  * Iterates over all future CEEs and predicts their consumptions.
  * The consumption plus the needed energy to go back to a charging station are then compared against the remaining battery capacity.
  * Result of the calculation is the feasible amount of commands and the place of last possible replacement.
  *
- * @return ReplacementData for the last point of replacement
- * @return 'nullptr' if a command that can't be estimated (CHARGE or EXCHANGE) is enqueued before depletion
+ * @param replacementData Receives the data for the last point of replacement
+ * @return 'false' if a command that can't be estimated (CHARGE or EXCHANGE) is enqueued before depletion
  */
-ReplacementData* UAVNode::endOfOperation()
+bool UAVNode::endOfOperation(ReplacementData& replacementData)
 {
+    PROFILE_MODULE_SCOPE(profiling, "UAVNode::endOfOperation");
     float energySum = 0;
     int nextCommands = 0;
     float nextCommandsDuration = 0;
@@ -576,54 +921,51 @@ ReplacementData* UAVNode::endOfOperation()
 
     if (cees.empty()) {
         EV_WARN << "endOfOperation(): No CEEs scheduled for node. No end of operation predictable..." << endl;
-        return nullptr;
+        return false;
     }
 
-    // omnet.ini NED parameters
-    int replacementMethod = par("replacementMethod");
-    float weightedSumWeight = par("weightedSumWeight").doubleValue();
-    ASSERT(replacementMethod >= 0 && replacementMethod <= 2);
-    ASSERT(weightedSumWeight >= 0 && weightedSumWeight <= 1);
-
     // Iterates through all feasible future commands and build table of predictions
 
     /**
-     * vector of vectors of {0: number of future commands,
-     *                       1: predicted commands energy,
-     *                       2: predicted return energy,
-     *                       3: predicted commands duration}
-     * element 0 initialized with 0s
+     * rows of {0: number of future commands,
+     *          1: predicted commands energy,
+     *          2: predicted return energy,
+     *          3: predicted commands duration}
+     * in one buffer, which keeps its capacity between the calls
      */
-    std::vector<std::vector<float>> nextCEEsMatrix;
-    //nextCEEsMatrix.push_back(std::vector<float> { 0.0, 0.0, FLT_MAX, 0.0 });
+    predictionRows.clear();
 
     double tempFromX = x;
     double tempFromY = y;
     double tempFromZ = z;
 
+    if (predictionCacheRevision != chargingNodeIndex->getRevision()) {
+        clearPredictionCache();
+        predictionCacheRevision = chargingNodeIndex->getRevision();
+    }
+
     // Preliminary max feasible and energy prediction
     while (not maxCommandsFeasibleReached) {
         CommandExecEngine *nextCEE = cees.at(nextCommands % cees.size());
 
-        nextCEE->setFromCoordinates(tempFromX, tempFromY, tempFromZ);
+        const CEEPrediction& prediction = predictCEE(nextCEE, tempFromX, tempFromY, tempFromZ);
         tempFromX = nextCEE->getX1();
         tempFromY = nextCEE->getY1();
         tempFromZ = nextCEE->getZ1();
 
-        float energyForNextCEE = energyForCEE(nextCEE);
-        float energyToCNAfterCEE = energyToNearestCN(nextCEE->getX1(), nextCEE->getY1(), nextCEE->getZ1());
+        float energyForNextCEE = prediction.energy;
+        float energyToCNAfterCEE = prediction.returnEnergy;
 
         //Special case: No end foreseeable
-        if (energyForNextCEE == FLT_MAX) return nullptr;
+        if (energyForNextCEE == FLT_MAX) return false;
 
         // Check if next command still feasible
         if (energySum + energyForNextCEE + energyToCNAfterCEE < battery.getRemaining()) {
             // prepare next while loop execution
             nextCommands++;
             energySum += energyForNextCEE;
-            nextCommandsDuration += nextCEE->getOverallDuration();
-            nextCEEsMatrix.push_back(std::vector<float> { (float) nextCommands, energySum, energyToCNAfterCEE, nextCommandsDuration });
-            //EV_INFO << __func__ << "(): Added to list of predictions: matrix entry " << nextCEEsMatrix.size()-1 << ", command " << nextCEE->getCeeTypeString() << nextCommands << ", energy for this CEE " << energyForNextCEE << ", energyToCNAfter " << energyToCNAfterCEE << ", nextCommandsDuration " << nextCommandsDuration << endl;
+            nextCommandsDuration += prediction.duration;
+            predictionRows.insert(predictionRows.end(), { (float) nextCommands, energySum, energyToCNAfterCEE, nextCommandsDuration });
         }
         else {
             // next command not feasible
@@ -633,7 +975,7 @@ ReplacementData* UAVNode::endOfOperation()
     // At least one command has to be feasible
     if (nextCommands == 0) {
         EV_WARN << "endOfOperation(): 0 commands feasible." << endl;
-        return nullptr;
+        return false;
     }
     else {
         EV_INFO << __func__ << "(): " << nextCommands << " commands feasible at most." << endl;
@@ -643,80 +985,73 @@ ReplacementData* UAVNode::endOfOperation()
      * Replacement Heuristics
      */
 
-    // Replacement planning
-    ReplacementData *result = new ReplacementData();
-    result->nodeToReplace = this;
-    CommandExecEngine *lastCEEofMission;
-
-    ASSERT((int) nextCEEsMatrix.back().at(IDX_FUTURE_CMDS) == nextCommands);
+    ASSERT((int) predictionRows[(nextCommands - 1) * PREDICTION_COLUMNS + IDX_FUTURE_CMDS] == nextCommands);
     int maxCommandsFeasible = nextCommands;
 
-    switch (replacementMethod) {
-        case HEURISTIC_LATEST_OPPOTUNITY: {
-            lastCEEofMission = cees.at((maxCommandsFeasible - 1) % cees.size());
+    // Single pass over all rows for all heuristics, the bi-objective sweep only with evaluateAllHeuristics
+    int latestOpportunityRow = maxCommandsFeasible - 1;
+    int shortestReturnRow = 0;
+    int biObjectiveRow = 0;
+    float bestWeightedSum = (-1) * FLT_MAX;
+    size_t sweepSize = evaluateAllHeuristics ? weightSweep.size() : 0;
+    sweepRows.assign(sweepSize, 0);
+    sweepWeightedSums.assign(sweepSize, (-1) * FLT_MAX);
+    float missing = battery.getMissing();
+    for (int row = 0; row < maxCommandsFeasible; row++) {
+        const float* prediction = &predictionRows[row * PREDICTION_COLUMNS];
+        float energyCommandsTillHere = missing + prediction[IDX_CMD_ENERGY];
+        float energyReturnFromHere = prediction[IDX_RETURN_ENERGY];
+
+        // Search shortest return
+        if (energyReturnFromHere <= predictionRows[shortestReturnRow * PREDICTION_COLUMNS + IDX_RETURN_ENERGY]) {
+            shortestReturnRow = row;
+        }
+
+        // Search bi-objective maximum
+        float weightedSum = weightedSumWeight * energyCommandsTillHere - (1 - weightedSumWeight) * energyReturnFromHere;
+        if (weightedSum >= bestWeightedSum) {
+            bestWeightedSum = weightedSum;
+            biObjectiveRow = row;
+        }
+        for (size_t i = 0; i < sweepSize; i++) {
+            float sweepSum = weightSweep[i] * energyCommandsTillHere - (1 - weightSweep[i]) * energyReturnFromHere;
+            if (sweepSum >= sweepWeightedSums[i]) {
+                sweepWeightedSums[i] = sweepSum;
+                sweepRows[i] = row;
+            }
+        }
+    }
 
-            float latestOpportunityDuration = nextCEEsMatrix.back().at(IDX_CMD_DURATION);
-            result->timeOfReplacement = simTime() + latestOpportunityDuration;
+    if (evaluateAllHeuristics) {
+        recordHeuristicDecision(heuristicStatistics[HEURISTIC_LATEST_OPPOTUNITY], latestOpportunityRow);
+        recordHeuristicDecision(heuristicStatistics[HEURISTIC_SHORTEST_RETURN], shortestReturnRow);
+        for (size_t i = 0; i < sweepSize; i++) {
+            recordHeuristicDecision(heuristicStatistics[HEURISTIC_BIOBJECTIVE + i], sweepRows[i]);
+        }
+    }
 
+    // Replacement planning
+    int shortestReturnPathMissionCommands = shortestReturnRow + 1;
+    int replacementRow;
+    switch (replacementMethod) {
+        case HEURISTIC_LATEST_OPPOTUNITY: {
+            replacementRow = latestOpportunityRow;
             EV_INFO << __func__ << "(): latest opportunity heuristic: " << maxCommandsFeasible << " commands feasible." << endl;
             break;
         }
 
         case HEURISTIC_SHORTEST_RETURN: {
-            float shortestReturnPathReturnEnergy = FLT_MAX;
-            int shortestReturnPathMissionCommands = 0;
-            float shortestReturnPathMissionDuration = 0;
-
-            for (auto it = nextCEEsMatrix.cbegin(); it != nextCEEsMatrix.cend(); ++it) {
-                if (it->at(IDX_RETURN_ENERGY) <= shortestReturnPathReturnEnergy) {
-                    shortestReturnPathReturnEnergy = it->at(IDX_RETURN_ENERGY);
-                    shortestReturnPathMissionCommands = it->at(IDX_FUTURE_CMDS);
-                    shortestReturnPathMissionDuration = it->at(IDX_CMD_DURATION);
-                }
-            }
-
-            lastCEEofMission = cees.at((shortestReturnPathMissionCommands - 1) % cees.size());
-            result->timeOfReplacement = simTime() + shortestReturnPathMissionDuration;
-
+            replacementRow = shortestReturnRow;
             EV_INFO << __func__ << "(): shortest return heuristic: " << shortestReturnPathMissionCommands << " commands feasible." << endl;
             break;
         }
 
         case HEURISTIC_BIOBJECTIVE: {
-            float bestWeightedSum = (-1) * FLT_MAX;
-            int bestPathMissionCommands = 0;
-            float bestPathMissionDuration = 0;
-
-            //For comparison with shortest return heuristic
-            float shortestReturnPathReturnEnergy = FLT_MAX;
-            int shortestReturnPathMissionCommands = 0;
-
-            for (auto it = nextCEEsMatrix.cbegin(); it != nextCEEsMatrix.cend(); ++it) {
-
-                float energyCommandsTillHere = battery.getMissing() + it->at(IDX_CMD_ENERGY);
-                float energyReturnFromHere = it->at(IDX_RETURN_ENERGY);
-                float weightedSum = weightedSumWeight * energyCommandsTillHere - (1 - weightedSumWeight) * energyReturnFromHere;
-
-                // Search bi-objective maximum
-                if (weightedSum >= bestWeightedSum) {
-                    bestWeightedSum = weightedSum;
-                    bestPathMissionCommands = it->at(IDX_FUTURE_CMDS);
-                    bestPathMissionDuration = it->at(IDX_CMD_DURATION);
-                }
-
-                // Search shortest return
-                if (it->at(IDX_RETURN_ENERGY) <= shortestReturnPathReturnEnergy) {
-                    shortestReturnPathReturnEnergy = it->at(IDX_RETURN_ENERGY);
-                    shortestReturnPathMissionCommands = it->at(IDX_FUTURE_CMDS);
-                }
-            }
-            ASSERT(bestPathMissionCommands != 0);
+            replacementRow = biObjectiveRow;
+            int bestPathMissionCommands = biObjectiveRow + 1;
             ASSERT(bestPathMissionCommands >= shortestReturnPathMissionCommands);
             ASSERT(bestPathMissionCommands <= maxCommandsFeasible);
 
-            lastCEEofMission = cees.at((bestPathMissionCommands - 1) % cees.size());
-            result->timeOfReplacement = simTime() + bestPathMissionDuration;
-
             EV_INFO << __func__ << "(): bi-objective tradeoff heuristic: " << bestPathMissionCommands << " commands feasible ";
             if (shortestReturnPathMissionCommands == maxCommandsFeasible) {
                 EV_INFO << "(no range)" << endl;
@@ -733,10 +1068,47 @@ ReplacementData* UAVNode::endOfOperation()
             throw omnetpp::cRuntimeError("Invalid replacementMethod selected.");
     }
 
-    result->x = lastCEEofMission->getX1();
-    result->y = lastCEEofMission->getY1();
-    result->z = lastCEEofMission->getZ1();
-    return result;
+    const float* replacement = &predictionRows[replacementRow * PREDICTION_COLUMNS];
+    CommandExecEngine *lastCEEofMission = cees.at(((int) replacement[IDX_FUTURE_CMDS] - 1) % cees.size());
+    replacementData.nodeToReplace = this;
+    replacementData.replacingNode = nullptr;
+    replacementData.timeOfReplacement = simTime() + replacement[IDX_CMD_DURATION];
+    replacementData.x = lastCEEofMission->getX1();
+    replacementData.y = lastCEEofMission->getY1();
+    replacementData.z = lastCEEofMission->getZ1();
+    return true;
+}
+
+void UAVNode::addMemoryUsage(MemoryUsage& usage) const
+{
+    MobileNode::addMemoryUsage(usage);
+    std::string prefix = std::string(getName()) + ".";
+    usage.add(prefix + "module", sizeof(UAVNode), 1);
+    usage.add(prefix + "ceePool", ceePool.getAllocatedBytes(), ceePool.getUsed() + ceePool.getFree());
+    usage.add(prefix + "predictionCache", MemoryUsage::ofNodes(predictionCache), predictionCache.size());
+    usage.add(prefix + "predictionRows", MemoryUsage::ofVector(predictionRows) + MemoryUsage::ofVector(sweepRows) + MemoryUsage::ofVector(sweepWeightedSums),
+            predictionRows.size() / PREDICTION_COLUMNS);
+}
+
+/**
+ * Names the statistics of one heuristic, e.g. heuristic.shortestReturn.duration
+ */
+void UAVNode::initHeuristicStatistics(HeuristicStatistics& statistics, const std::string& name)
+{
+    statistics.commands.setName(("heuristic." + name + ".commands").c_str());
+    statistics.duration.setName(("heuristic." + name + ".duration").c_str());
+    statistics.returnEnergy.setName(("heuristic." + name + ".returnEnergy").c_str());
+}
+
+/**
+ * Adds the replacement a heuristic would plan at the given row of the predictions to its statistics.
+ */
+void UAVNode::recordHeuristicDecision(HeuristicStatistics& statistics, int row)
+{
+    const float* prediction = &predictionRows[row * PREDICTION_COLUMNS];
+    statistics.commands.collect(prediction[IDX_FUTURE_CMDS]);
+    statistics.duration.collect(prediction[IDX_CMD_DURATION]);
+    statistics.returnEnergy.collect(prediction[IDX_RETURN_ENERGY]);
 }
 
 /*
@@ -748,11 +1120,38 @@ ReplacementData* UAVNode::endOfOperation()
 float UAVNode::energyToNearestCN(double fromX, double fromY, double fromZ)
 {
 // Get consumption for flight to nearest charging node
-    ChargingNode *cn = findNearestCN(fromX, fromY, fromZ);
+    ChargingNode *cn = selectChargingNode(fromX, fromY, fromZ);
     if (nullptr == cn) throw omnetpp::cRuntimeError("No charging station available!");
     return estimateEnergy(fromX, fromY, fromZ, cn->getX(), cn->getY(), cn->getZ());
 }
 
+/**
+ * Select the charging node to return to according to the chargingNodeSearchMethod parameter.
+ * Manhattan and euclidean distance use the ChargingNodeIndex, the energy-aware method
+ * predicts the flight energy to every registered charging node and selects the minimum.
+ *
+ * @param The origin coordinates
+ * @return The selected charging node, nullptr if there is none
+ */
+ChargingNode* UAVNode::selectChargingNode(double fromX, double fromY, double fromZ)
+{
+    if (chargingNodeSearchMethod != CN_SEARCH_ENERGY) {
+        int metric = (chargingNodeSearchMethod == CN_SEARCH_EUCLIDEAN) ? ChargingNodeIndex::EUCLIDEAN : ChargingNodeIndex::MANHATTAN;
+        return findNearestCN(fromX, fromY, fromZ, metric);
+    }
+
+    ChargingNode *cheapest = nullptr;
+    float minEnergy = FLT_MAX;
+    for (ChargingNode *cn : chargingNodeIndex->getChargingNodes()) {
+        float energy = estimateEnergy(fromX, fromY, fromZ, cn->getX(), cn->getY(), cn->getZ());
+        if (energy < minEnergy) {
+            minEnergy = energy;
+            cheapest = cn;
+        }
+    }
+    return cheapest;
+}
+
 /**
  * Calculate the electrical consumption for one hover / hold position maneuver (no movement).
  * The calculation is based on predetermined statistical values and a derived gaussian normal distribution.
@@ -763,23 +1162,24 @@ float UAVNode::energyToNearestCN(double fromX, double fromY, double fromZ)
  */
 float UAVNode::getHoverConsumption(float duration, int fromMethod)
 {
+    PROFILE_MODULE_SCOPE(profiling, "UAVNode::getHoverConsumption");
     if (duration == 0) return 0;
 
     float mean = HOVER_MEAN * duration / 3600;
-    float var = getVarianceFromHFormula(-1, duration);
+    float var = (usePredictionTable) ? UAVSoloEmpiricTable::getInstance().getVariance(-1, duration) : getVarianceFromHFormula(-1, duration);
     float stddev = sqrt(var);
 
     float energy = 0;
 
     if (fromMethod == 0) {
-        cModule *network = cSimulation::getActiveSimulation()->getSystemModule();
-        do {
-            energy = omnetpp::normal(network->getRNG(0), mean, stddev);
-        } while (abs(energy - mean) > 3 * stddev || energy < mean / 3);
+        energy = sampleTruncatedNormal(mean, stddev);
     }
     else if (fromMethod == 1) {
         energy = mean;
     }
+    else if (usePredictionTable) {
+        energy = mean + quantileZ * stddev;
+    }
     else {
         energy = boost::math::quantile(boost::math::normal(mean, stddev), quantile);
     }
@@ -799,6 +1199,7 @@ float UAVNode::getHoverConsumption(float duration, int fromMethod)
  */
 float UAVNode::getMovementConsumption(float angle, float duration, int fromMethod)
 {
+    PROFILE_MODULE_SCOPE(profiling, "UAVNode::getMovementConsumption");
     if (duration < 0.001) return 0;
 
     float mean = 0;
@@ -807,36 +1208,50 @@ float UAVNode::getMovementConsumption(float angle, float duration, int fromMetho
 
     ASSERT(angle >= -90.0 && angle <= +90.0);
 
-    for (u_int idx = 1; idx < NUM_ANGLES; idx++) {
-        float angle0 = ANGLE2POWER[idx - 1][0];
-        float angle1 = ANGLE2POWER[idx][0];
+    if (usePredictionTable) {
+        const UAVSoloEmpiricTable& table = UAVSoloEmpiricTable::getInstance();
+        u_int idx = table.getSegment(angle);
+
+        mean = table.getMeanPower(idx, angle) * duration / 3600;
+
+        float var0 = table.getVariance(idx - 1, duration);
+        float var1 = table.getVariance(idx, duration);
 
-        if ((angle0 <= angle && angle <= angle1)) {
-            float mean0 = ANGLE2POWER[idx - 1][1];
-            float mean1 = ANGLE2POWER[idx][1];
+        float var = var0 + (var1 - var0) * table.getAngleSlope(idx) * (angle - table.getAngle(idx - 1));
+        stddev = sqrt(var);
+    }
+    else {
+        for (u_int idx = 1; idx < NUM_ANGLES; idx++) {
+            float angle0 = ANGLE2POWER[idx - 1][0];
+            float angle1 = ANGLE2POWER[idx][0];
 
-            mean = mean0 + (mean1 - mean0) / (angle1 - angle0) * (angle - angle0);
-            mean = mean * duration / 3600;
+            if ((angle0 <= angle && angle <= angle1)) {
+                float mean0 = ANGLE2POWER[idx - 1][1];
+                float mean1 = ANGLE2POWER[idx][1];
 
-            float var0 = getVarianceFromHFormula(idx - 1, duration);
-            float var1 = getVarianceFromHFormula(idx, duration);
+                mean = mean0 + (mean1 - mean0) / (angle1 - angle0) * (angle - angle0);
+                mean = mean * duration / 3600;
 
-            float var = var0 + (var1 - var0) / (angle1 - angle0) * (angle - angle0);
-            stddev = sqrt(var);
-            break;
+                float var0 = getVarianceFromHFormula(idx - 1, duration);
+                float var1 = getVarianceFromHFormula(idx, duration);
+
+                float var = var0 + (var1 - var0) / (angle1 - angle0) * (angle - angle0);
+                stddev = sqrt(var);
+                break;
+            }
         }
     }
     ASSERT(mean != 0 && stddev != 0);
 
     if (fromMethod == 0) {
-        cModule *network = cSimulation::getActiveSimulation()->getSystemModule();
-        do {
-            energy = omnetpp::normal(network->getRNG(0), mean, stddev);
-        } while (abs(energy - mean) > 3 * stddev || energy < mean / 3);
+        energy = sampleTruncatedNormal(mean, stddev);
     }
     else if (fromMethod == 1) {
         energy = mean;
     }
+    else if (usePredictionTable) {
+        energy = mean + quantileZ * stddev;
+    }
     else {
         energy = boost::math::quantile(boost::math::normal(mean, stddev), quantile);
     }
@@ -859,32 +1274,41 @@ float UAVNode::getSpeed(float angle, int fromMethod)
 
     ASSERT(angle >= -90.0 && angle <= +90.0);
 
-    for (u_int idx = 1; idx < NUM_ANGLES; idx++) {
-        float angle0 = ANGLE2SPEED[idx - 1][0];
-        float angle1 = ANGLE2SPEED[idx][0];
-
-        if ((angle0 <= angle && angle <= angle1)) {
-            float mean0 = ANGLE2SPEED[idx - 1][1];
-            float mean1 = ANGLE2SPEED[idx][1];
-            float stddev0 = ANGLE2SPEED[idx - 1][2];
-            float stddev1 = ANGLE2SPEED[idx][2];
+    if (usePredictionTable) {
+        const UAVSoloEmpiricTable& table = UAVSoloEmpiricTable::getInstance();
+        u_int idx = table.getSegment(angle);
 
-            mean = mean0 + (mean1 - mean0) / (angle1 - angle0) * (angle - angle0);
-            stddev = abs(stddev0 + (stddev1 - stddev0) / (angle1 - angle0) * (angle - angle0)) / 10;
-            break;
+        mean = table.getMeanSpeed(idx, angle);
+        stddev = abs(table.getSpeedStddev(idx, angle)) / 10;
+    }
+    else {
+        for (u_int idx = 1; idx < NUM_ANGLES; idx++) {
+            float angle0 = ANGLE2SPEED[idx - 1][0];
+            float angle1 = ANGLE2SPEED[idx][0];
+
+            if ((angle0 <= angle && angle <= angle1)) {
+                float mean0 = ANGLE2SPEED[idx - 1][1];
+                float mean1 = ANGLE2SPEED[idx][1];
+                float stddev0 = ANGLE2SPEED[idx - 1][2];
+                float stddev1 = ANGLE2SPEED[idx][2];
+
+                mean = mean0 + (mean1 - mean0) / (angle1 - angle0) * (angle - angle0);
+                stddev = abs(stddev0 + (stddev1 - stddev0) / (angle1 - angle0) * (angle - angle0)) / 10;
+                break;
+            }
         }
     }
     ASSERT(mean != 0 && stddev != 0);
 
     if (fromMethod == 0) {
-        cModule *network = cSimulation::getActiveSimulation()->getSystemModule();
-        do {
-            speed = omnetpp::normal(network->getRNG(0), mean, stddev);
-        } while (abs(speed - mean) > 3 * stddev || speed < mean / 3);
+        speed = sampleTruncatedNormal(mean, stddev);
     }
     else if (fromMethod == 1) {
         speed = mean;
     }
+    else if (usePredictionTable) {
+        speed = mean - quantileZ * stddev;
+    }
     else {
         speed = boost::math::quantile(boost::math::normal(mean, stddev), 1 - quantile);
     }
@@ -892,6 +1316,41 @@ float UAVNode::getSpeed(float angle, int fromMethod)
     return speed;
 }
 
+/**
+ * @return The seed set of the current run
+ */
+uint32_t UAVNode::getRunSeedSet() const
+{
+    const char *seedSet = getEnvir()->getConfigEx()->getVariable(CFGVAR_SEEDSET);
+    return seedSet ? strtoul(seedSet, nullptr, 10) : 0;
+}
+
+/**
+ * Creates the random stream of the node, a Mersenne Twister seeded like the physical RNGs of the run, i.e. from
+ * the seed set (or an explicit seed-<id>-mt), with an RNG id behind the physical RNGs that is unique per module.
+ * The samples of a node neither depend on the other nodes nor on the event order or the partitioning of a
+ * parallel simulation.
+ */
+void UAVNode::initializeRNG()
+{
+    delete rng;
+    rng = new cMersenneTwister();
+    int numPhysicalRngs = getEnvir()->getNumRNGs();
+    int rngId = numPhysicalRngs + getId();
+    rng->initialize(getRunSeedSet(), rngId, numPhysicalRngs + getSimulation()->getLastComponentId() + 1, 0, 1, getEnvir()->getConfig());
+    rngDraws = 0;
+}
+
+/**
+ * Normal distributed sample within mean +- 3 stddev and not below mean / 3, drawn from the stream of the node.
+ */
+float UAVNode::sampleTruncatedNormal(float mean, float stddev)
+{
+    rngDraws++;
+    double u = rng->doubleRandNonz();
+    return TruncatedNormal::getInstance().sample(u, mean, stddev, mean / 3);
+}
+
 void UAVNode::move()
 {
 //unused.
@@ -915,11 +1374,49 @@ bool UAVNode::cmpCoord(const Command& cmd1, const Command& cmd2)
     return (abs(cmd1.getX() - cmd2.getX()) + abs(cmd1.getY() - cmd2.getY()) + abs(cmd1.getZ() - cmd2.getZ())) < ERROR_MARGIN;
 }
 
+/**
+ * Returns the predicted energy, return energy and duration of the given CEE when started from the given coordinate.
+ * The prediction is cached per CEE, as in repeating missions each CEE starts from the same coordinate in every cycle.
+ * The cache is cleared on loadCommands(), clearCommands() and when the set of charging nodes changes.
+ * Only the deterministic values are cached, i.e. the quantile energy (fromMethod 2), the duration at mean speed (fromMethod 1)
+ * and the return energy, which estimateEnergy() computes without drawing random numbers.
+ * On a cache hit the CEE is still initialized, so it draws its random consumption (fromMethod 0) as without the cache.
+ */
+const UAVNode::CEEPrediction& UAVNode::predictCEE(CommandExecEngine* cee, double fromX, double fromY, double fromZ)
+{
+    auto it = predictionCache.find(cee);
+    if (it != predictionCache.end() && it->second.x0 == fromX && it->second.y0 == fromY && it->second.z0 == fromZ
+            && it->second.x1 == cee->getX1() && it->second.y1 == cee->getY1() && it->second.z1 == cee->getZ1()) {
+        cee->setFromCoordinates(fromX, fromY, fromZ);
+        if (it->second.energy != FLT_MAX) cee->initializeCEE();
+        return it->second;
+    }
+
+    cee->setFromCoordinates(fromX, fromY, fromZ);
+    CEEPrediction prediction;
+    prediction.x0 = fromX;
+    prediction.y0 = fromY;
+    prediction.z0 = fromZ;
+    prediction.x1 = cee->getX1();
+    prediction.y1 = cee->getY1();
+    prediction.z1 = cee->getZ1();
+    prediction.energy = energyForCEE(cee);
+    prediction.returnEnergy = energyToNearestCN(cee->getX1(), cee->getY1(), cee->getZ1());
+    prediction.duration = (prediction.energy == FLT_MAX) ? 0 : cee->getOverallDuration();
+    return predictionCache[cee] = prediction;
+}
+
+void UAVNode::clearPredictionCache()
+{
+    predictionCache.clear();
+}
+
 /**
  * Estimates/Predicts the energy consumption for the given CEE.
  */
 float UAVNode::energyForCEE(CommandExecEngine* cee)
 {
+    PROFILE_MODULE_SCOPE(profiling, "UAVNode::energyForCEE");
     if (cee->isCeeType(CeeType::IDLE)) {
         return FLT_MAX;
     }
@@ -940,27 +1437,94 @@ float UAVNode::energyForCEE(CommandExecEngine* cee)
     return cee->predictFullConsumptionQuantile();
 }
 
+/**
+ * Sums leg(fromX, fromY, fromZ, toX, toY, toZ) over the legs of the flight between both coordinates,
+ * i.e. the direct flight or the detour over the buildings of the ObstacleMap.
+ */
+template<typename Leg>
+double UAVNode::sumFlightLegs(double fromX, double fromY, double fromZ, double toX, double toY, double toZ, Leg leg) const
+{
+    double waypoints[3 * ObstacleMap::MAX_DETOUR_WAYPOINTS];
+    int count = (obstacleMap != nullptr) ? obstacleMap->getDetour(fromX, fromY, fromZ, toX, toY, toZ, waypoints) : 0;
+    double sum = 0;
+    for (int i = 0; i < count; i++) {
+        sum += leg(fromX, fromY, fromZ, waypoints[3 * i], waypoints[3 * i + 1], waypoints[3 * i + 2]);
+        fromX = waypoints[3 * i];
+        fromY = waypoints[3 * i + 1];
+        fromZ = waypoints[3 * i + 2];
+    }
+    return sum + leg(fromX, fromY, fromZ, toX, toY, toZ);
+}
+
 /**
  * Estimates/Predicts the energy consumption for a waypoint command
  * from the given coordinate (i.e. fromX, fromY, fromZ)
- * to the given coordinate (i.e. toX, toY, toZ). The fakeNode is required but not altered nor read.
+ * to the given coordinate (i.e. toX, toY, toZ), including the detour over buildings.
+ * No CEE is created and no random numbers are drawn.
  */
 float UAVNode::estimateEnergy(double fromX, double fromY, double fromZ, double toX, double toY, double toZ)
 {
-    WaypointCommand estimateCommand(toX, toY, toZ);
-    WaypointCEE estimateCEE(this, &estimateCommand);
-    estimateCEE.setFromCoordinates(fromX, fromY, fromZ);
-    estimateCEE.setPartOfMission(false);
-    estimateCEE.initializeCEE();
-    return estimateCEE.predictFullConsumptionQuantile();
+    return sumFlightLegs(fromX, fromY, fromZ, toX, toY, toZ, [this](double x0, double y0, double z0, double x1, double y1, double z1) {
+        return estimateDirectFlightEnergy(x0, y0, z0, x1, y1, z1);
+    });
+}
+
+/**
+ * Estimates/Predicts the energy consumption of flights from count given coordinates
+ * to the given coordinate (i.e. toX, toY, toZ), as predictFullConsumptionQuantile() of WaypointCEEs would,
+ * including the detours over buildings.
+ * All flights are evaluated with the prediction parameters of this node.
+ * No CEE is created and no random numbers are drawn, the node is not altered.
+ *
+ * @param energy Output array of count elements, in [mAh]
+ */
+void UAVNode::estimateFlightEnergy(const double* fromX, const double* fromY, const double* fromZ, unsigned int count, double toX, double toY,
+        double toZ, float* energy)
+{
+    auto leg = [this](double x0, double y0, double z0, double x1, double y1, double z1) {
+        return estimateDirectFlightEnergy(x0, y0, z0, x1, y1, z1);
+    };
+    for (unsigned int i = 0; i < count; i++) {
+        energy[i] = sumFlightLegs(fromX[i], fromY[i], fromZ[i], toX, toY, toZ, leg);
+    }
+}
+
+/**
+ * Energy of the straight flight for estimateFlightEnergy(), in [mAh]
+ */
+float UAVNode::estimateDirectFlightEnergy(double fromX, double fromY, double fromZ, double toX, double toY, double toZ)
+{
+    double dx = toX - fromX;
+    double dy = toY - fromY;
+    double dz = toZ - fromZ;
+    double distance = sqrt(dx * dx + dy * dy + dz * dz);
+    if (distance < 1.e-10) return 0;
+    if (abs(dx) < 1.e-10) dx = 0;
+    if (abs(dy) < 1.e-10) dy = 0;
+    if (abs(dz) < 1.e-10) dz = 0;
+    double climbAngle = atan2(dz, sqrt(dx * dx + dy * dy)) / M_PI * 180;
+    double speed = getSpeed(climbAngle);
+    return getMovementConsumption(climbAngle, distance / speed, 2);
 }
 
 /**
  * Estimates/Predicts the time needed for a waypoint command
  * from the given coordinate (i.e. fromX, fromY, fromZ)
- * to the given coordinate (i.e. toX, toY, toZ). The fakeNode is required but not altered nor read.
+ * to the given coordinate (i.e. toX, toY, toZ), including the detour over buildings.
  */
 double UAVNode::estimateDuration(double fromX, double fromY, double fromZ, double toX, double toY, double toZ)
+{
+    return sumFlightLegs(fromX, fromY, fromZ, toX, toY, toZ, [this](double x0, double y0, double z0, double x1, double y1, double z1) {
+        return estimateDirectDuration(x0, y0, z0, x1, y1, z1);
+    });
+}
+
+/**
+ * Estimates/Predicts the time needed for the straight flight
+ * from the given coordinate (i.e. fromX, fromY, fromZ)
+ * to the given coordinate (i.e. toX, toY, toZ). The fakeNode is required but not altered nor read.
+ */
+double UAVNode::estimateDirectDuration(double fromX, double fromY, double fromZ, double toX, double toY, double toZ)
 {
     WaypointCommand estimateCommand(toX, toY, toZ);
     WaypointCEE estimateCEE(this, &estimateCommand);
@@ -969,5 +1533,3 @@ double UAVNode::estimateDuration(double fromX, double fromY, double fromZ, doubl
     estimateCEE.initializeCEE();
     return estimateCEE.getOverallDuration();
 }
-
-#endif // WITH_OSG
@@ -16,17 +16,26 @@
 #ifndef __UAVNODE_H__
 #define __UAVNODE_H__
 
+#include <map>
+#include <set>
 #include <vector>
 #include <string>
 #include <omnetpp.h>
 #include "MobileNode.h"
 #include "msgs/MissionMsg_m.h"
 #include "msgs/ExchangeCompletedMsg_m.h"
+#include "msgs/ReplacementAssignedMsg_m.h"
 #include <boost/math/distributions/normal.hpp>
 #include "UAVSoloEmpiricData.h"
+#include "UAVSoloEmpiricTable.h"
+#include "TruncatedNormal.h"
+#include "Snapshot.h"
+#include "CEEPool.h"
 
 using namespace omnetpp;
 
+class ObstacleMap;
+
 /**
  * A mobile node that follows a predefined track.
  */
@@ -44,20 +53,29 @@ public:
     UAVNode();
     virtual ~UAVNode();
     virtual void loadCommands(CommandQueue commands, bool isMission = true) override;
+    virtual void clearCommands() override;
     virtual double estimateCommandsDuration();
+    double estimateDuration(const CommandQueue& commands);
     float getHoverConsumption(float duration, int fromMethod = 0);
     float getMovementConsumption(float angle, float duration, int fromMethod = 0);
     float getSpeed(float angle, int fromMethod = 1);
+    void estimateFlightEnergy(const double* fromX, const double* fromY, const double* fromZ, unsigned int count, double toX, double toY, double toZ,
+            float* energy);
+    int getMissionCursor() const;
+    Snapshot::NodeState getSnapshotState() const;
+    void restoreSnapshotState(const Snapshot::NodeState& state, uint32_t seedSet);
+    uint32_t getRunSeedSet() const;
 
-    //TODO part of hack111 to make the replacing node known to the Exchange command
+protected:
+    // the replacing node for the Exchange command, as told by the MissionControl with a replacementAssigned message
     GenericNode* replacingNode = nullptr;
     double replacementX = DBL_MAX, replacementY = DBL_MAX, replacementZ = DBL_MAX;
     simtime_t replacementTime = 0;
 
-protected:
     virtual void initialize(int stage) override;
     virtual void finish() override;
     virtual void handleMessage(cMessage *msg) override;
+    virtual void refreshDisplay() const override;
     virtual int numInitStages() const override
     {
         return 2;
@@ -68,27 +86,95 @@ protected:
     virtual bool isCommandCompleted() override;
     virtual double nextNeededUpdate() override;
     virtual void collectStatistics() override;
-    virtual ReplacementData* endOfOperation() override;
+    virtual bool endOfOperation(ReplacementData& replacementData) override;
+    virtual void addMemoryUsage(MemoryUsage& usage) const override;
     virtual float energyToNearestCN(double fromX, double fromY, double fromZ) override;
+    ChargingNode* selectChargingNode(double fromX, double fromY, double fromZ);
 
     bool exchangeAfterCurrentCommand = false;
 
+    CEEPool ceePool;
+    void releaseCEE(CommandExecEngine* cee);
+    void releaseQueuedCEEs();
+    int createDetourCEEs(double fromX, double fromY, double fromZ, double toX, double toY, double toZ, bool partOfMission,
+            CommandExecEngine** detour);
+
     //not needed
     virtual void move();
 
     void transferMissionDataTo(UAVNode* node);
 
 private:
+    /// Label texts currently shown, the labels are only updated if these change
+    mutable std::string displayedLabel;
+    mutable std::string displayedSummary;
+
+    /**
+     * Cached prediction for one CEE, valid as long as the CEE leads from (x0, y0, z0) to (x1, y1, z1)
+     */
+    struct CEEPrediction {
+        double x0, y0, z0;
+        double x1, y1, z1;
+        float energy;
+        float returnEnergy;
+        float duration;
+    };
+    std::map<CommandExecEngine*, CEEPrediction> predictionCache;
+    unsigned int predictionCacheRevision = 0;
+    const CEEPrediction& predictCEE(CommandExecEngine* cee, double fromX, double fromY, double fromZ);
+    void clearPredictionCache();
+
+    int replacementMethod = 0;
+    float weightedSumWeight = 0.5;
+    /// Flat rows of the predictions of endOfOperation, reused between the calls
+    std::vector<float> predictionRows;
+
+    /**
+     * Replacements one heuristic would have planned, only collected with evaluateAllHeuristics
+     */
+    struct HeuristicStatistics {
+        cStdDev commands;
+        cStdDev duration;
+        cStdDev returnEnergy;
+    };
+    bool evaluateAllHeuristics = false;
+    /// Weights of the bi-objective heuristic evaluated with evaluateAllHeuristics
+    std::vector<float> weightSweep;
+    std::vector<int> sweepRows;
+    std::vector<float> sweepWeightedSums;
+    /// latest opportunity, shortest return and one entry per weight of weightSweep
+    std::vector<HeuristicStatistics> heuristicStatistics;
+    void initHeuristicStatistics(HeuristicStatistics& statistics, const std::string& name);
+    void recordHeuristicDecision(HeuristicStatistics& statistics, int row);
+
     bool cmpCoord(const Command& cmd, const double X, const double Y, const double Z);
     bool cmpCoord(const Command& cmd1, const Command& cmd2);
     float energyForCEE(CommandExecEngine* cee);
     float estimateEnergy(double fromX, double fromY, double fromZ, double toX, double toY, double toZ);
     double estimateDuration(double fromX, double fromY, double fromZ, double toX, double toY, double toZ);
+    double estimateDirectDuration(double fromX, double fromY, double fromZ, double toX, double toY, double toZ);
+    float estimateDirectFlightEnergy(double fromX, double fromY, double fromZ, double toX, double toY, double toZ);
+    template<typename Leg>
+    double sumFlightLegs(double fromX, double fromY, double fromZ, double toX, double toY, double toZ, Leg leg) const;
+    /// Buildings to fly over, nullptr if the network has no ObstacleMap
+    ObstacleMap* obstacleMap = nullptr;
     float quantile = 0.95;
+    float quantileZ = 1.644854; // standard normal quantile of predictionQuantile
+    bool usePredictionTable = true;
+
+    /// Random stream of this node, only used for its own samples, and the numbers drawn from it
+    cRNG* rng = nullptr;
+    uint64_t rngDraws = 0;
+    void initializeRNG();
+    float sampleTruncatedNormal(float mean, float stddev);
+    int chargingNodeSearchMethod = 0;
+    // predictionQuantile values the tables are verified for
+    static std::set<float> predictionTableVerifiedQuantiles;
     bool receivedMission_valid = false;
     int receivedMission_missionId;
     bool receivedMission_commandsRepeat;
-    CommandQueue receivedMission_missionCommands;
+    MissionPtr receivedMission;
+    int receivedMission_cursor;
 };
 
 #endif
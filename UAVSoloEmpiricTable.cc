@@ -0,0 +1,148 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#include <cmath>
+#include <algorithm>
+#include <boost/math/distributions/normal.hpp>
+#include "UAVSoloEmpiricTable.h"
+
+#define HOVER_TABLE_IDX NUM_ANGLES
+
+const UAVSoloEmpiricTable& UAVSoloEmpiricTable::getInstance()
+{
+    static const UAVSoloEmpiricTable instance;
+    return instance;
+}
+
+UAVSoloEmpiricTable::UAVSoloEmpiricTable()
+{
+    for (u_int idx = 0; idx < NUM_ANGLES; idx++) {
+        angles[idx] = ANGLE2POWER[idx][0];
+    }
+
+    // Interpolation slopes, segment idx spans angles[idx - 1]..angles[idx]
+    inverseAngleSpan[0] = powerSlope[0] = speedSlope[0] = speedStddevSlope[0] = 0;
+    for (u_int idx = 1; idx < NUM_ANGLES; idx++) {
+        float span = angles[idx] - angles[idx - 1];
+        inverseAngleSpan[idx] = 1 / span;
+        powerSlope[idx] = (ANGLE2POWER[idx][1] - ANGLE2POWER[idx - 1][1]) / span;
+        speedSlope[idx] = (ANGLE2SPEED[idx][1] - ANGLE2SPEED[idx - 1][1]) / span;
+        speedStddevSlope[idx] = (ANGLE2SPEED[idx][2] - ANGLE2SPEED[idx - 1][2]) / span;
+    }
+
+    // First segment whose upper angle is not below the lower bound of the bin
+    for (u_int bin = 0; bin < NUM_ANGLE_BINS; bin++) {
+        u_int idx = 1;
+        while (idx < NUM_ANGLES - 1 && angles[idx] < (float) bin - 90)
+            idx++;
+        angleBinToSegment[bin] = idx;
+    }
+
+    // Lag prefix sums for the closed form of the H formula
+    for (u_int idx = 0; idx <= NUM_ANGLES; idx++) {
+        const float* lags = (idx == HOVER_TABLE_IDX) ? HOVER_LAGS : ANGLE2LAGS[idx];
+        maxLag[idx] = ((idx == HOVER_TABLE_IDX) ? NUM_HOVERLAGS : NUM_ANGLELAGS) - 1;
+        firstLag[idx] = lags[0 + 1];
+        lagSum[idx][0] = 0;
+        lagWeightedSum[idx][0] = 0;
+        for (u_int h = 1; h <= maxLag[idx]; h++) {
+            lagSum[idx][h] = lagSum[idx][h - 1] + lags[h + 1];
+            lagWeightedSum[idx][h] = lagWeightedSum[idx][h - 1] + h * lags[h + 1];
+        }
+    }
+}
+
+float UAVSoloEmpiricTable::getVariance(int angleIdx, float duration) const
+{
+    u_int n = (u_int) (duration * LAGS_SAMPLES_PER_SECOND);
+    if (n == 0) {
+        // keep the exact (unsigned underflow) behavior of the reference implementation
+        return getVarianceFromHFormula(angleIdx, duration);
+    }
+    u_int idx = (angleIdx == -1) ? HOVER_TABLE_IDX : (u_int) angleIdx;
+    u_int k = std::min(n - 1, maxLag[idx]);
+
+    double variance = n * firstLag[idx] + 2 * (n * lagSum[idx][k] - lagWeightedSum[idx][k]);
+    variance = variance / pow(LAGS_SAMPLES_PER_SECOND, 3);
+    return std::abs(variance);
+}
+
+double UAVSoloEmpiricTable::verify(double tolerance, double quantile) const
+{
+    double maxDeviation = 0;
+    auto deviation = [](double value, double reference) {
+        double scale = std::max(std::abs(reference), 1e-9);
+        return std::abs(value - reference) / scale;
+    };
+    // the tables use the standard normal quantile, the reference the quantile of each distribution
+    float quantileZ = boost::math::quantile(boost::math::normal(0, 1), quantile);
+
+    // Variance and hover quantile for every angle and hover over short to long maneuvers
+    const float durations[] = { 0.1, 0.5, 1, 2, 2.9, 3, 3.1, 5, 10, 33, 60, 120, 600, 1800 };
+    for (int angleIdx = -1; angleIdx < (int) NUM_ANGLES; angleIdx++) {
+        for (float duration : durations) {
+            maxDeviation = std::max(maxDeviation, deviation(getVariance(angleIdx, duration), getVarianceFromHFormula(angleIdx, duration)));
+        }
+    }
+    for (float duration : durations) {
+        float mean = HOVER_MEAN * duration / 3600;
+        float energy = mean + quantileZ * sqrt(getVariance(-1, duration));
+        double reference = boost::math::quantile(boost::math::normal(mean, sqrt(getVarianceFromHFormula(-1, duration))), quantile);
+        maxDeviation = std::max(maxDeviation, deviation(energy, reference));
+    }
+
+    // Segment lookup and interpolation against the linear scan
+    for (float angle = -90; angle <= 90; angle += 0.05) {
+        u_int reference = 0;
+        for (u_int idx = 1; idx < NUM_ANGLES; idx++) {
+            if (ANGLE2POWER[idx - 1][0] <= angle && angle <= ANGLE2POWER[idx][0]) {
+                reference = idx;
+                break;
+            }
+        }
+        u_int segment = getSegment(angle);
+        if (segment != reference) return 1;
+
+        float angle0 = ANGLE2POWER[segment - 1][0];
+        float angle1 = ANGLE2POWER[segment][0];
+        float power = ANGLE2POWER[segment - 1][1] + (ANGLE2POWER[segment][1] - ANGLE2POWER[segment - 1][1]) / (angle1 - angle0) * (angle - angle0);
+        float speed = ANGLE2SPEED[segment - 1][1] + (ANGLE2SPEED[segment][1] - ANGLE2SPEED[segment - 1][1]) / (angle1 - angle0) * (angle - angle0);
+        float speedStddev = ANGLE2SPEED[segment - 1][2] + (ANGLE2SPEED[segment][2] - ANGLE2SPEED[segment - 1][2]) / (angle1 - angle0) * (angle - angle0);
+        maxDeviation = std::max(maxDeviation, deviation(getMeanPower(segment, angle), power));
+        maxDeviation = std::max(maxDeviation, deviation(getMeanSpeed(segment, angle), speed));
+        maxDeviation = std::max(maxDeviation, deviation(getSpeedStddev(segment, angle), speedStddev));
+
+        // Quantile of the speed as in UAVNode::getSpeed(angle, 2)
+        float speedQuantile = getMeanSpeed(segment, angle) - quantileZ * std::abs(getSpeedStddev(segment, angle)) / 10;
+        double speedReference = boost::math::quantile(boost::math::normal(speed, std::abs(speedStddev) / 10), 1 - quantile);
+        maxDeviation = std::max(maxDeviation, deviation(speedQuantile, speedReference));
+
+        // Quantile of the movement consumption as in UAVNode::getMovementConsumption(angle, duration, 2)
+        for (float duration : durations) {
+            float var0 = getVariance(segment - 1, duration);
+            float var1 = getVariance(segment, duration);
+            float var = var0 + (var1 - var0) * getAngleSlope(segment) * (angle - getAngle(segment - 1));
+            float energy = getMeanPower(segment, angle) * duration / 3600 + quantileZ * sqrt(var);
+
+            float refVar0 = getVarianceFromHFormula(segment - 1, duration);
+            float refVar1 = getVarianceFromHFormula(segment, duration);
+            float refVar = refVar0 + (refVar1 - refVar0) / (angle1 - angle0) * (angle - angle0);
+            double reference = boost::math::quantile(boost::math::normal(power * duration / 3600, sqrt(refVar)), quantile);
+            maxDeviation = std::max(maxDeviation, deviation(energy, reference));
+        }
+    }
+
+    return (maxDeviation > tolerance) ? maxDeviation : -1;
+}
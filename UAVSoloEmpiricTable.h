@@ -0,0 +1,104 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef UAVSOLOEMPIRICTABLE_H_
+#define UAVSOLOEMPIRICTABLE_H_
+
+#include "UAVSoloEmpiricData.h"
+
+/**
+ * Lookup tables derived once from UAVSoloEmpiricData.h.
+ *
+ * Replaces the linear angle scan and the PACF lag loop of getVarianceFromHFormula()
+ * by an integer angle bin to segment mapping, per segment interpolation slopes
+ * and per angle prefix sums over the lags. With k = min(n-1, NUM_LAGS-1) the
+ * variance of n samples is n * lagSum[k] - lagWeightedSum[k], i.e. constant time per call.
+ */
+class UAVSoloEmpiricTable {
+public:
+    static const UAVSoloEmpiricTable& getInstance();
+
+    /**
+     * Segment index idx (1..NUM_ANGLES-1) so that angle lies in [angle(idx-1), angle(idx)],
+     * equal to the first match of the linear scan used before.
+     */
+    u_int getSegment(float angle) const
+    {
+        u_int idx = angleBinToSegment[(int) (angle + 90)];
+        while (idx < NUM_ANGLES - 1 && angle > angles[idx])
+            idx++;
+        return idx;
+    }
+
+    float getAngle(u_int idx) const
+    {
+        return angles[idx];
+    }
+
+    float getAngleSlope(u_int segment) const
+    {
+        return inverseAngleSpan[segment];
+    }
+
+    float getMeanPower(u_int segment, float angle) const
+    {
+        return ANGLE2POWER[segment - 1][1] + powerSlope[segment] * (angle - angles[segment - 1]);
+    }
+
+    float getMeanSpeed(u_int segment, float angle) const
+    {
+        return ANGLE2SPEED[segment - 1][1] + speedSlope[segment] * (angle - angles[segment - 1]);
+    }
+
+    float getSpeedStddev(u_int segment, float angle) const
+    {
+        return ANGLE2SPEED[segment - 1][2] + speedStddevSlope[segment] * (angle - angles[segment - 1]);
+    }
+
+    /**
+     * Same result as getVarianceFromHFormula(angleIdx, duration), angleIdx -1 for hover.
+     */
+    float getVariance(int angleIdx, float duration) const;
+
+    /**
+     * Compares every value of the tables with the direct calculation for all angle bins and a range of durations,
+     * i.e. the means, the speed stddev, the variances and the quantile outputs of the predictions (fromMethod 2).
+     *
+     * @param tolerance The accepted relative deviation
+     * @param quantile The predictionQuantile the quantile outputs are compared for
+     * @return The maximum relative deviation found, or a negative value if all are within the tolerance
+     */
+    double verify(double tolerance, double quantile) const;
+
+private:
+    UAVSoloEmpiricTable();
+
+    static const u_int NUM_ANGLE_BINS = 181;
+
+    float angles[NUM_ANGLES];
+    u_int angleBinToSegment[NUM_ANGLE_BINS];
+    float inverseAngleSpan[NUM_ANGLES];
+    float powerSlope[NUM_ANGLES];
+    float speedSlope[NUM_ANGLES];
+    float speedStddevSlope[NUM_ANGLES];
+
+    // prefix sums over h = 1..k of lag(h+1) and h*lag(h+1), index NUM_ANGLES is the hover maneuver
+    double lagSum[NUM_ANGLES + 1][NUM_ANGLELAGS];
+    double lagWeightedSum[NUM_ANGLES + 1][NUM_ANGLELAGS];
+    double firstLag[NUM_ANGLES + 1];
+    u_int maxLag[NUM_ANGLES + 1];
+};
+
+#endif /* UAVSOLOEMPIRICTABLE_H_ */
@@ -0,0 +1,247 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <thread>
+#include "WaypointsLoader.h"
+
+#define WAYPOINTS_FIELDS 12
+#define WAYPOINTS_CACHE_MAGIC 0x31505757 // "WWP1"
+
+WaypointsLoader::WaypointsLoader(const WaypointsProjection& projection, const std::string& cacheDirectory) :
+        projection(projection), cacheDirectory(cacheDirectory)
+{
+}
+
+WaypointsFile WaypointsLoader::load(const std::string& fileName) const
+{
+    WaypointsFile file;
+    file.fileName = fileName;
+
+    std::ifstream inputFile(fileName, std::ios::in | std::ios::binary);
+    if (not inputFile) {
+        file.error = fileName + ": cannot open file";
+        return file;
+    }
+    std::stringstream buffer;
+    buffer << inputFile.rdbuf();
+    std::string content = buffer.str();
+
+    std::string cacheFileName;
+    if (not cacheDirectory.empty()) {
+        cacheFileName = getCacheFileName(content);
+        if (readCache(cacheFileName, file)) return file;
+    }
+    if (parse(content, file) && not cacheFileName.empty()) {
+        writeCache(cacheFileName, file);
+    }
+    return file;
+}
+
+/**
+ * Files are distributed round robin over the worker threads, the result keeps the order of fileNames.
+ * An exception while loading a file, e.g. std::bad_alloc, is reported as the error of that file.
+ *
+ * @param threads Number of worker threads, 0 for the number of hardware threads
+ */
+std::vector<WaypointsFile> WaypointsLoader::load(const std::vector<std::string>& fileNames, unsigned int threads) const
+{
+    std::vector<WaypointsFile> files(fileNames.size());
+    auto loadFile = [this, &fileNames, &files](unsigned int i) {
+        try {
+            files[i] = load(fileNames[i]);
+        }
+        catch (const std::exception& e) {
+            files[i] = WaypointsFile();
+            files[i].fileName = fileNames[i];
+            files[i].error = fileNames[i] + ": " + e.what();
+        }
+    };
+    if (threads == 0) threads = std::thread::hardware_concurrency();
+    if (threads > fileNames.size()) threads = fileNames.size();
+    if (threads <= 1) {
+        for (unsigned int i = 0; i < fileNames.size(); i++) {
+            loadFile(i);
+        }
+        return files;
+    }
+
+    std::vector<std::thread> workers;
+    for (unsigned int t = 0; t < threads; t++) {
+        workers.push_back(std::thread([&fileNames, &loadFile, t, threads]() {
+            for (unsigned int i = t; i < fileNames.size(); i += threads) {
+                loadFile(i);
+            }
+        }));
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    return files;
+}
+
+/**
+ * The first line (header) and the second line (home) are skipped, empty lines are ignored.
+ * Every other line holds 12 whitespace separated fields:
+ * index, current, frame, command, p1, p2, p3, p4, latitude, longitude, altitude, autocontinue
+ */
+bool WaypointsLoader::parse(const std::string& content, WaypointsFile& file) const
+{
+    const char* pos = content.c_str();
+    const char* end = pos + content.size();
+    int lineCnt = 0;
+
+    while (pos < end) {
+        const char* lineEnd = static_cast<const char*>(memchr(pos, '\n', end - pos));
+        if (lineEnd == nullptr) lineEnd = end;
+        lineCnt++;
+        std::string line(pos, lineEnd);
+        pos = lineEnd + 1;
+        if (lineCnt <= 2) continue;
+
+        const char* field = line.c_str();
+        double values[WAYPOINTS_FIELDS];
+        int numValues = 0;
+        while (true) {
+            while (*field == ' ' || *field == '\t' || *field == '\r')
+                field++;
+            if (*field == '\0') break;
+            if (numValues == WAYPOINTS_FIELDS) {
+                file.error = file.fileName + ":" + std::to_string(lineCnt) + ": more than " + std::to_string(WAYPOINTS_FIELDS) + " fields";
+                return false;
+            }
+            char* fieldEnd;
+            errno = 0;
+            values[numValues] = strtod(field, &fieldEnd);
+            if (fieldEnd == field || errno == ERANGE || (*fieldEnd != '\0' && *fieldEnd != ' ' && *fieldEnd != '\t' && *fieldEnd != '\r')) {
+                file.error = file.fileName + ":" + std::to_string(lineCnt) + ": invalid number in field " + std::to_string(numValues + 1);
+                return false;
+            }
+            numValues++;
+            field = fieldEnd;
+        }
+        if (numValues == 0) continue;
+        if (numValues != WAYPOINTS_FIELDS) {
+            file.error = file.fileName + ":" + std::to_string(lineCnt) + ": expected " + std::to_string(WAYPOINTS_FIELDS) + " fields, found "
+                    + std::to_string(numValues);
+            return false;
+        }
+
+        WaypointRecord record;
+        record.commandType = (int) values[3];
+        record.p1 = values[4];
+        record.x = projection.toX(values[9]);
+        record.y = projection.toY(values[8]);
+        record.z = values[10];
+        switch (record.commandType) {
+            case WAYPOINTS_CMD_WAYPOINT:
+            case WAYPOINTS_CMD_LOITER_TIME:
+            case WAYPOINTS_CMD_TAKEOFF:
+                break;
+            case WAYPOINTS_CMD_LOITER_UNLIM:
+                file.error = file.fileName + ":" + std::to_string(lineCnt) + ": command not implemented yet: LOITER_UNLIM";
+                return false;
+            case WAYPOINTS_CMD_RETURN_TO_LAUNCH:
+                file.error = file.fileName + ":" + std::to_string(lineCnt) + ": command not implemented yet: RETURN_TO_LAUNCH";
+                return false;
+            case WAYPOINTS_CMD_LAND:
+                file.error = file.fileName + ":" + std::to_string(lineCnt) + ": command not implemented yet: LAND";
+                return false;
+            default:
+                file.error = file.fileName + ":" + std::to_string(lineCnt) + ": unexpected command " + std::to_string(record.commandType);
+                return false;
+        }
+        file.records.push_back(record);
+    }
+    return true;
+}
+
+/**
+ * @return Path of the cache file, named by the 64 bit FNV-1a hash of the file content and the projection
+ */
+std::string WaypointsLoader::getCacheFileName(const std::string& content) const
+{
+    uint64_t hash = 14695981039346656037ULL;
+    auto hashBytes = [&hash](const char* data, size_t size) {
+        for (size_t i = 0; i < size; i++) {
+            hash ^= (unsigned char) data[i];
+            hash *= 1099511628211ULL;
+        }
+    };
+    hashBytes(content.data(), content.size());
+    hashBytes(reinterpret_cast<const char*>(&projection.playgroundLat), sizeof(double));
+    hashBytes(reinterpret_cast<const char*>(&projection.playgroundLon), sizeof(double));
+
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.wpbin", (unsigned long long) hash);
+    return cacheDirectory + "/" + name;
+}
+
+bool WaypointsLoader::readCache(const std::string& cacheFileName, WaypointsFile& file) const
+{
+    std::ifstream cacheFile(cacheFileName, std::ios::in | std::ios::binary);
+    if (not cacheFile) return false;
+    uint32_t magic = 0;
+    uint64_t count = 0;
+    cacheFile.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+    cacheFile.read(reinterpret_cast<char*>(&count), sizeof(count));
+    if (not cacheFile || magic != WAYPOINTS_CACHE_MAGIC) return false;
+    // a truncated or corrupt cache file is parsed again instead of allocating for its count
+    std::streampos recordsBegin = cacheFile.tellg();
+    cacheFile.seekg(0, std::ios::end);
+    std::streamoff remaining = cacheFile.tellg() - recordsBegin;
+    cacheFile.seekg(recordsBegin);
+    if (not cacheFile || remaining < 0 || count != (uint64_t) remaining / sizeof(WaypointRecord)
+            || (uint64_t) remaining % sizeof(WaypointRecord) != 0) {
+        return false;
+    }
+    std::vector<WaypointRecord> records(count);
+    cacheFile.read(reinterpret_cast<char*>(records.data()), count * sizeof(WaypointRecord));
+    if (not cacheFile) return false;
+    file.records.swap(records);
+    file.fromCache = true;
+    return true;
+}
+
+/**
+ * Best effort, a cache file that can not be written is simply not used.
+ */
+void WaypointsLoader::writeCache(const std::string& cacheFileName, const WaypointsFile& file) const
+{
+    std::string tempFileName = cacheFileName + ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    {
+        std::ofstream cacheFile(tempFileName, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (not cacheFile) return;
+        uint32_t magic = WAYPOINTS_CACHE_MAGIC;
+        uint64_t count = file.records.size();
+        cacheFile.write(reinterpret_cast<const char*>(&magic), sizeof(magic));
+        cacheFile.write(reinterpret_cast<const char*>(&count), sizeof(count));
+        cacheFile.write(reinterpret_cast<const char*>(file.records.data()), count * sizeof(WaypointRecord));
+        if (not cacheFile) {
+            cacheFile.close();
+            std::remove(tempFileName.c_str());
+            return;
+        }
+    }
+    std::rename(tempFileName.c_str(), cacheFileName.c_str());
+}
@@ -0,0 +1,97 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef WAYPOINTSLOADER_H_
+#define WAYPOINTSLOADER_H_
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+#define WAYPOINTS_CMD_WAYPOINT 16
+#define WAYPOINTS_CMD_LOITER_UNLIM 17
+#define WAYPOINTS_CMD_LOITER_TIME 19
+#define WAYPOINTS_CMD_RETURN_TO_LAUNCH 20
+#define WAYPOINTS_CMD_LAND 21
+#define WAYPOINTS_CMD_TAKEOFF 22
+
+/**
+ * Equirectangular projection of latitude/longitude to playground coordinates, as done by OsgEarthScene::toX()/toY().
+ * The cosine of the playground latitude is computed once.
+ */
+struct WaypointsProjection {
+    double playgroundLat;
+    double playgroundLon;
+    double cosPlaygroundLat;
+
+    WaypointsProjection(double playgroundLat, double playgroundLon) :
+            playgroundLat(playgroundLat), playgroundLon(playgroundLon), cosPlaygroundLat(cos(fabs(playgroundLat / 180 * M_PI)))
+    {
+    }
+    double toX(double longitude) const
+    {
+        return (longitude - playgroundLon) * cosPlaygroundLat * 111111;
+    }
+    double toY(double latitude) const
+    {
+        return (playgroundLat - latitude) * 111111;
+    }
+};
+
+/**
+ * One projected mission item of a *.waypoints file.
+ */
+struct WaypointRecord {
+    int commandType;
+    double x, y, z;
+    double p1;
+};
+
+/**
+ * Result of loading one *.waypoints file, error is empty on success.
+ */
+struct WaypointsFile {
+    std::string fileName;
+    std::vector<WaypointRecord> records;
+    std::string error;
+    bool fromCache = false;
+};
+
+/**
+ * Bulk loader for QGroundControl *.waypoints files (QGC WPL 110).
+ * Files are read at once and parsed line by line, every malformed line is reported with its line number.
+ * Multiple files are loaded in parallel. Does not call into the simulation kernel, so it is safe to run on worker threads.
+ *
+ * If a cache directory is given, projected missions are stored in a binary file keyed on the hash of the file content
+ * and the projection, later runs read those instead of parsing.
+ */
+class WaypointsLoader {
+public:
+    WaypointsLoader(const WaypointsProjection& projection, const std::string& cacheDirectory = "");
+
+    WaypointsFile load(const std::string& fileName) const;
+    std::vector<WaypointsFile> load(const std::vector<std::string>& fileNames, unsigned int threads = 0) const;
+
+private:
+    WaypointsProjection projection;
+    std::string cacheDirectory;
+
+    bool parse(const std::string& content, WaypointsFile& file) const;
+    std::string getCacheFileName(const std::string& content) const;
+    bool readCache(const std::string& cacheFileName, WaypointsFile& file) const;
+    void writeCache(const std::string& cacheFileName, const WaypointsFile& file) const;
+};
+
+#endif /* WAYPOINTSLOADER_H_ */
@@ -0,0 +1,185 @@
+#!/usr/bin/env python3
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Lesser General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this program.  If not, see http://www.gnu.org/licenses/.
+#
+
+"""
+Runs the Benchmark-* configs one run at a time and writes a JSON report with
+events/sec, simsec/sec, peak RSS, the hot path timers and the memory report of
+every run.
+
+The hot path timers are the profile.* scalars recorded by MissionControl, they
+are only present if the simulation was built with "make PROFILING=yes"
+("make benchmark" does that). With --baseline the report is compared against an
+older report, the script fails if a benchmark got slower than the tolerance.
+
+Examples:
+  scripts/benchmark.py -x ./multiUAV-simulation-headless-profiling
+  scripts/benchmark.py -c Benchmark-Fleet -r '$numUAVs<=500' --baseline results/benchmark/report-old.json
+"""
+
+import argparse
+import json
+import os
+import re
+import shlex
+import subprocess
+import sys
+import time
+
+from runbatch import PROJECT_DIR, default_executable
+
+DEFAULT_CONFIGS = ["Benchmark-Fleet", "Benchmark-TimeStep", "Benchmark-MissionLength"]
+
+END_PATTERN = re.compile(r"at t=([0-9.eE+-]+)s?, event #(\d+)")
+PROGRESS_PATTERN = re.compile(r"Event #(\d+)\s+t=([0-9.eE+-]+)")
+
+
+def query_run_numbers(args, config):
+    cmd = [args.executable, "-u", "Cmdenv", "-n", ".", "-f", args.ini, "-c", config, "-s", "-q", "runnumbers"]
+    if args.runs:
+        cmd += ["-r", args.runs]
+    output = subprocess.run(cmd, cwd=PROJECT_DIR, stdout=subprocess.PIPE, universal_newlines=True, check=True).stdout
+    lines = [line for line in output.splitlines() if line.strip()]
+    return [int(token) for token in lines[-1].split() if token.isdigit()] if lines else []
+
+
+def parse_profile(path):
+    """
+    Returns the iteration variables, the hot path timers and the memory report of a scalar file.
+    """
+    iterationvars = ""
+    hot_paths = {}
+    memory = {}
+    if not os.path.exists(path):
+        return iterationvars, hot_paths, memory
+    with open(path) as f:
+        for line in f:
+            if line.startswith("attr iterationvars "):
+                iterationvars = line[len("attr iterationvars "):].strip().strip('"')
+            elif line.startswith("scalar ") and " profile." in line:
+                parts = shlex.split(line)
+                name, _, field = parts[2][len("profile."):].rpartition(".")
+                hot_paths.setdefault(name, {})[field] = float(parts[3])
+            elif line.startswith("scalar ") and " memory." in line:
+                # bytes and objects per subsystem, summed over the MissionControls of all regions
+                parts = shlex.split(line)
+                name, _, field = parts[2][len("memory."):].rpartition(".")
+                fields = memory.setdefault(name, {})
+                fields[field] = fields.get(field, 0) + float(parts[3])
+    return iterationvars, hot_paths, memory
+
+
+def run_benchmark(args, config, run):
+    result_dir = os.path.join(args.result_dir, "runs")
+    cmd = [args.executable, "-u", "Cmdenv", "-n", ".", "-f", args.ini, "-c", config, "-r", str(run),
+           "--seed-set=%d" % run, "--result-dir=" + result_dir, "--cmdenv-express-mode=true",
+           "--cmdenv-performance-display=true", "--record-eventlog=false"]
+    start = time.monotonic()
+    process = subprocess.Popen(cmd, cwd=PROJECT_DIR, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, universal_newlines=True)
+    output = process.stdout.read()
+    # wait4 instead of wait to get the peak RSS of this very process
+    _, status, usage = os.wait4(process.pid, 0)
+    process.returncode = -(status & 0x7f) if status & 0x7f else status >> 8
+    wall_seconds = time.monotonic() - start
+
+    events, simtime = 0, 0.0
+    for match in PROGRESS_PATTERN.finditer(output):
+        events, simtime = int(match.group(1)), float(match.group(2))
+    for match in END_PATTERN.finditer(output):
+        simtime, events = float(match.group(1)), int(match.group(2))
+
+    iterationvars, hot_paths, memory = parse_profile(os.path.join(PROJECT_DIR, result_dir, "%s-%d.sca" % (config, run)))
+    result = {
+        "config": config,
+        "run": run,
+        "iterationvars": iterationvars,
+        "exitCode": process.returncode,
+        "events": events,
+        "simtime": simtime,
+        "wallSeconds": wall_seconds,
+        "eventsPerSecond": events / wall_seconds if wall_seconds > 0 else 0,
+        "simsecPerSecond": simtime / wall_seconds if wall_seconds > 0 else 0,
+        "peakRssKiB": usage.ru_maxrss,
+        "hotPaths": hot_paths,
+        "memory": memory,
+    }
+    print("%s #%d %s: %.0f ev/s, %.1f simsec/s, %d KiB peak RSS" % (config, run, iterationvars, result["eventsPerSecond"],
+                                                                     result["simsecPerSecond"], result["peakRssKiB"]), flush=True)
+    return result
+
+
+def compare(report, baseline, tolerance, min_seconds):
+    """
+    @return Human readable regressions of report against baseline
+    """
+    regressions = []
+    previous = {(b["config"], b["iterationvars"]): b for b in baseline["benchmarks"]}
+    for b in report["benchmarks"]:
+        old = previous.get((b["config"], b["iterationvars"]))
+        if old is None:
+            continue
+        label = "%s %s" % (b["config"], b["iterationvars"])
+        if b["exitCode"] != 0 and old["exitCode"] == 0:
+            regressions.append("%s: failed with exit code %d" % (label, b["exitCode"]))
+        for key in ("eventsPerSecond", "simsecPerSecond"):
+            if old[key] > 0 and b[key] < old[key] * (1 - tolerance):
+                regressions.append("%s: %s dropped from %.1f to %.1f" % (label, key, old[key], b[key]))
+        for name, timer in b["hotPaths"].items():
+            old_seconds = old["hotPaths"].get(name, {}).get("seconds", 0)
+            if old_seconds >= min_seconds and timer.get("seconds", 0) > old_seconds * (1 + tolerance):
+                regressions.append("%s: %s took %.3fs instead of %.3fs" % (label, name, timer["seconds"], old_seconds))
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("-c", "--configs", type=lambda s: s.split(","), default=DEFAULT_CONFIGS, help="comma separated benchmark configs")
+    parser.add_argument("-r", "--runs", help="run filter applied to every config, e.g. \"$numUAVs<=500\"")
+    parser.add_argument("-f", "--ini", default="omnetpp.ini", help="ini file")
+    parser.add_argument("-x", "--executable", default=default_executable(), help="simulation executable")
+    parser.add_argument("--result-dir", default=os.path.join("results", "benchmark"), help="result directory relative to the project")
+    parser.add_argument("-o", "--output", help="JSON report, default <result-dir>/report.json")
+    parser.add_argument("--baseline", help="JSON report of an earlier benchmark to compare against")
+    parser.add_argument("--tolerance", type=float, default=0.1, help="allowed relative slowdown against the baseline")
+    parser.add_argument("--min-seconds", type=float, default=0.05, help="hot paths faster than this in the baseline are not compared")
+    args = parser.parse_args()
+    args.executable = os.path.abspath(args.executable)
+
+    report = {"executable": args.executable, "created": time.strftime("%Y-%m-%dT%H:%M:%S"), "benchmarks": []}
+    for config in args.configs:
+        for run in query_run_numbers(args, config):
+            report["benchmarks"].append(run_benchmark(args, config, run))
+
+    output = args.output or os.path.join(PROJECT_DIR, args.result_dir, "report.json")
+    os.makedirs(os.path.dirname(os.path.abspath(output)), exist_ok=True)
+    with open(output, "w") as f:
+        json.dump(report, f, indent=2, sort_keys=True)
+    print("wrote " + output)
+
+    failed = [b for b in report["benchmarks"] if b["exitCode"] != 0]
+    for b in failed:
+        print("%s #%d failed with exit code %d" % (b["config"], b["run"], b["exitCode"]), file=sys.stderr)
+    if args.baseline:
+        with open(args.baseline) as f:
+            regressions = compare(report, json.load(f), args.tolerance, args.min_seconds)
+        for regression in regressions:
+            print("regression: " + regression, file=sys.stderr)
+        if regressions:
+            return 1
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
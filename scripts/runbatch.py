@@ -0,0 +1,209 @@
+#!/usr/bin/env python3
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Lesser General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this program.  If not, see http://www.gnu.org/licenses/.
+#
+
+"""
+Runs all runs of a configuration as independent Cmdenv processes in parallel
+and aggregates their scalar results into a single CSV file.
+
+Every run is started with its run number as seed set, so each replication
+uses its own fixed RNG seeds, independent of the order the runs are executed in.
+
+For each iteration (the iteration variables of a run without the repetition)
+and scalar, the per-run value is the sum over all module instances, e.g. the
+energy used by all UAVs. The CSV holds mean, standard deviation and the 95%
+confidence interval of that value over the replications.
+
+Examples:
+  scripts/runbatch.py -c Szenario_Hotel_Gabelbach -j 8
+  scripts/runbatch.py -c Szenario_Hotel_Gabelbach --job-list jobs.txt   # distribute jobs.txt to hosts
+  scripts/runbatch.py -c Szenario_Hotel_Gabelbach --aggregate-only      # after the runs have finished
+
+The exit code is non-zero if a run failed, the results of the other runs are aggregated anyway.
+"""
+
+import argparse
+import csv
+import math
+import os
+import re
+import shlex
+import subprocess
+import sys
+from collections import OrderedDict, defaultdict
+from concurrent.futures import ThreadPoolExecutor
+
+PROJECT_DIR = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+# scalars recorded by MobileNode::finish and ChargingNode::finish
+DEFAULT_SCALARS = [
+    "utilizationSecMission",
+    "utilizationSecMaintenance",
+    "utilizationSecCharge",
+    "utilizationSecIdle",
+    "utilizationEnergyMission",
+    "utilizationEnergyMaintenance",
+    "utilizationEnergyCharge",
+    "utilizationEnergyOverdrawMission",
+    "utilizationEnergyOverdrawMaintenance",
+    "utilizationCountMissions",
+    "utilizationCountManeuversMission",
+    "utilizationCountManeuversMaintenance",
+    "utilizationCountChargeState",
+    "utilizationCountOverdrawnAfterMission",
+    "utilizationCountIdleState",
+    "utilizationFail",
+    "usedPower",
+    "chargedPower",
+    "chargedMobileNodes",
+    "reservations",
+]
+
+# two-sided 95% quantiles of Student's t distribution for 1..30 degrees of freedom
+T_95 = [12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+        2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+        2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042]
+
+
+def default_executable():
+    for name in ("multiUAV-simulation-headless", "multiUAV-simulation"):
+        path = os.path.join(PROJECT_DIR, name)
+        if os.path.exists(path):
+            return path
+    return os.path.join(PROJECT_DIR, "multiUAV-simulation")
+
+
+def query_run_numbers(args):
+    cmd = [args.executable, "-u", "Cmdenv", "-n", ".", "-f", args.ini, "-c", args.config, "-s", "-q", "runnumbers"]
+    if args.runs:
+        cmd += ["-r", args.runs]
+    output = subprocess.run(cmd, cwd=PROJECT_DIR, stdout=subprocess.PIPE, universal_newlines=True, check=True).stdout
+    lines = [line for line in output.splitlines() if line.strip()]
+    if not lines:
+        raise RuntimeError("No runs found for config " + args.config)
+    return [int(token) for token in lines[-1].split() if token.isdigit()]
+
+
+def scalar_file(args, run):
+    return os.path.join(PROJECT_DIR, args.result_dir, "%s-%d.sca" % (args.config, run))
+
+
+def run_command(args, run):
+    return [args.executable, "-u", "Cmdenv", "-n", ".", "-f", args.ini, "-c", args.config, "-r", str(run),
+            "--seed-set=%d" % run, "--result-dir=" + args.result_dir, "--output-scalar-file=${resultdir}/${configname}-${runnumber}.sca",
+            "--cmdenv-express-mode=true"]
+
+
+def execute(args, run):
+    with open(os.devnull, "w") as devnull:
+        returncode = subprocess.call(run_command(args, run), cwd=PROJECT_DIR, stdout=devnull, stderr=subprocess.STDOUT)
+    print("run %d of %s finished with exit code %d" % (run, args.config, returncode), flush=True)
+    return run, returncode
+
+
+def parse_sca(path, scalars):
+    """
+    Returns the iteration variables of the run and the values of the requested scalars summed up per module type.
+    """
+    iterationvars = ""
+    values = defaultdict(float)
+    with open(path) as f:
+        for line in f:
+            if line.startswith("attr iterationvars "):
+                iterationvars = line[len("attr iterationvars "):].strip().strip('"')
+            elif line.startswith("scalar "):
+                parts = shlex.split(line)
+                if len(parts) < 4 or parts[2] not in scalars:
+                    continue
+                module = re.sub(r"\[\d+\]", "[*]", parts[1])
+                try:
+                    values[(module, parts[2])] += float(parts[3])
+                except ValueError:
+                    continue
+    return iterationvars, values
+
+
+def confidence_interval(samples):
+    n = len(samples)
+    mean = sum(samples) / n
+    if n < 2:
+        return mean, 0.0, mean, mean
+    stddev = math.sqrt(sum((x - mean) ** 2 for x in samples) / (n - 1))
+    t = T_95[n - 2] if n - 1 <= len(T_95) else 1.960
+    half = t * stddev / math.sqrt(n)
+    return mean, stddev, mean - half, mean + half
+
+
+def aggregate(args, runs):
+    """
+    Only the <config>-<run>.sca files of the given runs are read, not those of other configs starting with the same name.
+    """
+    files = [scalar_file(args, run) for run in runs if os.path.exists(scalar_file(args, run))]
+    missing = [run for run in runs if not os.path.exists(scalar_file(args, run))]
+    if missing:
+        print("no scalar file for runs: " + " ".join(str(run) for run in missing), file=sys.stderr)
+    if not files:
+        raise RuntimeError("No scalar files found for config " + args.config)
+    samples = OrderedDict()
+    for path in files:
+        iterationvars, values = parse_sca(path, args.scalars)
+        for (module, name), value in sorted(values.items()):
+            samples.setdefault((iterationvars, module, name), []).append(value)
+
+    output = args.output or os.path.join(PROJECT_DIR, args.result_dir, args.config + "-summary.csv")
+    with open(output, "w", newline="") as f:
+        writer = csv.writer(f)
+        writer.writerow(["config", "iterationvars", "module", "scalar", "runs", "mean", "stddev", "ci95low", "ci95high"])
+        for (iterationvars, module, name), values in samples.items():
+            mean, stddev, low, high = confidence_interval(values)
+            writer.writerow([args.config, iterationvars, module, name, len(values), mean, stddev, low, high])
+    print("aggregated %d scalar files into %s" % (len(files), output))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("-c", "--config", required=True, help="configuration in the ini file")
+    parser.add_argument("-r", "--runs", help="run filter, e.g. \"0..15\" or \"$replM==2\"")
+    parser.add_argument("-j", "--jobs", type=int, default=os.cpu_count() or 1, help="number of concurrent simulation processes")
+    parser.add_argument("-f", "--ini", default="omnetpp.ini", help="ini file")
+    parser.add_argument("-x", "--executable", default=default_executable(), help="simulation executable, the headless build if it exists")
+    parser.add_argument("--result-dir", default="results", help="result directory relative to the project")
+    parser.add_argument("-o", "--output", help="aggregated CSV file, default <result-dir>/<config>-summary.csv")
+    parser.add_argument("--scalars", type=lambda s: s.split(","), default=DEFAULT_SCALARS, help="comma separated scalar names to aggregate")
+    parser.add_argument("--job-list", help="only write one command line per run into this file, e.g. to distribute them to several hosts")
+    parser.add_argument("--aggregate-only", action="store_true", help="only aggregate existing scalar files")
+    args = parser.parse_args()
+    args.executable = os.path.abspath(args.executable)
+
+    runs = query_run_numbers(args)
+    failed = []
+    if not args.aggregate_only:
+        if args.job_list:
+            with open(args.job_list, "w") as f:
+                for run in runs:
+                    f.write("cd %s && %s\n" % (shlex.quote(PROJECT_DIR), " ".join(shlex.quote(a) for a in run_command(args, run))))
+            print("wrote %d jobs to %s" % (len(runs), args.job_list))
+            return 0
+        with ThreadPoolExecutor(max_workers=max(1, args.jobs)) as pool:
+            failed = [run for run, returncode in pool.map(lambda run: execute(args, run), runs) if returncode != 0]
+        if failed:
+            print("failed runs: " + " ".join(str(run) for run in failed), file=sys.stderr)
+
+    aggregate(args, runs)
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,100 @@
+#!/usr/bin/env python3
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Lesser General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this program.  If not, see http://www.gnu.org/licenses/.
+#
+
+"""
+Reads the binary telemetry files written by the TelemetryRecorder module and
+converts them into CSV, one row per record.
+
+A file starts with the magic "UMT1" followed by chunks: a uint32 record count,
+then the columns time (double), node (int32), x, y, z, yaw, remaining (float),
+ceeType, status (int8) and reason (uint8), in native byte order. node is the
+OMNeT++ module id of the node (shown by Qtenv and in the eventlog), it is
+unique over all regions of a RegionalNet, unlike the node index.
+
+Examples:
+  scripts/telemetry.py results/Szenario_Hotel_Gabelbach-Telemetry-0.telemetry
+  scripts/telemetry.py results/run.telemetry --node 42 --reason status -o uav.csv
+"""
+
+import argparse
+import array
+import csv
+import struct
+import sys
+
+MAGIC = 0x31544d55
+
+COLUMNS = [("time", "d"), ("node", "i"), ("x", "f"), ("y", "f"), ("z", "f"), ("yaw", "f"), ("remaining", "f"),
+           ("ceeType", "b"), ("status", "b"), ("reason", "B")]
+
+# enum class CeeType in CommandExecEngine.h, enum class NodeStatus in MissionControlDataMap.h
+CEE_TYPES = ["WAYPOINT", "TAKEOFF", "HOLDPOSITION", "CHARGE", "EXCHANGE", "IDLE"]
+REASONS = ["sample", "update", "status"]
+
+
+def read_chunks(path):
+    """
+    Yields every chunk of the file as a dict of column arrays.
+    """
+    with open(path, "rb") as f:
+        header = f.read(4)
+        if len(header) < 4 or struct.unpack("=I", header)[0] != MAGIC:
+            raise RuntimeError("%s is no telemetry file" % path)
+        while True:
+            header = f.read(4)
+            if len(header) < 4:
+                return
+            count = struct.unpack("=I", header)[0]
+            chunk = {}
+            for name, typecode in COLUMNS:
+                column = array.array(typecode)
+                column.frombytes(f.read(count * column.itemsize))
+                if len(column) != count:
+                    raise RuntimeError("%s is truncated" % path)
+                chunk[name] = column
+            yield count, chunk
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("file", help="telemetry file")
+    parser.add_argument("-o", "--output", help="CSV file, default stdout")
+    parser.add_argument("--node", type=int, action="append", help="only records of the node with this module id, can be repeated")
+    parser.add_argument("--reason", choices=REASONS, action="append", help="only records written for this reason, can be repeated")
+    args = parser.parse_args()
+
+    nodes = set(args.node) if args.node else None
+    reasons = set(REASONS.index(reason) for reason in args.reason) if args.reason else None
+    output = open(args.output, "w", newline="") if args.output else sys.stdout
+    writer = csv.writer(output)
+    writer.writerow([name for name, _ in COLUMNS])
+    for count, chunk in read_chunks(args.file):
+        for i in range(count):
+            if nodes is not None and chunk["node"][i] not in nodes:
+                continue
+            if reasons is not None and chunk["reason"][i] not in reasons:
+                continue
+            cee = chunk["ceeType"][i]
+            writer.writerow([chunk["time"][i], chunk["node"][i], chunk["x"][i], chunk["y"][i], chunk["z"][i], chunk["yaw"][i],
+                             chunk["remaining"][i], CEE_TYPES[cee] if 0 <= cee < len(CEE_TYPES) else "",
+                             chunk["status"][i], REASONS[chunk["reason"][i]]])
+    if args.output:
+        output.close()
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())